@@ -9,12 +9,56 @@
        History  :
   Others        :
 ====================================================================== */
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
+#include <float.h>
+#include <math.h>
+#include <stdatomic.h>
+#if defined(_WIN32) && defined(__has_include)
+#if __has_include(<threads.h>)
+#define BST_HAVE_THREADS_H
+#endif
+#elif !defined(_WIN32)
+#define BST_HAVE_THREADS_H
+#endif
+#if defined(BST_HAVE_THREADS_H)
+#include <threads.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if defined(_WIN32)
+#include <io.h>
+#include <malloc.h>
+#endif
+#if defined(_WIN32) && !defined(BST_HAVE_THREADS_H)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#undef NO_ERROR
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
 
 #define NULL_DATA_PTR                            ((void *)0)
 #define NULL_CHAR                               ('\0')
@@ -25,36 +69,582 @@
 #define STUDENT_NAME_MAX_CHARS        (15)
 #define STUDENT_MIN_GRADE             (0.0)
 #define STUDENT_MAX_GRADE             (100.0)
+#define STUDENT_PAGE_SIZE             (10)
+#define STUDENT_STATS_BUCKETS         (10)
+#define STUDENT_GPA_INDEX             (0)
+#define STUDENT_FILE                  ("students.bst")
+#define STUDENT_JOURNAL               ("students.jnl")
+#define STUDENT_JOURNAL_BATCH_OPS     (32)
+#define STUDENT_JOURNAL_BATCH_USEC    (10000)
+/* batch mode: longest command line, output buffer, and changes per journal commit */
+#define STUDENT_BATCH_LINE            (256)
+#define STUDENT_BATCH_OUT             (1048576)
+#define STUDENT_BATCH_OUT_LINE        (128)
+#define STUDENT_BATCH_JOURNAL_OPS     (4096)
 
-typedef unsigned char uint8_t;
-typedef unsigned short int uint16_t;
-typedef unsigned int uint32_t;
-typedef unsigned long uint64_t;
+/* tree modes selected in BST_Create */
+#define BST_MODE_BASIC                (0x00)
+#define BST_MODE_AVL                  (0x01)
+#define BST_MODE_INLINE_KEY           (0x02)
+#define BST_MODE_ORDER_STAT           (0x04)
+#define BST_MODE_INDEX                (0x08)
+#define BST_MODE_HASH                 (0x10)
+#define BST_MODE_BPLUS                (0x20)
+#define BST_MODE_MAPPED               (0x40)
+#define BST_MODE_CONCURRENT           (0x80)
 
-typedef char int8_t;
-typedef short int int16_t;
-typedef int int32_t;
-typedef long int64_t;
+/* secondary indexes a tree keeps in sync with BST_Insert and BST_Delete */
+#define BST_MAX_INDEXES               (4)
+
+/* BST_Create_Sharded: most key range shards of a tree */
+#define BST_MAX_SHARDS                (64)
+
+/* BST_Create_Dense: most keys in a dense domain, most domain keys per expected key
+   (a slot costs a pointer and a bit, a tree node several pointers) */
+#define BST_DENSE_MAX_KEYS            (16777216)
+#define BST_DENSE_MAX_SLOTS_PER_KEY   (4)
+#define BST_DENSE_HAS(dense, k)       ((((dense)->bits[(k) >> 5]) >> ((k) & 31)) & 1u)
+
+/* hash side index (BST_MODE_HASH): linear probing table, doubled past the max load */
+#define BST_HASH_MIN_SLOTS            (16)
+#define BST_HASH_MAX_LOAD_PCT         (50)
+
+/* B+ engine (BST_MODE_BPLUS): int keys per node, one cache line searched with one SIMD rank */
+#define BST_BPLUS_KEYS                (16)
+
+/* BST_Save file, in native byte order: a foreign byte order fails the magic check */
+#define BST_FILE_MAGIC                (0x46545342)
+#define BST_FILE_VERSION              (1)
+
+/* write ahead journal: magic "BSTJ", entry ops, and bytes of entries one group commit may hold */
+#define BST_JOURNAL_MAGIC             (0x4A545342)
+#define BST_JOURNAL_VERSION           (1)
+#define BST_JOURNAL_INSERT            (1)
+#define BST_JOURNAL_DELETE            (2)
+#define BST_JOURNAL_BUFFER            (65536)
+
+/* longest sleep of a journal's flusher thread in microseconds: bounds how long BST_Journal_Close waits for it */
+#define BST_JOURNAL_FLUSH_USEC        (100000)
+
+/* BST_ImportCSV: bytes read per block (also the longest row), and fields kept per row */
+#define BST_IMPORT_BLOCK              (1048576)
+#define BST_IMPORT_MAX_FIELDS         (16)
+
+/* number parsing: digits that always fit a uint64_t, and the longest float string
+   handed to strtof when the exact fast paths cannot decide */
+#define PARSE_MAX_DIGITS              (19)
+#define PARSE_MAX_CHARS               (64)
+#define PARSE_BENCH_STRS              (4096)
+
+/* eight ascii digits are converted in one 64 bit word when its first byte is the low byte */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PARSE_SWAR                    (0)
+#else
+#define PARSE_SWAR                    (1)
+#endif
+
+/* frozen snapshot: int keys per cache line, so keys[16k] holds k's descendants 4 levels down */
+#define BST_FROZEN_PREFETCH           (16)
+
+#if defined(__GNUC__)
+#define BST_CTZ(x)                    (__builtin_ctz(x))
+#define BST_CLZ(x)                    (__builtin_clz(x))
+#define BST_POPCOUNT(x)               (__builtin_popcount(x))
+#define BST_PREFETCH(addr)            (__builtin_prefetch(addr))
+#else
+#define BST_CTZ(x)                    (_bit_ctz(x))
+#define BST_CLZ(x)                    (_bit_clz(x))
+#define BST_POPCOUNT(x)               (_bit_count(x))
+#define BST_PREFETCH(addr)            ((void)(addr))
+#endif
+
+/* string index trie: node kinds by child capacity, compressed path chars kept in a node */
+#define BST_TRIE_KIND4                (0)
+#define BST_TRIE_KIND16               (1)
+#define BST_TRIE_KIND256              (2)
+#define BST_TRIE_NUM_KINDS            (3)
+#define BST_TRIE_CAPACITY(kind)       ((kind) == BST_TRIE_KIND4 ? 4 : ((kind) == BST_TRIE_KIND16 ? 16 : 256))
+#define BST_TRIE_MAX_PREFIX           (16)
+
+/* AVL height is below 1.45 * log2(n + 2), so this bounds any AVL search path */
+#define BST_MAX_HEIGHT                (64)
+
+/* node pool slabs start small and double up to the max objects per slab */
+#define BST_POOL_MIN_SLAB_OBJS        (64)
+#define BST_POOL_MAX_SLAB_OBJS        (65536)
+#define BST_POOL_ALIGN                (64)
+
+/* cache line aligned blocks: MSVC has no aligned_alloc, and _aligned_malloc blocks need _aligned_free */
+#if defined(_WIN32)
+#define BST_ALIGNED_ALLOC(align, size)  (_aligned_malloc((size), (align)))
+#define BST_ALIGNED_FREE(ptr)           (_aligned_free(ptr))
+#else
+#define BST_ALIGNED_ALLOC(align, size)  (aligned_alloc((align), (size)))
+#define BST_ALIGNED_FREE(ptr)           (free(ptr))
+#endif
+
+/* Windows without <threads.h>: the C11 threads subset used here, on Win32 threads and SRW locks */
+#if defined(_WIN32) && !defined(BST_HAVE_THREADS_H)
+#define thrd_success                  (0)
+#define thrd_error                    (2)
+#define mtx_plain                     (1)
+#define mtx_init(mtx, type)           ((void)(type), InitializeSRWLock(mtx), thrd_success)
+#define mtx_lock(mtx)                 (AcquireSRWLockExclusive(mtx))
+#define mtx_unlock(mtx)               (ReleaseSRWLockExclusive(mtx))
+#define mtx_destroy(mtx)              ((void)(mtx))
+#define thrd_yield()                  ((void)SwitchToThread())
+#define thrd_sleep(dur, rem)          ((void)(rem), Sleep((DWORD)((dur)->tv_sec * 1000 + (dur)->tv_nsec / 1000000)), 0)
+#endif
+
+/* BST_Create_Arena: size of the first arena block; later ones double up to the max */
+#define BST_ARENA_MIN_BLOCK           (1048576)
+#define BST_ARENA_MAX_BLOCK           (268435456)
+
+/* concurrent mode: reader slots (threads share slot id % BST_RCU_SLOTS), retired objects
+   freed per grace period, and the most nodes one change copies: path, rotations, new node */
+#define BST_RCU_SLOTS                 (64)
+#define BST_RCU_BATCH                 (1024)
+#define BST_RCU_MAX_COPIES            (3 * BST_MAX_HEIGHT + 2)
+
+/* lock-free engine (BST_MODE_CONCURRENT without BST_MODE_AVL): low bits of a child link
+   (flag: the leaf it leads to is being deleted, tag: the link is being spliced out), and
+   the low bit of a retired node's link marking that its record is freed with it */
+#define BST_LF_FLAG                   ((uintptr_t)1)
+#define BST_LF_TAG                    ((uintptr_t)2)
+#define BST_LF_ADDR(link)             ((BST_LF_NODE *)((link) & ~(BST_LF_FLAG | BST_LF_TAG)))
+#define BST_LF_RECORD                 ((uintptr_t)1)
+#define BST_LOCK_FREE(tree)           (((tree)->mode & (BST_MODE_CONCURRENT | BST_MODE_AVL)) == BST_MODE_CONCURRENT)
+
+/* parallel walks: most pool threads, threads where the core count is unknown, chunks
+   dealt per thread, and most chunks of a walk */
+#define BST_PAR_MAX_THREADS           (64)
+#define BST_PAR_DEFAULT_THREADS       (4)
+#define BST_PAR_CHUNKS_PER_THREAD     (8)
+#define BST_PAR_MAX_CHUNKS            (1024)
+
+/* a work-stealing run [lo, hi) of chunk numbers packed in one 64 bit word, and its halves */
+#define BST_PAR_RUN(lo, hi)           ((((uint64_t)(uint32_t)(hi)) << 32) | (uint64_t)(uint32_t)(lo))
+#define BST_PAR_RUN_LO(run)           ((uint32_t)((run) & UINT64_C(0xFFFFFFFF)))
+#define BST_PAR_RUN_HI(run)           ((uint32_t)((run) >> 32))
+
+/* benchReaders and benchWriters: most threads, lookups timed per reader, operations per
+   writer, and shards of the sharded tree */
+#define BST_BENCH_READERS             (8)
+#define BST_BENCH_READER_LOOKUPS      (1048576)
+#define BST_BENCH_WRITER_OPS          (262144)
+#define BST_BENCH_SHARDS              (16)
 
 typedef enum
 {
 	NO_ERROR, SUCCESS = 0, FAILURE, ERR_NULL_PTR, ERR_INVALID_DATA, ERR_BST_EMPTY, ERR_BST_FULL
 } system_status_t;
 
+#if defined(_WIN32) && !defined(BST_HAVE_THREADS_H)
+typedef HANDLE thrd_t;
+typedef SRWLOCK mtx_t;
+typedef int (*thrd_start_t) (void*);
+
+/* what thrd_create hands its new thread */
+typedef struct
+{
+	thrd_start_t func;
+	void* arg;
+} BST_THRD_START;
+#endif
+
+/* fields read on a descent come first */
 typedef struct node
 {
-	void *dataPtr;
+	int key;
+	int size;
 	struct node *left;
 	struct node *right;
+	void *dataPtr;
+	int height;
+	int fresh;
 } NODE;
 
+/* slab header; pool objects follow it at the next BST_POOL_ALIGN (cache line) boundary */
+typedef struct slab
+{
+	struct slab *next;
+} BST_SLAB;
+
+/* arena block header; the block's space follows it */
+typedef struct arena_block
+{
+	struct arena_block *next;
+	size_t size;
+} BST_ARENA_BLOCK;
+
+/* one region for the nodes and records of a BST_Create_Arena tree: blocks in the order
+   they were added, carved in turn; a reset rewinds to the first block and keeps them all */
+typedef struct
+{
+	BST_ARENA_BLOCK *first;
+	BST_ARENA_BLOCK *current;
+	char *bump;
+	char *bump_end;
+	size_t next_size;
+	void (*destroy)(void *dataPtr);
+} BST_ARENA;
+
+/* fixed size object pool: recycled objects on free list, fresh ones carved from newest slab;
+   slabs come from arena if set, and are then released with it */
+typedef struct
+{
+	size_t obj_size;
+	int slab_objs;
+	int num_slabs;
+	int capacity;
+	int in_use;
+	void *free_list;
+	char *bump;
+	char *bump_end;
+	BST_SLAB *slabs;
+	BST_ARENA *arena;
+} BST_POOL;
+
+/* record list of a trie node: every data whose string ends at that node */
+typedef struct trie_value
+{
+	void *dataPtr;
+	struct trie_value *next;
+} BST_TRIE_VALUE;
+
+/* trie node header: the path below the parent edge continues with prefix, then a child edge */
+typedef struct trie_node
+{
+	uint8_t kind;
+	uint8_t num_children;
+	uint8_t prefix_len;
+	unsigned char prefix[BST_TRIE_MAX_PREFIX];
+	BST_TRIE_VALUE *values;
+} BST_TRIE_NODE;
+
+/* small nodes keep their edge chars sorted so a walk visits strings in order */
+typedef struct
+{
+	BST_TRIE_NODE header;
+	unsigned char keys[4];
+	BST_TRIE_NODE *children[4];
+} BST_TRIE_NODE4;
+
+typedef struct
+{
+	BST_TRIE_NODE header;
+	unsigned char keys[16];
+	BST_TRIE_NODE *children[16];
+} BST_TRIE_NODE16;
+
+typedef struct
+{
+	BST_TRIE_NODE header;
+	BST_TRIE_NODE *children[256];
+} BST_TRIE_NODE256;
+
+/* adaptive radix trie over a string field of the data */
+typedef struct
+{
+	int count;
+	const char* (*getStr)(void *arg);
+	BST_TRIE_NODE *root;
+	BST_POOL node_pools[BST_TRIE_NUM_KINDS];
+	BST_POOL value_pool;
+} BST_TRIE;
+
+/* one step of a trie descent: the link to a node and the edge char taken to it */
+typedef struct
+{
+	BST_TRIE_NODE **link;
+	unsigned char edge;
+} BST_TRIE_STEP;
+
+/* hash side index slot; a null dataPtr marks a free slot */
+typedef struct
+{
+	int key;
+	void *dataPtr;
+} BST_HASH_SLOT;
+
+/* open addressing table over the inline keys; mask + 1 slots, a power of 2 */
 typedef struct
+{
+	BST_HASH_SLOT *slots;
+	int count;
+	int shift;
+	uint32_t mask;
+} BST_HASH;
+
+/* read only snapshot: keys[1..count] and data[1..count] in Eytzinger (BFS) order; a
+   snapshot mapped by BST_Open holds record k at records + (k - 1) * record_size instead */
+typedef struct
+{
+	int count;
+	int (*getKey)(void *arg);
+	int *keys;
+	void **data;
+	char *records;
+	size_t record_size;
+	void *map;
+	size_t map_size;
+} BST_FROZEN;
+
+/* BST_Save file header; keys[0..count] and records[1..count] follow at their offsets */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	int32_t count;
+	uint32_t record_size;
+	uint64_t keys_offset;
+	uint64_t records_offset;
+	uint64_t file_size;
+	uint32_t body_crc;
+	uint32_t header_crc;
+} BST_FILE_HEADER;
+
+/* BST_Save writes the header as is: its size, with no padding, is part of the format */
+_Static_assert (sizeof (BST_FILE_HEADER) == 48, "BST_FILE_HEADER is 48 bytes on disk");
+
+/* journal file header; fixed size entries follow, each a BST_JOURNAL_ENTRY and a record */
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t header_crc;
+} BST_JOURNAL_HEADER;
+
+/* journal entry: crc covers op and the record after it */
+typedef struct
+{
+	uint32_t op;
+	uint32_t crc;
+} BST_JOURNAL_ENTRY;
+
+/* write ahead journal of a tree: logged changes wait in buf for a group commit; the file
+   holds committed bytes of whole entries, unless failed could not cut a torn write off.
+   lock guards buf and file against the flusher thread, which commits an idle group */
+typedef struct
+{
+	FILE *file;
+	char path[FILENAME_MAX];
+	size_t record_size;
+	int batch_ops;
+	int64_t batch_usec;
+	char *buf;
+	size_t used;
+	size_t capacity;
+	int pending;
+	int64_t first_usec;
+	int64_t committed;
+	bool failed;
+	mtx_t lock;
+	thrd_t flusher;
+	bool flushing;
+	atomic_bool stop;
+} BST_JOURNAL;
+
+/* lock-free engine node: a leaf (no children) holds data, an internal node routes keys
+   below its key to the left; inf (1..3) puts the sentinel keys above every int key.
+   Once unlinked, retired chains it into its slot's retired list; no reader reads it */
+typedef struct lf_node
+{
+	int key;
+	int inf;
+	_Atomic(uintptr_t) left;
+	_Atomic(uintptr_t) right;
+	void *dataPtr;
+	uintptr_t retired;
+} BST_LF_NODE;
+
+/* lock-free engine: nodes met by a search, for an insert or delete at leaf */
+typedef struct
+{
+	BST_LF_NODE *ancestor;
+	BST_LF_NODE *successor;
+	BST_LF_NODE *parent;
+	BST_LF_NODE *leaf;
+	uintptr_t leaf_link;
+} BST_LF_SEEK;
+
+/* reader counts of the threads sharing a slot, by phase parity, then the lock-free
+   engine's per slot state: net inserts, node pool and retired list (under lock) */
+typedef struct
+{
+	_Alignas(BST_POOL_ALIGN) atomic_long active[2];
+	atomic_long count;
+	atomic_flag lock;
+	BST_POOL node_pool;
+	BST_LF_NODE *retired;
+	int num_retired;
+} BST_RCU_SLOT;
+
+/* concurrent mode: readers start from the published root; a writer holds write_lock,
+   copies every node it changes (fresh until published) and retires what it unlinks.
+   The lock-free engine's writers take one grace period at a time under reclaim_lock */
+typedef struct
+{
+	BST_RCU_SLOT slots[BST_RCU_SLOTS];
+	_Alignas(BST_POOL_ALIGN) _Atomic(NODE *) root;
+	atomic_int count;
+	atomic_uint phase;
+	_Alignas(BST_POOL_ALIGN) mtx_t write_lock;
+	mtx_t data_lock;
+	atomic_flag reclaim_lock;
+	int num_fresh;
+	int num_retired_nodes;
+	int num_retired_data;
+	NODE *fresh[BST_RCU_MAX_COPIES];
+	NODE *retired_nodes[BST_RCU_BATCH + BST_RCU_MAX_COPIES];
+	void *retired_data[BST_RCU_BATCH + 1];
+} BST_RCU;
+
+/* B+ engine node: a leaf holds data in ptrs[0..num_keys) and is linked to its neighbours;
+   an internal node's child ptrs[i] holds keys in (keys[i-1], keys[i]] */
+typedef struct bplus_node
+{
+	_Alignas(BST_POOL_ALIGN) int keys[BST_BPLUS_KEYS];
+	int num_keys;
+	int leaf;
+	struct bplus_node *prev;
+	struct bplus_node *next;
+	void *ptrs[BST_BPLUS_KEYS + 1];
+} BST_BPLUS_NODE;
+
+/* key range shards of a BST_Create_Sharded tree, each a BST_MODE_CONCURRENT tree:
+   shard i holds the keys from splits[i - 1] up to splits[i] */
+typedef struct
+{
+	int num_shards;
+	int splits[BST_MAX_SHARDS - 1];
+	struct bst_tree *trees[BST_MAX_SHARDS];
+} BST_SHARDS;
+
+/* key domain of a BST_Create_Dense tree: the data of key lo + k is slots[k] when bit k
+   of bits is set */
+typedef struct
+{
+	int lo;
+	int num_slots;
+	int num_words;
+	unsigned int *bits;
+	void **slots;
+} BST_DENSE;
+
+typedef struct bst_tree
 {
 	int count;
 	int (*compare)(void *arg1, void *arg2);
+	int (*getKey)(void *arg);
 	NODE *root;
+	uint8_t mode;
+	BST_POOL node_pool;
+	BST_POOL data_pool;
+	int num_indexes;
+	struct bst_tree *indexes[BST_MAX_INDEXES];
+	BST_TRIE *trie;
+	BST_HASH hash;
+	BST_BPLUS_NODE *bplus_root;
+	BST_FROZEN *frozen;
+	BST_JOURNAL *journal;
+	BST_RCU *rcu;
+	BST_LF_NODE *lf_root;
+	BST_ARENA *arena;
+	BST_SHARDS *shards;
+	BST_DENSE *dense;
 } BST_TREE;
 
+/* explicit traversal stack: starts in local storage, grows on heap for deep (BST_MODE_BASIC) trees */
+typedef struct
+{
+	NODE **items;
+	int top;
+	int capacity;
+	NODE *local[BST_MAX_HEIGHT];
+} BST_STACK;
+
+/* ordered cursor: path holds root..current node (leaf and slot in BST_MODE_BPLUS, slot
+   alone in BST_MODE_MAPPED); hiPtr (if any) is the exclusive range end */
+typedef struct
+{
+	BST_TREE *tree;
+	void *hiPtr;
+	int hiKey;
+	BST_STACK path;
+	BST_BPLUS_NODE *leaf;
+	int slot;
+} BST_CURSOR;
+
+/* one pending subtree of BST_BuildFromStream: key positions [lo, hi) hang from link */
+typedef struct
+{
+	int lo;
+	int hi;
+	int state;
+	NODE **link;
+	NODE *node;
+} BST_BUILD_FRAME;
+
+/* one finger link of BST_InsertBatch: its subtree holds keys in [lo, hi); null bound is open */
+typedef struct
+{
+	NODE **link;
+	NODE *lo;
+	NODE *hi;
+} BST_FINGER;
+
+/* stream context of BST_BuildFromSorted */
+typedef struct
+{
+	void **dataArray;
+	int index;
+} BST_ARRAY_STREAM;
+
+/* one chunk of a parallel walk, in key order: a subtree of nodes, then node last; a run of
+   B+ leaves [leaf, stop); a subtree of a mapped snapshot's slots, then slot last_slot; or
+   the bitmap words [slot, last_slot) of a dense tree */
+typedef struct
+{
+	NODE *root;
+	NODE *last;
+	BST_BPLUS_NODE *leaf;
+	BST_BPLUS_NODE *stop;
+	int slot;
+	int last_slot;
+} BST_PAR_CHUNK;
+
+/* a pool worker's run of chunk numbers [lo, hi), as BST_PAR_RUN(lo, hi); one cache line each */
+typedef struct
+{
+	_Alignas(BST_POOL_ALIGN) _Atomic(uint64_t) range;
+} BST_PAR_DEQUE;
+
+/* shared state of one BST_ParallelReduce (map) or BST_ParallelTraverse (process) */
+typedef struct
+{
+	BST_TREE *tree;
+	void (*map)(void *acc, void *dataPtr);
+	void (*process)(void *dataPtr, int chunk);
+	void *result;
+	size_t acc_size;
+	size_t acc_stride;
+	char *accs;
+	BST_PAR_CHUNK *chunks;
+	int num_chunks;
+	int num_workers;
+	atomic_int failed;
+	BST_PAR_DEQUE deques[BST_PAR_MAX_THREADS];
+} BST_PAR_JOB;
+
+/* argument of a pool thread */
+typedef struct
+{
+	BST_PAR_JOB *job;
+	int worker;
+} BST_PAR_WORKER;
+
 typedef struct
 {
     int id;
@@ -62,24 +652,238 @@ typedef struct
     float gpa;
 } STUDENT;
 
-system_status_t system_status = NO_ERROR;
+/* accumulator of printStats */
+typedef struct
+{
+    long count;
+    double gpa_sum;
+    float min_gpa;
+    float max_gpa;
+    long buckets[STUDENT_STATS_BUCKETS];
+} STUDENT_STATS;
+
+/* one reader thread of benchReaders */
+typedef struct
+{
+    BST_TREE *tree;
+    int *ids;
+    int count;
+    unsigned int seed;
+    long found;
+} BENCH_READER;
+
+/* one writer thread of benchWriters */
+typedef struct
+{
+    BST_TREE *tree;
+    int *ids;
+    int count;
+    unsigned int seed;
+    long changes;
+    long key_sum;
+    long found;
+} BENCH_WRITER;
+
+_Thread_local system_status_t system_status = NO_ERROR;
 
 bool trace_flag = false;
 
-BST_TREE* BST_Create(int (*compare) (void* argu1, void* argu2));
+/* BST_MODE_CONCURRENT reader slot of this thread, taken on its first BST_Read_Lock */
+_Thread_local int bst_rcu_slot = -1;
+atomic_uint bst_rcu_threads = 0;
+
+BST_TREE* BST_Create(int (*compare) (void* argu1, void* argu2), const uint8_t mode);
+BST_TREE* BST_Create_Key (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu), const uint8_t mode);
+BST_TREE* BST_Create_Arena (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                            const uint8_t mode, void (*destroy) (void* dataPtr));
+BST_TREE* BST_Create_Sharded (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                              const uint8_t mode, int num_shards, const int* splits);
+int BST_Shard_Splits (int* keys, int num_keys, int num_shards, int* splits);
+BST_TREE* BST_Get_Shard (BST_TREE* tree, void* keyPtr);
+static inline int _shard_index (BST_SHARDS* shards, int key);
+static int _compare_int (const void* argu1, const void* argu2);
+BST_TREE* BST_Create_Dense (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                            const uint8_t mode, int lo_key, int hi_key, int expected);
+static inline int _dense_slot (BST_DENSE* dense, int key);
+static int _dense_next (BST_DENSE* dense, int slot);
+static int _dense_prev (BST_DENSE* dense, int slot);
+static int _dense_select (BST_DENSE* dense, int index);
+static int _dense_rank (BST_DENSE* dense, int slot);
+static bool _dense_build (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count);
 BST_TREE* BST_Destroy (BST_TREE* tree);
+bool BST_Clear (BST_TREE* tree);
+static void _release_data (BST_TREE* tree);
 bool BST_Insert (BST_TREE* tree, void* dataPtr);
+static bool _insert_record (BST_TREE* tree, void* dataPtr);
 bool BST_Delete (BST_TREE* tree, void* dltKey);
+static bool _delete_record (BST_TREE* tree, void* dltKey);
 void* BST_Retrieve (BST_TREE* tree, void* keyPtr);
 void BST_Traverse (BST_TREE* tree, void (*process)(void* dataPtr));
+bool BST_ParallelReduce (BST_TREE* tree, void (*map) (void* acc, void* dataPtr),
+                         void (*combine) (void* acc, void* other), void* result, size_t acc_size, int nthreads);
+int BST_ParallelTraverse (BST_TREE* tree, void (*process) (void* dataPtr, int chunk), int nthreads);
 bool BST_Empty (BST_TREE* tree);
 bool BST_Full (BST_TREE* tree);
 int BST_Count (BST_TREE* tree);
+int BST_Read_Lock (BST_TREE* tree);
+void BST_Read_Unlock (BST_TREE* tree, int phase);
+void* BST_Alloc_Data (BST_TREE* tree, size_t data_size);
+void BST_Free_Data (BST_TREE* tree, void* dataPtr);
+bool BST_BuildFromSorted (BST_TREE* tree, void** dataArray, int count);
+bool BST_BuildFromStream (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count);
+static bool _build_stream (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count);
+static void* _next_array (void* ctx);
+int BST_InsertBatch (BST_TREE* tree, void** dataArray, int count);
+BST_CURSOR* BST_Cursor_Create (BST_TREE* tree);
+BST_CURSOR* BST_Cursor_Destroy (BST_CURSOR* cursor);
+void* BST_Cursor_First (BST_CURSOR* cursor);
+void* BST_Cursor_Last (BST_CURSOR* cursor);
+void* BST_Cursor_Seek (BST_CURSOR* cursor, void* keyPtr);
+void* BST_Cursor_Range (BST_CURSOR* cursor, void* loKey, void* hiKey);
+void* BST_Cursor_Next (BST_CURSOR* cursor);
+void* BST_Cursor_Prev (BST_CURSOR* cursor);
+void* BST_Cursor_Data (BST_CURSOR* cursor);
+static void* _cursor_descend (BST_CURSOR* cursor, NODE* root, bool left);
+void* BST_Select (BST_TREE* tree, int index);
+int BST_Rank (BST_TREE* tree, void* keyPtr);
+void* BST_Cursor_Select (BST_CURSOR* cursor, int index);
+BST_TREE* BST_Add_Index (BST_TREE* tree, int (*compare) (void* argu1, void* argu2), const uint8_t mode);
+BST_TREE* BST_Get_Index (BST_TREE* tree, int index_num);
+static bool _index_insert (BST_TREE* tree, void* dataPtr);
+static void _index_delete (BST_TREE* tree, void* dataPtr);
+static bool _index_fill (BST_TREE* tree, BST_TREE* index);
+BST_TRIE* BST_Add_Trie_Index (BST_TREE* tree, const char* (*getStr) (void* argu));
+bool BST_Trie_Insert (BST_TRIE* trie, void* dataPtr);
+bool BST_Trie_Delete (BST_TRIE* trie, void* dataPtr);
+int BST_Trie_Prefix (BST_TRIE* trie, const char* prefix, void (*process) (void* dataPtr));
+int BST_Trie_Match (BST_TRIE* trie, const char* str, void (*process) (void* dataPtr));
+static BST_TRIE_NODE* _trie_seek (BST_TRIE* trie, const char* str, bool prefix);
+static int _trie_walk (BST_TRIE_NODE* root, void (*process) (void* dataPtr));
+static BST_TRIE_NODE* _trie_alloc (BST_TRIE* trie, int kind);
+static BST_TRIE_NODE** _trie_children (BST_TRIE_NODE* node, unsigned char** keys);
+static BST_TRIE_NODE** _trie_find_child (BST_TRIE_NODE* node, unsigned char edge);
+static bool _trie_add_child (BST_TRIE* trie, BST_TRIE_NODE** link, unsigned char edge, BST_TRIE_NODE* child);
+static void _trie_remove_child (BST_TRIE* trie, BST_TRIE_NODE** link, unsigned char edge);
+static bool _trie_resize (BST_TRIE* trie, BST_TRIE_NODE** link, int kind);
+static BST_TRIE_NODE* _trie_make_path (BST_TRIE* trie, BST_TRIE_NODE** link, const unsigned char* key);
+static void _trie_free_path (BST_TRIE* trie, BST_TRIE_NODE* node);
+static void _trie_merge (BST_TRIE* trie, BST_TRIE_NODE** link);
+static void _trie_clear (BST_TRIE* trie);
+static bool _trie_fill (BST_TREE* tree, BST_TRIE* trie);
+static inline uint32_t _hash_slot (BST_HASH* hash, int key);
+static void* _hash_find (BST_HASH* hash, int key);
+static bool _hash_reserve (BST_HASH* hash, int count);
+static void _hash_put (BST_HASH* hash, int key, void* dataPtr);
+static void _hash_remove (BST_HASH* hash, int key);
+static void _hash_clear (BST_HASH* hash);
+BST_FROZEN* BST_Freeze (BST_TREE* tree);
+static BST_FROZEN* _freeze (BST_TREE* tree);
+BST_FROZEN* BST_Frozen_Destroy (BST_FROZEN* frozen);
+static inline int _frozen_lower_bound (BST_FROZEN* frozen, int key);
+void* BST_Frozen_Retrieve (BST_FROZEN* frozen, void* keyPtr);
+int BST_Frozen_Seek (BST_FROZEN* frozen, void* keyPtr);
+int BST_Frozen_First (BST_FROZEN* frozen);
+int BST_Frozen_Next (BST_FROZEN* frozen, int k);
+int BST_Frozen_Last (BST_FROZEN* frozen);
+int BST_Frozen_Prev (BST_FROZEN* frozen, int k);
+void* BST_Frozen_Data (BST_FROZEN* frozen, int k);
+void BST_Frozen_Traverse (BST_FROZEN* frozen, void (*process) (void* dataPtr));
+static inline int _bit_ctz (unsigned int x);
+static inline int _bit_clz (unsigned int x);
+static inline int _bit_count (unsigned int x);
+static inline int _bplus_rank (const int* keys, int n, int key);
+static BST_BPLUS_NODE* _bplus_alloc (BST_TREE* tree, int leaf);
+static bool _bplus_insert (BST_TREE* tree, int key, void* dataPtr);
+static void* _bplus_delete (BST_TREE* tree, int key);
+static BST_BPLUS_NODE* _bplus_seek (BST_TREE* tree, int key, int* slot);
+static BST_BPLUS_NODE* _bplus_edge (BST_TREE* tree, bool first);
+static bool _bplus_build (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count);
+bool BST_Save (BST_TREE* tree, const char* path, size_t record_size);
+BST_TREE* BST_Open (const char* path, int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu), bool verify);
+static uint32_t _crc32c (uint32_t crc, const void* buf, size_t len);
+static void* _file_map (const char* path, size_t* size);
+static void _file_unmap (void* map, size_t size);
+bool BST_Journal_Open (BST_TREE* tree, const char* path, size_t record_size, int batch_ops, long batch_usec);
+bool BST_Journal_Sync (BST_TREE* tree);
+bool BST_Journal_Compact (BST_TREE* tree, const char* snapshot_path);
+bool BST_Journal_Close (BST_TREE* tree);
+static size_t _journal_replay (BST_TREE* tree, BST_JOURNAL* journal, const char* map, size_t map_size);
+static bool _journal_rewrite (BST_JOURNAL* journal, const void* bytes, size_t len);
+static bool _journal_reserve (BST_JOURNAL* journal);
+static void _journal_log (BST_JOURNAL* journal, uint32_t op, const void* dataPtr);
+static bool _journal_commit (BST_JOURNAL* journal, bool force);
+static bool _journal_cut (BST_JOURNAL* journal);
+static int _journal_flush (void* arg);
+#if defined(_WIN32) && !defined(BST_HAVE_THREADS_H)
+static unsigned __stdcall _thrd_start (void* start);
+int thrd_create (thrd_t* thr, thrd_start_t func, void* arg);
+int thrd_join (thrd_t thr, int* res);
+#endif
+static int64_t _journal_usec (void);
+static bool _file_sync (FILE* file);
+static bool _dir_sync (const char* path);
+int BST_ImportCSV (BST_TREE* tree, const char* path, char delim, size_t record_size,
+                   const char* (*parse) (char** fields, int num_fields, void* dataPtr),
+                   void (*reject) (long line_num, const char* reason), int* rejected);
+static inline int _compare_key (BST_TREE* tree, int key, void* dataPtr, NODE* node);
 static NODE* _insert (BST_TREE* tree, NODE* root, NODE* newPtr);
 static NODE* _delete (BST_TREE* tree, NODE* root, void* dataPtr, bool* success);
 static void* _retrieve (BST_TREE* tree, void* dataPtr, NODE* root);
 static void _traverse (NODE* root, void (*process) (void* dataPtr));
-static void _destroy (NODE* root);
+static bool _par_run (BST_PAR_JOB* job, int nthreads);
+static void _par_split_nodes (BST_PAR_JOB* job, NODE* root, int depth);
+static void _par_split_slots (BST_PAR_JOB* job, int k, int depth);
+static void _par_split_leaves (BST_PAR_JOB* job, int max_chunks);
+static void _par_split_words (BST_PAR_JOB* job, int max_chunks);
+static int _par_worker (void* arg);
+static int _par_take (BST_PAR_JOB* job, int worker);
+static void _par_walk (BST_PAR_JOB* job, int chunk);
+static inline void _par_visit (BST_PAR_JOB* job, int chunk, void* dataPtr);
+static void _destroy (BST_TREE* tree, NODE* root);
+static int _height (NODE* root);
+static int _size (NODE* root);
+static void _update_node (NODE* root);
+static NODE* _rotate_left (NODE* root);
+static NODE* _rotate_right (NODE* root);
+static NODE* _rebalance (BST_TREE* tree, NODE* root);
+static void _stack_init (BST_STACK* stack);
+static bool _stack_push (BST_STACK* stack, NODE* node);
+static NODE* _stack_pop (BST_STACK* stack);
+static void _stack_free (BST_STACK* stack);
+static void _pool_init (BST_POOL* pool, size_t obj_size);
+static bool _pool_grow (BST_POOL* pool);
+static void* _pool_alloc (BST_POOL* pool);
+static void _pool_free (BST_POOL* pool, void* objPtr);
+static void _pool_destroy (BST_POOL* pool);
+static void* _arena_alloc (BST_ARENA* arena, size_t size);
+static void _arena_reset (BST_ARENA* arena);
+static void _arena_free (BST_ARENA* arena);
+static inline NODE* _root (BST_TREE* tree);
+static NODE* _cow (BST_TREE* tree, NODE* node);
+static void _rcu_retire (BST_TREE* tree, void* objPtr, bool node);
+static bool _rcu_write_begin (BST_TREE* tree, int copies);
+static void _rcu_write_end (BST_TREE* tree);
+static void _rcu_synchronize (BST_RCU* rcu);
+static void _rcu_reclaim (BST_TREE* tree);
+static bool _rcu_init (BST_TREE* tree);
+static void _rcu_free (BST_TREE* tree);
+static BST_RCU_SLOT* _rcu_slot (BST_RCU* rcu);
+static void _rcu_slot_lock (BST_RCU_SLOT* slot);
+static void _rcu_slot_unlock (BST_RCU_SLOT* slot);
+static bool _lf_init (BST_TREE* tree);
+static BST_LF_NODE* _lf_alloc (BST_TREE* tree, int key, int inf, void* dataPtr);
+static void _lf_free (BST_TREE* tree, BST_LF_NODE* node);
+static inline bool _lf_less (int key, BST_LF_NODE* node);
+static void _lf_seek (BST_TREE* tree, int key, BST_LF_SEEK* seek);
+static bool _lf_insert (BST_TREE* tree, void* dataPtr);
+static bool _lf_delete (BST_TREE* tree, void* dltKey);
+static bool _lf_cleanup (BST_TREE* tree, int key, BST_LF_SEEK* seek);
+static void _lf_unlink (BST_TREE* tree, int key, BST_LF_NODE* node, BST_LF_NODE* parent, BST_LF_NODE* kept);
+static void _lf_retire (BST_TREE* tree, BST_LF_NODE* node, bool with_data);
+static void _lf_reclaim (BST_TREE* tree);
+static void* _lf_retrieve (BST_TREE* tree, void* keyPtr);
+static BST_LF_NODE* _lf_next (BST_TREE* tree, const int* after);
+static void _lf_destroy (BST_TREE* tree);
 
 // Prototype Declarations
 char getOption (void);
@@ -87,8 +891,40 @@ void addStu (BST_TREE* list);
 void deleteStu (BST_TREE* list);
 void findStu (BST_TREE* list);
 void printList (BST_TREE* list);
+void printRange (BST_TREE* list);
+void printPage (BST_TREE* list);
+void printTopStu (BST_TREE* list);
+void printBelowGpa (BST_TREE* list);
+void printStats (BST_TREE* list);
+void mapStuStats (void* acc, void* dataPtr);
+void combineStuStats (void* acc, void* other);
+void findStuPrefix (BST_TREE* list);
+void findStuName (BST_TREE* list);
+void loadStu (BST_TREE* list, FILE* report);
+void saveStu (BST_TREE* list, FILE* report);
+bool importStu (BST_TREE* list, const char* path);
+const char* parseStuRow (char** fields, int num_fields, void* stuPtr);
+void rejectStuRow (long line_num, const char* reason);
+long batchStu (BST_TREE* list, FILE* in, long* failed);
+const char* batchCmd (BST_TREE* list, char* line);
+void batchPutStu (void* stuPtr);
+bool batchFlush (void);
 void testUtilties (BST_TREE* tree);
+int benchEngines (int max_count);
+void benchVisit (void* dataPtr);
+int benchParsers (int count);
+int benchReaders (int max_count);
+int benchReader (void* arg);
+int benchWriters (int max_count);
+int benchWriter (void* arg);
+int benchParallel (int max_count);
+void benchSumMap (void* acc, void* dataPtr);
+void benchSumCombine (void* acc, void* other);
+int benchTeardown (int max_count);
 int compareStu (void* stu1, void* stu2);
+int getStuKey (void* stuPtr);
+int compareStuGpa (void* stu1, void* stu2);
+const char* getStuName (void* stuPtr);
 void processStu (void* dataPtr);
 uint16_t Get_Validate_Input_Float(float *const float_input_num_ptr, char *const input_str_ptr, const unsigned int input_str_max_chars, const float valid_min_value, const float valid_max_value);
 uint16_t Get_Validate_Input_Double(double *const double_input_num_ptr, char *const input_str_ptr, const unsigned int input_str_max_chars, const double valid_min_value, const double valid_max_value);
@@ -96,649 +932,8479 @@ uint16_t Get_Validate_Input_Number(void *const int32_input_num_ptr, char *const
 uint16_t Get_Input_Str(char *const input_str_ptr, const unsigned int input_str_max_chars);
 uint16_t Str_to_Num_Conv(void *const num_conv_from_str_ptr, const char *const num_in_str);
 uint32_t Power_Of(const uint8_t base, const uint8_t power);
+uint16_t Str_to_Num_Range(int32_t *const num_ptr, const char *const num_in_str, const size_t num_chars, const int32_t valid_min_value, const int32_t valid_max_value);
+uint16_t Str_to_Float_Range(float *const float_num_ptr, const char *const float_in_str, const size_t num_chars, const float valid_min_value, const float valid_max_value);
+static size_t _parse_digits(const char *const digit_str, const size_t num_chars, const size_t max_digits, uint64_t *const num_ptr);
 uint16_t Get_Input_Alpha_Char_Str(char *const input_str_ptr, const unsigned int input_str_max_chars);
 char temp_str[STR_MAX_NUM_CHARS];
+long bench_sum = 0;
+char* batch_out = NULL;
+size_t batch_out_used = 0;
+bool batch_out_failed = false;
+atomic_int bench_readers_left = 0;
+
+/* three way compare for scalar keys, usable as the cmp argument of BST_DEFINE */
+#define BST_CMP_NUM(a, b)             (((a) > (b)) - ((a) < (b)))
+
+/* ======================================================================
+  BST_DEFINE(name, key_t, cmp) generates an AVL tree specialised on key_t
+  and a three way compare macro cmp(a, b), so each level of a descent is one
+  inlined compare instead of a call through tree->compare. Keys live in the
+  node. The tree does not own its records: name##_Delete returns the record,
+  name##_Destroy leaves the records alone.
+  e.g. BST_DEFINE(Stu, int, BST_CMP_NUM) gives Stu_TREE, Stu_Create,
+  Stu_Insert, Stu_Retrieve, Stu_Delete, Stu_Traverse, Stu_Count, Stu_Destroy.
+====================================================================== */
+#define BST_DEFINE(name, key_t, cmp) \
+typedef struct name##_node \
+{ \
+	key_t key; \
+	int height; \
+	void *dataPtr; \
+	struct name##_node *left; \
+	struct name##_node *right; \
+} name##_NODE; \
+\
+typedef struct \
+{ \
+	int count; \
+	name##_NODE *root; \
+	BST_POOL node_pool; \
+} name##_TREE; \
+\
+static inline int name##_height (name##_NODE* root) \
+{ \
+    return (root ? root->height : 0); \
+} \
+\
+static inline void name##_update_height (name##_NODE* root) \
+{ \
+    int left_height = name##_height(root->left), right_height = name##_height(root->right); \
+    root->height = 1 + (left_height > right_height ? left_height : right_height); \
+} \
+\
+static inline name##_NODE* name##_rotate (name##_NODE* root, bool left) \
+{ \
+    name##_NODE* newRoot; \
+    if (left) \
+    { \
+        newRoot = root->right; \
+        root->right = newRoot->left; \
+        newRoot->left = root; \
+    } \
+    else \
+    { \
+        newRoot = root->left; \
+        root->left = newRoot->right; \
+        newRoot->right = root; \
+    } \
+    name##_update_height(root); \
+    name##_update_height(newRoot); \
+    return newRoot; \
+} \
+\
+static inline name##_NODE* name##_rebalance (name##_NODE* root) \
+{ \
+    int balance; \
+    name##_update_height(root); \
+    balance = name##_height(root->left) - name##_height(root->right); \
+    if (balance > 1) \
+    { \
+        if (name##_height(root->left->left) < name##_height(root->left->right)) \
+           root->left = name##_rotate(root->left, true); \
+        return name##_rotate(root, false); \
+    } \
+    if (balance < -1) \
+    { \
+        if (name##_height(root->right->right) < name##_height(root->right->left)) \
+           root->right = name##_rotate(root->right, false); \
+        return name##_rotate(root, true); \
+    } \
+    return root; \
+} \
+\
+static inline void name##_retrace (name##_NODE** path[], int depth) \
+{ \
+    int old_height; \
+    while (depth > 0) \
+    { \
+        name##_NODE** link = path[--depth]; \
+        old_height = (*link)->height; \
+        *link = name##_rebalance(*link); \
+        if ((*link)->height == old_height) \
+           break; \
+    } \
+} \
+\
+static inline name##_TREE* name##_Create (void) \
+{ \
+    name##_TREE* tree = (name##_TREE*) calloc (1, sizeof (name##_TREE)); \
+    if (tree) \
+       _pool_init(&tree->node_pool, sizeof (name##_NODE)); \
+    return tree; \
+} \
+\
+static inline bool name##_Insert (name##_TREE* tree, key_t key, void* dataPtr) \
+{ \
+    name##_NODE** path[BST_MAX_HEIGHT]; \
+    name##_NODE** link = &tree->root; \
+    name##_NODE* newPtr; \
+    int depth = 0; \
+    newPtr = (name##_NODE*) _pool_alloc(&tree->node_pool); \
+    if (!newPtr) \
+       return false; \
+    newPtr->key = key; \
+    newPtr->height = 1; \
+    newPtr->dataPtr = dataPtr; \
+    newPtr->left = newPtr->right = NULL; \
+    while (*link) \
+    { \
+        path[depth++] = link; \
+        link = (cmp(key, (*link)->key) < 0) ? &(*link)->left : &(*link)->right; \
+    } \
+    *link = newPtr; \
+    name##_retrace(path, depth); \
+    ++tree->count; \
+    return true; \
+} \
+\
+static inline void* name##_Retrieve (name##_TREE* tree, key_t key) \
+{ \
+    name##_NODE* root = tree->root; \
+    int c; \
+    while (root) \
+    { \
+        c = cmp(key, root->key); \
+        if (c == 0) \
+           return root->dataPtr; \
+        root = (c < 0) ? root->left : root->right; \
+    } \
+    return NULL; \
+} \
+\
+static inline void* name##_Delete (name##_TREE* tree, key_t key) \
+{ \
+    name##_NODE** path[BST_MAX_HEIGHT]; \
+    name##_NODE** link = &tree->root; \
+    name##_NODE** exchLink; \
+    name##_NODE* dltPtr; \
+    void* dataPtr; \
+    int depth = 0, c = 0; \
+    while (*link && (c = cmp(key, (*link)->key)) != 0) \
+    { \
+        path[depth++] = link; \
+        link = (c < 0) ? &(*link)->left : &(*link)->right; \
+    } \
+    if (!*link) \
+       return NULL; \
+    dltPtr = *link; \
+    dataPtr = dltPtr->dataPtr; \
+    if (!dltPtr->left) \
+       *link = dltPtr->right; \
+    else if (!dltPtr->right) \
+       *link = dltPtr->left; \
+    else \
+    { \
+        path[depth++] = link; \
+        exchLink = &dltPtr->left; \
+        while ((*exchLink)->right) \
+        { \
+            path[depth++] = exchLink; \
+            exchLink = &(*exchLink)->right; \
+        } \
+        dltPtr->key = (*exchLink)->key; \
+        dltPtr->dataPtr = (*exchLink)->dataPtr; \
+        dltPtr = *exchLink; \
+        *exchLink = dltPtr->left; \
+    } \
+    _pool_free(&tree->node_pool, dltPtr); \
+    name##_retrace(path, depth); \
+    --tree->count; \
+    return dataPtr; \
+} \
+\
+static inline void name##_Traverse (name##_TREE* tree, void (*process) (void* dataPtr)) \
+{ \
+    name##_NODE* stack[BST_MAX_HEIGHT]; \
+    name##_NODE* root = tree->root; \
+    int top = 0; \
+    while (root || top > 0) \
+    { \
+        while (root) \
+        { \
+            stack[top++] = root; \
+            root = root->left; \
+        } \
+        root = stack[--top]; \
+        process(root->dataPtr); \
+        root = root->right; \
+    } \
+} \
+\
+static inline int name##_Count (name##_TREE* tree) \
+{ \
+    return tree->count; \
+} \
+\
+static inline name##_TREE* name##_Destroy (name##_TREE* tree) \
+{ \
+    if (tree) \
+       _pool_destroy(&tree->node_pool); \
+    free (tree); \
+    return NULL; \
+}
+
+/* the student tree specialised on its int id; benchEngines times it against the generic engines */
+BST_DEFINE(Stu, int, BST_CMP_NUM)
+
 /*******************************************************************
  Function Name  : BST_Create
  Description    : Allocates dynamic memory for an BST tree head
                   node and returns its address to caller
  Pre            : compare is address of compare function used when two nodes need to be compared
+                  mode is BST_MODE_BASIC for a plain BST or BST_MODE_AVL for a
+                  height balanced (AVL) tree
  Post           : head allocated or error returned Return head node pointer; null if overflow
- Remarks        :
+ Remarks        : in BST_MODE_AVL, tree height is kept at O(log n) for any insert order
  Func ID        : 1
 *******************************************************************/
-BST_TREE* BST_Create (int (*compare) (void* argu1, void* argu2))
+BST_TREE* BST_Create (int (*compare) (void* argu1, void* argu2), const uint8_t mode)
+{
+     return BST_Create_Key (compare, NULL, mode & ~BST_MODE_INLINE_KEY);
+}
+
+/*******************************************************************
+ Function Name  : BST_Create_Key
+ Description    : Allocates dynamic memory for an BST tree head whose nodes
+                  may carry the integer key of their data inline.
+ Pre            : compare is address of compare function used when two nodes need to be compared
+                  getKey is address of function returning the integer key of data (or of a
+                  key structure passed to BST_Retrieve/BST_Delete); null if not BST_MODE_INLINE_KEY
+                  mode is BST_MODE_BASIC or BST_MODE_AVL, or'ed with BST_MODE_INLINE_KEY
+                  and/or BST_MODE_ORDER_STAT (subtree counts for BST_Select/BST_Rank);
+                  or BST_MODE_BPLUS | BST_MODE_INLINE_KEY for the B+ engine.
+                  BST_MODE_AVL may also be or'ed with BST_MODE_CONCURRENT; or
+                  BST_MODE_CONCURRENT | BST_MODE_INLINE_KEY for the lock-free engine
+ Post           : head allocated or error returned Return head node pointer; null if overflow
+ Remarks        : in BST_MODE_INLINE_KEY, the key is copied into the node on insert and a
+                  descent compares it directly, touching one cache line per level; the
+                  key order must agree with compare. BST_MODE_BPLUS keeps unique keys
+                  BST_BPLUS_KEYS to a node and keeps no subtree counts.
+                  In BST_MODE_CONCURRENT, any number of threads may retrieve, traverse and
+                  (inside BST_Read_Lock) use cursors while inserts, deletes, builds and
+                  BST_Freeze run one at a time under a writer lock. Readers never wait:
+                  a writer copies the path it changes and publishes the new root, and
+                  frees what it replaced once every reader that could see it is gone.
+                  Such a tree takes no hash or secondary index; the journal calls and
+                  BST_Destroy must not overlap other calls.
+                  The lock-free engine lets threads insert, delete, retrieve and traverse
+                  all at once: an unbalanced external tree whose leaves hold unique
+                  int keys, changed by compare and swap. It keeps no subtree counts and
+                  takes no cursor, build, snapshot or journal
+ Func ID        : 40
+*******************************************************************/
+BST_TREE* BST_Create_Key (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu), const uint8_t mode)
 {
      BST_TREE* tree;
 
+     if ((mode & BST_MODE_INLINE_KEY) && !getKey)
+        return NULL;
+     // the hash side index hashes the inline key
+     if ((mode & BST_MODE_HASH) && !(mode & BST_MODE_INLINE_KEY))
+        return NULL;
+     // the B+ engine searches its nodes' packed int keys
+     if ((mode & BST_MODE_BPLUS) && (!(mode & BST_MODE_INLINE_KEY) || (mode & BST_MODE_ORDER_STAT)))
+        return NULL;
+     // readers of a concurrent tree only see the AVL nodes its writers copy or the
+     // lock-free engine's, which search int keys
+     if ((mode & BST_MODE_CONCURRENT) && ((mode & (BST_MODE_HASH | BST_MODE_BPLUS))
+         || (!(mode & BST_MODE_AVL) && (!(mode & BST_MODE_INLINE_KEY) || (mode & BST_MODE_ORDER_STAT)))))
+        return NULL;
      tree = (BST_TREE*) calloc (1, sizeof (BST_TREE));
      if (tree)
      {
         tree->root = NULL;
         tree->count = 0;
         tree->compare = compare;
+        tree->getKey = getKey;
+        tree->mode = mode;
+        _pool_init(&tree->node_pool, (mode & BST_MODE_BPLUS) ? sizeof (BST_BPLUS_NODE) : sizeof (NODE));
+        _pool_init(&tree->data_pool, 0);
+        _hash_clear(&tree->hash);
+     }
+     if (tree && (mode & BST_MODE_CONCURRENT) && !_rcu_init (tree))
+     {
+        free (tree);
+        tree = NULL;
      }
 	 if(trace_flag)
 	 {
-		 printf("\n BST Meta Head Ptr : 0X%X", tree);
+		 printf("\n BST Meta Head Ptr : %p", (void *)tree);
 	 }
      return tree;
 }
 
 /*******************************************************************
- Function Name  : BST_Insert
- Description    : inserts new data into the tree.
- Pre            : tree is pointer to BST tree structure
- Post           : data inserted or memory overflow and Return Success (true) or Overflow (false)
- Remarks        :
- Func ID        : 2
+ Function Name  : BST_Create_Arena
+ Description    : Creates a tree whose nodes and records come from one arena.
+ Pre            : as BST_Create_Key, without BST_MODE_CONCURRENT. destroy, if not null,
+                  releases what a record owns (not the record itself)
+ Post           : Return head pointer; null if overflow or the mode is not allowed
+ Remarks        : nodes and records from BST_Alloc_Data are carved from a few large
+                  blocks, so BST_Destroy frees the blocks and BST_Clear rewinds them
+                  without visiting a node. With destroy set, those two still walk the
+                  records once to call it, and BST_Free_Data (so BST_Delete) calls it
+                  before recycling a record. Secondary indexes, trie and hash keep their
+                  own memory
+ Func ID        : 198
 *******************************************************************/
-bool BST_Insert(BST_TREE* tree, void* dataPtr)
+BST_TREE* BST_Create_Arena (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                            const uint8_t mode, void (*destroy) (void* dataPtr))
 {
-    // Local Definitions
-    NODE* newPtr;
+    BST_TREE* tree;
 
-    newPtr = (NODE*)calloc(1, sizeof(NODE));
-    if (!newPtr)
-       return false;
-    newPtr->right = NULL;
-    newPtr->left = NULL;
-    newPtr->dataPtr = dataPtr;
-    if (tree->count == 0)
-	{
-       tree->root = newPtr;
-	   if(trace_flag)
-		    printf("\n Insert in Empty Tree - tree->root : 0X%X",  tree->root);
-	}
-    else
-      _insert(tree, tree->root, newPtr);
-    (tree->count)++;
-    return true;
+    if (mode & BST_MODE_CONCURRENT)
+       return NULL;
+    tree = BST_Create_Key (compare, getKey, mode);
+    if (!tree)
+       return NULL;
+    tree->arena = (BST_ARENA*) calloc (1, sizeof (BST_ARENA));
+    if (!tree->arena)
+       return BST_Destroy (tree);
+    tree->arena->next_size = BST_ARENA_MIN_BLOCK;
+    tree->arena->destroy = destroy;
+    tree->node_pool.arena = tree->arena;
+    return tree;
 }
 
 /*******************************************************************
- Function Name  : _insert
- Description    : recursion to insert the new data into a leaf node in the BST tree.
- Pre            : Application has called BST_Insert, which passes root and data pointer
- Post           : Data have been inserted and Return pointer to [potentially] new root
- Remarks        :
- Func ID        : 3
+ Function Name  : BST_Create_Sharded
+ Description    : Creates a tree split by key range into independently locked shards.
+ Pre            : compare and getKey as for BST_Create_Key (getKey may not be null), and
+                  mode as for a BST_MODE_CONCURRENT tree, which each shard is. splits
+                  holds num_shards - 1 keys in non decreasing order (see BST_Shard_Splits);
+                  1 <= num_shards <= BST_MAX_SHARDS
+ Post           : Return head pointer; null if overflow or the mode or splits are not allowed
+ Remarks        : shard i holds the keys from splits[i - 1] up to, not including,
+                  splits[i]. BST_Insert, BST_Delete and BST_Retrieve go to the shard of
+                  the key, so writers to different shards never wait for each other, and
+                  BST_Traverse, BST_Count, BST_Select and BST_Rank stitch the shards
+                  together in key order. Records are the tree's as in any concurrent
+                  tree; one from BST_Retrieve is safe to use after the call inside a
+                  BST_Read_Lock of BST_Get_Shard. BST_Read_Lock of the sharded tree
+                  itself fails. A sharded tree takes no index, cursor,
+                  build, snapshot, journal, parallel walk or BST_Clear
+ Func ID        : 205
 *******************************************************************/
-NODE* _insert (BST_TREE* tree, NODE* root, NODE* newPtr)
+BST_TREE* BST_Create_Sharded (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                              const uint8_t mode, int num_shards, const int* splits)
 {
-   if (!root)
-      // if NULL tree
-      return newPtr;
-   // Locate null subtree for insertion
-   if (tree->compare(newPtr->dataPtr, root->dataPtr) < 0)
-   {
-      root->left = _insert(tree, root->left, newPtr);
-	  if(trace_flag)
-	  {
-		  printf("\n TRACE[03.01]: root : 0X%X, root->left: 0X%X, NewPtr: 0X%X", root, root->left, newPtr);
-	  }
-      return root;
-   } // new < node
-   else
-    // new data >= root data
-   {
-       root->right = _insert(tree, root->right, newPtr);
-	   if(trace_flag)
-	   {
-	         printf("\n TRACE[03.02]: root : 0X%X, root->right: 0X%X, NewPtr: 0X%X", root, root->right, newPtr);
-	   }
-       return root;
-   } // else new data == root data
-   return root;
+    BST_TREE* tree;
+    BST_SHARDS* shards;
+    int i;
+
+    if (!getKey || num_shards < 1 || num_shards > BST_MAX_SHARDS || (num_shards > 1 && !splits))
+       return NULL;
+    for (i = 1; i < num_shards - 1; ++i)
+    {
+        if (splits[i] < splits[i - 1])
+           return NULL;
+    }
+    tree = BST_Create_Key (compare, getKey, mode & ~BST_MODE_CONCURRENT);
+    if (!tree)
+       return NULL;
+    shards = (BST_SHARDS*) calloc (1, sizeof (BST_SHARDS));
+    if (!shards)
+       return BST_Destroy (tree);
+    tree->shards = shards;
+    for (i = 0; i < num_shards; ++i)
+    {
+        shards->trees[i] = BST_Create_Key (compare, getKey, mode | BST_MODE_CONCURRENT);
+        if (!shards->trees[i])
+           return BST_Destroy (tree);
+        shards->num_shards = i + 1;
+        if (i < num_shards - 1)
+           shards->splits[i] = splits[i];
+    }
+    if(trace_flag)
+       printf("\n TRACE[205.01]: %d shards", num_shards);
+    return tree;
 }
 
 /*******************************************************************
- Function Name  : BST_Delete
- Description    : deletes a node from the tree and rebalances it if necessary.
- Pre            : tree initialized--null tree is OK dltKey is pointer to data structure
-                   containing key to be deleted
- Post           : node deleted and its space recycled -or- An error code is returned. Return Success (true) or Not found (false)
- Remarks        :
- Func ID        : 4
+ Function Name  : BST_Shard_Splits
+ Description    : Picks split keys for BST_Create_Sharded from a sample of keys.
+ Pre            : keys holds num_keys sampled keys; splits has room for num_shards - 1
+ Post           : keys sorted. splits holds the keys cutting the sample into num_shards
+                  parts of about equal size. Return the number of shards they make, at
+                  most num_shards; fewer if the sample has too few distinct keys
+ Remarks        : a key repeated across a cut moves the cut past it, so no shard is empty
+                  in the sample
+ Func ID        : 206
 *******************************************************************/
-bool BST_Delete(BST_TREE* tree, void* dltKey)
+int BST_Shard_Splits (int* keys, int num_keys, int num_shards, int* splits)
 {
-    bool success;
-    NODE* newRoot;
+    int i, k, used = 0;
 
-    newRoot = _delete (tree, tree->root, dltKey, &success);
-    if (success)
+    if (num_keys <= 0 || num_shards <= 1)
+       return 1;
+    if (num_shards > BST_MAX_SHARDS)
+       num_shards = BST_MAX_SHARDS;
+    qsort (keys, (size_t)num_keys, sizeof (int), _compare_int);
+    for (i = 1; i < num_shards; ++i)
     {
-       tree->root = newRoot;
-	   if(trace_flag)
-		   printf("\n TRACE[04.01]: tree->root : 0X%X", tree->root);
-       (tree->count)--;
-       if (tree->count == 0)
-	   {
-          // Tree now empty
-          tree->root = NULL;
-	   }
-     } // if
-     return success;
+        k = (int)((long)i * num_keys / num_shards);
+        // a cut must move past the last one and start a new key
+        if (used && keys[k] <= splits[used - 1])
+           continue;
+        if (keys[k] == keys[0])
+           continue;
+        splits[used++] = keys[k];
+    }
+    return used + 1;
 }
 
 /*******************************************************************
- Function Name  : _delete
- Description    : Deletes node from the tree and rebalances tree if necessary.
- Pre            : tree initialized--null tree is OK. dataPtr contains key of node to be deleted
- Post           : node is deleted and its space recycled. -or- if key not found, tree is unchanged
-                  success is true if deleted; false if not Return pointer to root
- Remarks        :
- Func ID        : 5
+ Function Name  : BST_Get_Shard
+ Description    : Returns the shard that holds or would hold a key.
+ Pre            : tree has been created
+ Post           : Return the shard of the key; tree itself if it is not sharded
+ Remarks        : take a BST_Read_Lock of the shard to use a record it returns
+ Func ID        : 207
 *******************************************************************/
-NODE* _delete (BST_TREE* tree, NODE* root, void* dataPtr, bool* success)
+BST_TREE* BST_Get_Shard (BST_TREE* tree, void* keyPtr)
 {
-    // Local Definitions
-     NODE* dltPtr;
-     NODE* exchPtr;
-     NODE* newRoot;
-     void* holdPtr;
-
-     if (!root)
-     {
-        *success = false;
-        return NULL;
-     } // if
-     if (tree->compare(dataPtr, root->dataPtr) < 0)
-	 {
-         root->left = _delete (tree, root->left, dataPtr, success);
-		 if(trace_flag)
-			 printf("\n TRACE[05.01]: < 0 in root : 0X%X, root->left: 0X%X", root, root->left);
-	 }
-     else if (tree->compare(dataPtr, root->dataPtr) > 0)
-	 {
-        root->right = _delete (tree, root->right, dataPtr, success);
-		 if(trace_flag)
-			 printf("\n TRACE[05.02]: > 0 in root: 0X%X, root->right: 0X%X", root, root->right);
-	 }
-     else
-       {
-		    // Delete node found--test for leaf node
-           dltPtr = root;
-		   if(trace_flag)
-			   printf("\n TRACE[05.04]: delete node found - dltPtr: 0X%X", dltPtr);
-           if (!root->left)
-           {
-			   // No left subtree
-			   if(trace_flag)
-			        printf("\n TRACE[05.05]: no left subtree - delete data: 0X%X", root->dataPtr);
-               free (root->dataPtr); // data memory
-               newRoot = root->right;
-			    if(trace_flag)
-			        printf("\n TRACE[05.06]: root: 0X%X, root->right: 0X%X, Delete Node: 0X%X", root, newRoot, dltPtr );
-               free (dltPtr); // BST Node
-               *success = true;
-               return newRoot; // base case
-           }   // if true
-           else
-		   {
-			   if (!root->right)
-                {
-			  // Only left subtree
-                    newRoot = root->left;
-					if(trace_flag)
-			             printf("\n TRACE[05.07]: only left subtree - root: 0X%X, root->left: 0X%X, dltPtr: 0X%X", root, root->left, dltPtr);
-                    free (dltPtr);
-                    *success = true;
-                    return newRoot; // base case
-              } // if
-              else
-                 // Delete Node has two subtrees
-              {
-				  if(trace_flag)
-			             printf("\n TRACE[05.08]: delete node has two subtrees - root: 0X%X, root->left: 0X%X", root, root->left );
-                  exchPtr = root->left;
-                 // Find largest node on left subtree
-                  while (exchPtr->right)
-                       exchPtr = exchPtr->right;
-                   // Exchange Data
-				  if(trace_flag)
-			             printf("\n TRACE[05.09]: largest data on left subtree: 0X%X", exchPtr);
-                  holdPtr = root->dataPtr;
-                  root->dataPtr = exchPtr->dataPtr;
-                  exchPtr->dataPtr = holdPtr;
-				  if(trace_flag)
-			             printf("\n TRACE[05.10]: exchange data : 0X%X <-> 0X%X, root: 0X%X, root->left:0X%X",root->dataPtr, holdPtr, root, root->left);
-                  root->left = _delete (tree, root->left, exchPtr->dataPtr, success);
-               } // else
-         }
-	 }		// node found
-    return root;
+    if (!tree->shards)
+       return tree;
+    return tree->shards->trees[_shard_index (tree->shards, tree->getKey (keyPtr))];
 }
 
 /*******************************************************************
- Function Name  : BST_Retrieve
- Description    : Retrieve node searches tree for the node containing
-                  the requested key and returns pointer to its data.
- Pre            : Tree has been created (may be null) data is pointer to data structure
-                   containing key to be located
- Post           :  Tree searched and data pointer returned Return Address of matching node returned.
-                   If not found, NULL returned
- Remarks        :
- Func ID        : 6
+ Function Name  : _shard_index
+ Description    : Finds the shard of a key.
+ Pre            : shards of a BST_Create_Sharded tree
+ Post           : Return index of the first shard whose split is above the key
+ Remarks        : binary search of the splits; they fit in a few cache lines
+ Func ID        : 208
 *******************************************************************/
-void* BST_Retrieve (BST_TREE* tree, void* keyPtr)
+static inline int _shard_index (BST_SHARDS* shards, int key)
 {
+    int lo = 0, hi = shards->num_shards - 1, mid;
 
-if (tree->root)
-    return _retrieve (tree, keyPtr, tree->root);
-else
-    return NULL;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (key < shards->splits[mid])
+           hi = mid;
+        else
+           lo = mid + 1;
+    }
+    return lo;
 }
 
 /*******************************************************************
- Function Name  : _retrieve
- Description    : Searches tree for node containing requested key
-                  and returns its data to the calling function.
- Pre            : _retrieve passes tree, dataPtr, root, dataPtr is pointer to data structure
-                   containing key to be located
- Post           :  tree searched; data pointer returned Return Address of data in matching node.
-                   If not found, NULL returned
+ Function Name  : _compare_int
+ Description    : qsort order of ints.
+ Pre            : argu1 and argu2 point to ints
+ Post           : Return <0, 0 or >0 as *argu1 is below, equal to or above *argu2
  Remarks        :
- Func ID        : 7
+ Func ID        : 209
 *******************************************************************/
-void* _retrieve (BST_TREE* tree, void* dataPtr, NODE* root)
+int _compare_int (const void* argu1, const void* argu2)
 {
-    if (root)
-	{
-         if (tree->compare(dataPtr, root->dataPtr) < 0)
-		 {
-			 if(trace_flag)
-			      printf("\n TRACE[07.01]: < 0 dataPtr: 0X%X, root: 0X%X, root->left: 0X%X", dataPtr, root, root->left );
-            return _retrieve(tree, dataPtr, root->left);
-		 }
-         else if (tree->compare(dataPtr, root->dataPtr) > 0)
-		 {
-			if(trace_flag)
-			      printf("\n TRACE[07.02]: > 0 dataPtr: 0X%X, root: 0X%X, root->right: 0X%X", dataPtr, root, root->right );
-            return _retrieve(tree, dataPtr, root->right);
-		 }
-          else
-		  {
-			   // Found equal key
-			  if(trace_flag)
-			      printf("\n TRACE[07.03]: = 0 root: 0X%X, dataPtr: 0X%X", root, root->dataPtr);
-            return root->dataPtr;
-		  }
-    } // if root
-    else
-     // Data not in tree
-      return NULL;
+    int a = *(const int*)argu1, b = *(const int*)argu2;
+
+    return (a > b) - (a < b);
 }
 
 /*******************************************************************
- Function Name  : BST_Traverse
- Description    : Process tree using inorder traversal.
- Pre            : Tree has been created (may be null) process “visits” nodes during traversal
- Post           : Nodes processed in LNR (inorder) sequence
- Remarks        :
- Func ID        : 8
+ Function Name  : BST_Create_Dense
+ Description    : Creates a tree for keys in [lo_key, hi_key], stored in an array indexed
+                  by key when the domain is small and dense enough.
+ Pre            : compare and getKey as for BST_Create_Key (getKey may not be null), mode
+                  as for BST_Create_Key. expected is about how many keys the tree will
+                  hold; 0 if not known
+ Post           : Return head pointer; null if overflow, lo_key > hi_key or the mode is not
+                  allowed
+ Remarks        : the dense engine is taken when the domain has at most BST_DENSE_MAX_KEYS
+                  keys (and its slot array fits a size_t) and at most
+                  BST_DENSE_MAX_SLOTS_PER_KEY per expected key, and the mode is not
+                  BST_MODE_CONCURRENT; otherwise this is BST_Create_Key. It keeps
+                  a data pointer per key and a bitmap of the keys present: retrieve, insert
+                  and delete are O(1), and walks, cursors, BST_Select and BST_Rank scan the
+                  bitmap a word at a time. Keys are unique and a key outside the domain is
+                  refused. BST_MODE_HASH and BST_MODE_BPLUS are dropped, as they would only
+                  index the array again
+ Func ID        : 210
 *******************************************************************/
-void BST_Traverse (BST_TREE* tree, void (*process) (void* dataPtr))
+BST_TREE* BST_Create_Dense (int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu),
+                            const uint8_t mode, int lo_key, int hi_key, int expected)
 {
-	// Statements
-    _traverse (tree->root, process);
-     return;
+    BST_TREE* tree;
+    BST_DENSE* dense;
+    int64_t num_slots = (int64_t)hi_key - lo_key + 1;
+
+    if (!getKey || lo_key > hi_key)
+       return NULL;
+    // a domain the slot array cannot be sized for is never allocated
+    if ((mode & BST_MODE_CONCURRENT) || num_slots > BST_DENSE_MAX_KEYS
+        || (uint64_t)num_slots > SIZE_MAX / sizeof (void*)
+        || (expected > 0 && num_slots > (int64_t)expected * BST_DENSE_MAX_SLOTS_PER_KEY))
+    {
+       if(trace_flag)
+          printf("\n TRACE[210.01]: %" PRId64 " keys for %d expected: tree", num_slots, expected);
+       return BST_Create_Key (compare, getKey, mode);
+    }
+    tree = BST_Create_Key (compare, getKey, (mode | BST_MODE_INLINE_KEY) & ~(BST_MODE_HASH | BST_MODE_BPLUS));
+    if (!tree)
+       return NULL;
+    dense = (BST_DENSE*) calloc (1, sizeof (BST_DENSE));
+    if (!dense)
+       return BST_Destroy (tree);
+    tree->dense = dense;
+    dense->lo = lo_key;
+    dense->num_slots = (int)num_slots;
+    dense->num_words = (int)((num_slots + 31) >> 5);
+    dense->bits = (unsigned int*) calloc ((size_t)dense->num_words, sizeof (unsigned int));
+    dense->slots = (void**) malloc ((size_t)num_slots * sizeof (void*));
+    if (!dense->bits || !dense->slots)
+       return BST_Destroy (tree);
+    return tree;
 }
+
 /*******************************************************************
- Function Name  : _traverse
- Description    : Inorder tree traversal. To process a node, we use
-                  the function passed when traversal was called.
- Pre            : Tree has been created (may be null)
- Post           : All nodes processed
+ Function Name  : _dense_slot
+ Description    : Finds the slot of a key in a dense tree.
+ Pre            : dense of a BST_Create_Dense tree
+ Post           : Return slot of key; -1 if the key is outside the domain
  Remarks        :
- Func ID        : 9
+ Func ID        : 211
 *******************************************************************/
-void _traverse (NODE* root, void (*process) (void* dataPtr))
+static inline int _dense_slot (BST_DENSE* dense, int key)
 {
-     if (root)
-     {
-		 if(trace_flag)
-			  printf("\n TRACE[09.01]: root: 0X%X, root->left: 0X%X", root, root->left);
-        _traverse (root->left, process);
-		 if(trace_flag)
-			  printf("\n TRACE[09.02]: root: 0X%X, root->dataPtr: 0X%X", root, root->dataPtr);
-		 process (root->dataPtr);
-		 if(trace_flag)
-		     printf("\n TRACE[09.03]: root: 0X%X, root->right: 0X%X", root, root->right);
-        _traverse (root->right, process);
-     } // if
-     return;
+    int64_t slot = (int64_t)key - dense->lo;
+
+    return (slot < 0 || slot >= dense->num_slots) ? -1 : (int)slot;
 }
 
 /*******************************************************************
- Function Name  : BST_Empty
- Description    : Returns true if tree is empty; false if any data.
- Pre            : Tree has been created. (May be null)
- Post           : Returns True if tree empty, false if any data
- Remarks        :
- Func ID        : 10
+ Function Name  : _dense_next
+ Description    : Finds the first key present at or after a slot of a dense tree.
+ Pre            : 0 <= slot <= dense->num_slots
+ Post           : Return slot of the key; -1 if none
+ Remarks        : skips a word of empty slots at a time; BST_CTZ finds the key in a word
+ Func ID        : 212
 *******************************************************************/
-bool BST_Empty(BST_TREE* tree)
+int _dense_next (BST_DENSE* dense, int slot)
 {
-    // Statements
-    return (tree->count == 0);
+    unsigned int bits;
+    int w = slot >> 5;
+
+    if (slot >= dense->num_slots)
+       return -1;
+    bits = dense->bits[w] & (~0u << (slot & 31));
+    while (!bits)
+    {
+        if (++w == dense->num_words)
+           return -1;
+        bits = dense->bits[w];
+    }
+    return (w << 5) + BST_CTZ(bits);
 }
 
 /*******************************************************************
- Function Name  : BST_Full
- Description    : If there is no room for another node, returns true.
- Pre            : Tree has been created. (May be null)
- Post           : true if no room for another insert
- Remarks        :
- Func ID        : 11
+ Function Name  : _dense_prev
+ Description    : Finds the last key present at or before a slot of a dense tree.
+ Pre            : -1 <= slot < dense->num_slots
+ Post           : Return slot of the key; -1 if none
+ Remarks        : as _dense_next, downwards with BST_CLZ
+ Func ID        : 213
 *******************************************************************/
-bool BST_Full(BST_TREE* tree)
+int _dense_prev (BST_DENSE* dense, int slot)
 {
-    NODE* newPtr;
+    unsigned int bits;
+    int w = slot >> 5;
 
-    newPtr = (NODE*)calloc(1, sizeof (*(tree->root)));
-    if (newPtr)
+    if (slot < 0)
+       return -1;
+    bits = dense->bits[w] & (~0u >> (31 - (slot & 31)));
+    while (!bits)
     {
-       free (newPtr);
-       return false;
-    } // if
-    return true;
+        if (w-- == 0)
+           return -1;
+        bits = dense->bits[w];
+    }
+    return (w << 5) + 31 - BST_CLZ(bits);
 }
+
 /*******************************************************************
- Function Name  : BST_Count
- Description    : Returns number of nodes in tree.
- Pre            : Tree has been created. (May be null)
- Post           : Returns tree count
- Remarks        :
- Func ID        : 12
+ Function Name  : _dense_select
+ Description    : Finds the key with a given rank in a dense tree.
+ Pre            : 0 <= index < number of keys present
+ Post           : Return slot of the index-th key
+ Remarks        : counts whole words with BST_POPCOUNT, then bits in the last one
+ Func ID        : 214
 *******************************************************************/
-int BST_Count (BST_TREE* tree)
+int _dense_select (BST_DENSE* dense, int index)
 {
-    return (tree->count);
+    unsigned int bits;
+    int w, n;
+
+    for (w = 0; index >= (n = BST_POPCOUNT(dense->bits[w])); ++w)
+        index -= n;
+    for (bits = dense->bits[w]; index > 0; --index)
+        bits &= bits - 1;
+    return (w << 5) + BST_CTZ(bits);
 }
 
 /*******************************************************************
- Function Name  : BST_Destroy
- Description    : Deletes all data in tree and recycles memory.
-                  The nodes are deleted by calling a recursive function to traverse the tree in inorder sequence.
- Pre            : tree is a pointer to a valid tree
- Post           : All data and head structure deleted. Return null head pointer
- Remarks        :
- Func ID        : 13
+ Function Name  : _dense_rank
+ Description    : Counts the keys present below a slot of a dense tree.
+ Pre            : 0 <= slot <= dense->num_slots
+ Post           : Return number of keys in slots below slot
+ Remarks        : BST_POPCOUNT a word at a time
+ Func ID        : 215
 *******************************************************************/
-BST_TREE* BST_Destroy (BST_TREE* tree)
+int _dense_rank (BST_DENSE* dense, int slot)
 {
-    if (tree)
-       _destroy (tree->root);
-     // All nodes deleted. Free structure
-     free (tree);
-     return NULL;
+    int w, rank = 0;
+
+    for (w = 0; w < slot >> 5; ++w)
+        rank += BST_POPCOUNT(dense->bits[w]);
+    if (slot & 31)
+       rank += BST_POPCOUNT(dense->bits[w] & (~0u >> (32 - (slot & 31))));
+    return rank;
 }
 
 /*******************************************************************
- Function Name  : _destroy
- Description    : Deletes all data in tree and recycles memory. It also recycles memory for the key and data nodes.
-                  The nodes are deleted by calling a recursive function to traverse the tree in inorder sequence.
- Pre            : root is pointer to valid tree/subtree
- Post           : All data and head structure deleted
- Remarks        :
- Func ID        : 14
+ Function Name  : _dense_build
+ Description    : Fills an empty dense tree from a stream for _build_stream.
+ Pre            : tree is an empty dense tree; as BST_BuildFromStream
+ Post           : Return true, or false if a key is out of order, repeated or outside the
+                  domain; the bitmap is then left empty
+ Remarks        : no node to link, so the build is one store and one bit per data
+ Func ID        : 216
 *******************************************************************/
-void _destroy (NODE* root)
+bool _dense_build (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count)
 {
-    if(root)
+    BST_DENSE* dense = tree->dense;
+    void* dataPtr;
+    int i, k, last = -1;
+
+    for (i = 0; i < count; ++i)
     {
-		if(trace_flag)
-			  printf("\n TRACE[14.01]: root: 0X%X, root->left: 0X%X", root, root->left);
-         _destroy (root->left);
-		 if(trace_flag)
-			  printf("\n TRACE[14.02]: root: 0X%X, delete: 0X%X", root, root->dataPtr);
-         free (root->dataPtr);
-		 if(trace_flag)
-			  printf("\n TRACE[14.03]: root: 0X%X, root->right: 0X%X", root, root->right);
-         _destroy (root->right);
-         free(root);
+        dataPtr = next (ctx);
+        k = _dense_slot (dense, tree->getKey (dataPtr));
+        if (k <= last)
+        {
+            if(trace_flag)
+               printf("\n TRACE[216.01]: data out of order or domain at %d: %p", i, dataPtr);
+            memset (dense->bits, 0, (size_t)dense->num_words * sizeof (unsigned int));
+            return false;
+        }
+        dense->slots[k] = dataPtr;
+        dense->bits[k >> 5] |= 1u << (k & 31);
+        last = k;
     }
-    return;
+    return true;
 }
+
 /*******************************************************************
- Function Name  : main
- Description    :
- Pre            :
- Post           :
- Remarks        :
- Func ID        : 15
+ Function Name  : BST_Insert
+ Description    : inserts new data into the tree.
+ Pre            : tree is pointer to BST tree structure
+ Post           : data inserted or memory overflow and Return Success (true) or Overflow (false)
+ Remarks        : node comes from the tree's node pool; no malloc once the pool has free nodes.
+                  data is also inserted in every secondary index; on failure in none of them.
+                  BST_MODE_HASH and BST_MODE_BPLUS refuse a key already in the tree;
+                  a BST_MODE_MAPPED tree refuses every insert. A journaled tree logs
+                  the insert, and fails if its journal cannot take it.
+                  BST_MODE_CONCURRENT inserts under the writer lock; readers see the
+                  new data once the insert returns. The lock-free engine takes no lock
+                  and refuses a key already in the tree
+ Func ID        : 2
 *******************************************************************/
-int main (void)
+bool BST_Insert(BST_TREE* tree, void* dataPtr)
 {
-   BST_TREE* list;
-   char option = ' ';
-   printf("\n Begin Student List");
-   list = BST_Create (compareStu);
-   while ((option = getOption ()) != 'Q')
-   {
-	    switch (option)
+    bool success;
+    int phase;
+
+    if (tree->shards)
+       return BST_Insert (tree->shards->trees[_shard_index (tree->shards, tree->getKey (dataPtr))], dataPtr);
+    if (BST_LOCK_FREE(tree))
+    {
+       phase = BST_Read_Lock (tree);
+       success = _lf_insert (tree, dataPtr);
+       BST_Read_Unlock (tree, phase);
+       // an insert that helps a delete finish retires what it splices out
+       _lf_reclaim (tree);
+       return success;
+    }
+    if (!(tree->mode & BST_MODE_CONCURRENT))
+       return _insert_record (tree, dataPtr);
+    if (!_rcu_write_begin (tree, BST_RCU_MAX_COPIES))
+       return false;
+    success = _insert_record (tree, dataPtr);
+    _rcu_write_end (tree);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _insert_record
+ Description    : inserts new data into the tree for BST_Insert.
+ Pre            : in BST_MODE_CONCURRENT, caller holds the writer lock
+ Post           : as BST_Insert
+ Remarks        : in BST_MODE_CONCURRENT the new node is fresh, so the retrace may
+                  rotate it in place
+ Func ID        : 146
+*******************************************************************/
+bool _insert_record (BST_TREE* tree, void* dataPtr)
+{
+    // Local Definitions
+    NODE* newPtr;
+    int slot;
+
+    if (tree->mode & BST_MODE_MAPPED)
+       return false;
+    if (tree->journal && !_journal_reserve(tree->journal))
+       return false;
+    if (tree->dense)
+    {
+       // one slot per key: a key outside the domain or already present is refused
+       slot = _dense_slot(tree->dense, tree->getKey(dataPtr));
+       if (slot < 0 || BST_DENSE_HAS(tree->dense, slot))
+          return false;
+       if ((tree->num_indexes || tree->trie) && !_index_insert(tree, dataPtr))
+          return false;
+       tree->dense->slots[slot] = dataPtr;
+       tree->dense->bits[slot >> 5] |= 1u << (slot & 31);
+       (tree->count)++;
+       if (tree->journal)
+          _journal_log(tree->journal, BST_JOURNAL_INSERT, dataPtr);
+       return true;
+    }
+    if (tree->mode & BST_MODE_HASH)
+    {
+       // keys of a hashed tree are unique
+       if (_hash_find(&tree->hash, tree->getKey(dataPtr)) || !_hash_reserve(&tree->hash, tree->count + 1))
+          return false;
+    }
+    if (tree->mode & BST_MODE_BPLUS)
+    {
+       if (!_bplus_insert(tree, tree->getKey(dataPtr), dataPtr))
+          return false;
+       if ((tree->num_indexes || tree->trie) && !_index_insert(tree, dataPtr))
        {
-            case 'A':
-			    addStu (list);
-            break;
-            case 'D':
-			    deleteStu (list);
-            break;
-            case 'F':
-			   findStu (list);
-            break;
-            case 'P':
-			   printList (list);
-            break;
-            case 'U':
-    			testUtilties (list);
-            break;
+          _bplus_delete(tree, tree->getKey(dataPtr));
+          return false;
        }
+       (tree->count)++;
+       if (tree->mode & BST_MODE_HASH)
+          _hash_put(&tree->hash, tree->getKey(dataPtr), dataPtr);
+       if (tree->journal)
+          _journal_log(tree->journal, BST_JOURNAL_INSERT, dataPtr);
+       return true;
     }
-    list = BST_Destroy (list);
-    printf("\nEnd Student List\n");
-    return 0;
+    if ((tree->num_indexes || tree->trie) && !_index_insert(tree, dataPtr))
+       return false;
+    newPtr = (NODE*)_pool_alloc(&tree->node_pool);
+    if (!newPtr)
+    {
+       _index_delete(tree, dataPtr);
+       return false;
+    }
+    newPtr->right = NULL;
+    newPtr->left = NULL;
+    newPtr->dataPtr = dataPtr;
+    newPtr->height = 1;
+    newPtr->size = 1;
+    newPtr->fresh = 0;
+    if (tree->mode & BST_MODE_CONCURRENT)
+    {
+       newPtr->fresh = 1;
+       tree->rcu->fresh[tree->rcu->num_fresh++] = newPtr;
+    }
+    if (tree->mode & BST_MODE_INLINE_KEY)
+       newPtr->key = tree->getKey(dataPtr);
+    if (tree->count == 0)
+	{
+       tree->root = newPtr;
+	   if(trace_flag)
+		    printf("\n Insert in Empty Tree - tree->root : %p", (void *)tree->root);
+	}
+    else
+      tree->root = _insert(tree, tree->root, newPtr);
+    (tree->count)++;
+    if (tree->mode & BST_MODE_HASH)
+       _hash_put(&tree->hash, newPtr->key, dataPtr);
+    if (tree->journal)
+       _journal_log(tree->journal, BST_JOURNAL_INSERT, dataPtr);
+    return true;
 }
 
 /*******************************************************************
- Function Name  : getOption
- Description    : Reads and validates processing option from keyboard.
- Pre            :
- Post           : valid option returned
- Remarks        :
- Func ID        : 16
+ Function Name  : _compare_key
+ Description    : three way compare of a search key against a node.
+ Pre            : key is the inline key of dataPtr (only used in BST_MODE_INLINE_KEY)
+ Post           : return low (< 0), equal (0), or high (> 0)
+ Remarks        : BST_MODE_INLINE_KEY compares the node's own key and never reads its data
+ Func ID        : 41
 *******************************************************************/
-char getOption (void)
+int _compare_key (BST_TREE* tree, int key, void* dataPtr, NODE* node)
 {
-    char option[2];
-    bool error = true;
+    if (tree->mode & BST_MODE_INLINE_KEY)
+       return (key > node->key) - (key < node->key);
+    return tree->compare(dataPtr, node->dataPtr);
+}
 
-    printf("\n ====== MENU ======\n");
-    printf(" A - Add Student\n");
-    printf(" D - Delete Student\n");
-    printf(" F - Find Student\n");
-    printf(" P - Print Class List\n");
-    printf(" U - Show Utilities\n");
-    printf(" Q - Quit\n");
-    do
+/*******************************************************************
+ Function Name  : _insert
+ Description    : iteratively inserts the new data into a leaf node in the BST tree.
+ Pre            : Application has called BST_Insert, which passes root and data pointer
+ Post           : Data have been inserted and Return pointer to [potentially] new root
+ Remarks        : in BST_MODE_AVL, the insertion path is kept in a bounded local stack and
+                  retraced bottom up to rebalance; BST_MODE_BASIC needs no stack at all.
+                  In BST_MODE_ORDER_STAT, subtree counts are bumped on the way down.
+                  In BST_MODE_CONCURRENT, each node on the path is copied before it changes.
+ Func ID        : 3
+*******************************************************************/
+NODE* _insert (BST_TREE* tree, NODE* root, NODE* newPtr)
+{
+   NODE** path[BST_MAX_HEIGHT];
+   NODE** link = &root;
+   int depth = 0, old_height;
+
+   // Locate null subtree for insertion
+   while (*link)
+   {
+      if (tree->mode & BST_MODE_CONCURRENT)
+         *link = _cow(tree, *link);
+      if (tree->mode & BST_MODE_AVL)
+         path[depth++] = link;
+      if (tree->mode & BST_MODE_ORDER_STAT)
+         ++(*link)->size;
+      if (_compare_key(tree, newPtr->key, newPtr->dataPtr, *link) < 0)
+      {
+         if(trace_flag)
+            printf("\n TRACE[03.01]: root : %p, root->left: %p, NewPtr: %p", (void *)*link, (void *)(*link)->left, (void *)newPtr);
+         link = &(*link)->left;
+      } // new < node
+      else
+      {
+         // new data >= root data
+         if(trace_flag)
+            printf("\n TRACE[03.02]: root : %p, root->right: %p, NewPtr: %p", (void *)*link, (void *)(*link)->right, (void *)newPtr);
+         link = &(*link)->right;
+      }
+   }
+   *link = newPtr;
+   // Retrace insertion path; stop once a subtree keeps its old height
+   while (depth > 0)
+   {
+      link = path[--depth];
+      old_height = (*link)->height;
+      *link = _rebalance(tree, *link);
+      if ((*link)->height == old_height)
+         break;
+   }
+   return root;
+}
+
+/*******************************************************************
+ Function Name  : BST_Delete
+ Description    : deletes a node from the tree and rebalances it if necessary.
+ Pre            : tree initialized--null tree is OK dltKey is pointer to data structure
+                   containing key to be deleted
+ Post           : node deleted and its space recycled -or- An error code is returned. Return Success (true) or Not found (false)
+ Remarks        : BST_MODE_HASH finds the data in the hash side index; only a key that is
+                  present descends the tree to unlink its node. A BST_MODE_MAPPED tree
+                  deletes nothing. A journaled tree logs the record before it is freed.
+                  BST_MODE_CONCURRENT deletes under the writer lock; the record is freed
+                  once no reader can hold it. The lock-free engine takes no lock, and
+                  its deletes free the records a batch at a time
+ Func ID        : 4
+*******************************************************************/
+bool BST_Delete(BST_TREE* tree, void* dltKey)
+{
+    bool success;
+    int phase;
+
+    if (tree->shards)
+       return BST_Delete (tree->shards->trees[_shard_index (tree->shards, tree->getKey (dltKey))], dltKey);
+    if (BST_LOCK_FREE(tree))
     {
-        printf("\nEnter Option: ");
-        if((Get_Input_Str(option, 2)) != SUCCESS)
-		{
-			printf("\n Invalid option. Please re-enter: ");
-            error = true;
-			continue;
-		}
-        option[0] = toupper(option[0]);
-        if (option[0] == 'A' || option[0] == 'D' || option[0] == 'F' || option[0] == 'P' || option[0] == 'U' || option[0] == 'Q')
-          error = false;
-        else
-        {
-           printf("\n Invalid option. Please re-enter: ");
-           error = true;
-        }
-    } while (error == true);
-    return option[0];
+       phase = BST_Read_Lock (tree);
+       success = _lf_delete (tree, dltKey);
+       BST_Read_Unlock (tree, phase);
+       _lf_reclaim (tree);
+       return success;
+    }
+    if (!(tree->mode & BST_MODE_CONCURRENT))
+       return _delete_record (tree, dltKey);
+    if (!_rcu_write_begin (tree, BST_RCU_MAX_COPIES))
+       return false;
+    // a missing key copies no path
+    success = _retrieve (tree, dltKey, tree->root) && _delete_record (tree, dltKey);
+    _rcu_write_end (tree);
+    return success;
 }
+
 /*******************************************************************
- Function Name  : addStu
- Description    : Adds a student to tree.
- Pre            :
- Post           : student added (abort on memory overflow)
+ Function Name  : _delete_record
+ Description    : deletes data from the tree for BST_Delete.
+ Pre            : in BST_MODE_CONCURRENT, caller holds the writer lock
+ Post           : as BST_Delete
  Remarks        :
- Func ID        : 17
+ Func ID        : 147
 *******************************************************************/
-void addStu (BST_TREE* list)
+bool _delete_record (BST_TREE* tree, void* dltKey)
 {
-    STUDENT *getPtr, *stuPtr;
+    bool success;
+    NODE* newRoot;
+    void* dataPtr = NULL;
+    int key = 0, slot;
 
-     stuPtr = (STUDENT*) calloc (1, sizeof (STUDENT));
-     if (!stuPtr)
-     {
-         printf("\n ERR: Memory Overflow in add");
-    	 exit(101);
-     }
-     printf("Enter student id: ");
-	 if((Get_Validate_Input_Number(&(stuPtr->id), temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+    if (tree->mode & BST_MODE_MAPPED)
+       return false;
+    if (tree->journal)
+    {
+       // found, so the delete below cannot fail once logged
+       dataPtr = BST_Retrieve (tree, dltKey);
+       if (!dataPtr || !_journal_reserve (tree->journal))
+          return false;
+       _journal_log (tree->journal, BST_JOURNAL_DELETE, dataPtr);
+    }
+    if (tree->dense)
+    {
+       slot = _dense_slot (tree->dense, tree->getKey(dltKey));
+       if (slot < 0 || !BST_DENSE_HAS(tree->dense, slot))
+          return false;
+       dataPtr = tree->dense->slots[slot];
+       tree->dense->bits[slot >> 5] &= ~(1u << (slot & 31));
+       if (tree->num_indexes || tree->trie)
+          _index_delete (tree, dataPtr);
+       if (!(tree->mode & BST_MODE_INDEX))
+          BST_Free_Data (tree, dataPtr);
+       (tree->count)--;
+       return true;
+    }
+    if (tree->mode & BST_MODE_BPLUS)
+    {
+       key = tree->getKey(dltKey);
+       dataPtr = _bplus_delete (tree, key);
+       if (!dataPtr)
+          return false;
+       if (tree->num_indexes || tree->trie)
+          _index_delete (tree, dataPtr);
+       if (tree->mode & BST_MODE_HASH)
+          _hash_remove (&tree->hash, key);
+       if (!(tree->mode & BST_MODE_INDEX))
+          BST_Free_Data (tree, dataPtr);
+       (tree->count)--;
+       return true;
+    }
+    if (tree->mode & BST_MODE_HASH)
+    {
+       // locate in O(1); a missing key never descends the tree
+       key = tree->getKey(dltKey);
+       dataPtr = _hash_find (&tree->hash, key);
+       if (!dataPtr)
+          return false;
+    }
+    if (tree->num_indexes || tree->trie)
+    {
+       // the indexes are keyed by the record, so find it before it is freed
+       if (!dataPtr)
+          dataPtr = _retrieve (tree, dltKey, tree->root);
+       if (!dataPtr)
+          return false;
+       _index_delete (tree, dataPtr);
+    }
+    newRoot = _delete (tree, tree->root, dltKey, &success);
+    if (success)
+    {
+       if (tree->mode & BST_MODE_HASH)
+          _hash_remove (&tree->hash, key);
+       tree->root = newRoot;
+	   if(trace_flag)
+		   printf("\n TRACE[04.01]: tree->root : %p", (void *)tree->root);
+       (tree->count)--;
+       if (tree->count == 0)
+	   {
+          // Tree now empty
+          tree->root = NULL;
+	   }
+     } // if
+     return success;
+}
+
+/*******************************************************************
+ Function Name  : _delete
+ Description    : Deletes node from the tree and rebalances tree if necessary.
+ Pre            : tree initialized--null tree is OK. dataPtr contains key of node to be deleted
+ Post           : node is deleted and its space recycled. -or- if key not found, tree is unchanged
+                  success is true if deleted; false if not Return pointer to root
+ Remarks        : iterative; compare is called once per level. In BST_MODE_AVL, the
+                  deletion path is kept in a bounded local stack and retraced bottom up to rebalance.
+                  In BST_MODE_ORDER_STAT, subtree counts are dropped once the node is found.
+                  In BST_MODE_CONCURRENT, the path down to the exchanged node is copied, and
+                  the unlinked node and record are retired instead of freed.
+ Func ID        : 5
+*******************************************************************/
+NODE* _delete (BST_TREE* tree, NODE* root, void* dataPtr, bool* success)
+{
+    // Local Definitions
+     NODE** path[BST_MAX_HEIGHT];
+     NODE** link = &root;
+     NODE** exchLink;
+     NODE* dltPtr;
+     NODE* exchPtr;
+     int depth = 0, cmp = 0, old_height, key = 0, i;
+
+     *success = false;
+     if (tree->mode & BST_MODE_INLINE_KEY)
+        key = tree->getKey(dataPtr);
+     while (*link && (cmp = _compare_key(tree, key, dataPtr, *link)) != 0)
      {
-		printf("\n ERR: Invalid student ID");
-		free(stuPtr);
-		return;
+         if (tree->mode & BST_MODE_CONCURRENT)
+             *link = _cow(tree, *link);
+         if (tree->mode & BST_MODE_AVL)
+             path[depth++] = link;
+         if(trace_flag)
+             printf("\n TRACE[05.01]: %s 0 in root : %p", (cmp < 0 ? "<" : ">"), (void *)*link);
+         link = (cmp < 0) ? &(*link)->left : &(*link)->right;
      }
-     getPtr = (STUDENT*)BST_Retrieve (list, &stuPtr->id);
-	 if(getPtr != NULL && getPtr->id == (stuPtr->id))
-	 {
-		 printf("\n ERR[17.01]: Student ID: %d already exist with name: %s, gpa: %f", getPtr->id, getPtr->name, getPtr->gpa);
-		 free(stuPtr);
-		 return;
-	 }
-     printf("Enter student name: ");
-	 if((Get_Input_Alpha_Char_Str(stuPtr->name, STUDENT_NAME_MAX_CHARS)) != SUCCESS)
-	 {
-        free(stuPtr);
-		return;
-	 }
-     printf("Enter student gpa: ");
-     if((Get_Validate_Input_Float(&(stuPtr->gpa),temp_str, STR_MAX_NUM_CHARS, STUDENT_MIN_GRADE, STUDENT_MAX_GRADE)) != SUCCESS)
+     if (!*link)
+        return root;
+     // Delete node found
+     dltPtr = *link;
+     if(trace_flag)
+        printf("\n TRACE[05.04]: delete node found - dltPtr: %p, delete data: %p", (void *)dltPtr, dltPtr->dataPtr);
+     if (tree->mode & BST_MODE_ORDER_STAT)
      {
-		printf("\n ERR: Invalid grade ID");
-		free(stuPtr);
-		return;
+        // every ancestor loses one node; BST_MODE_BASIC keeps no path, so walk it again
+        if (tree->mode & BST_MODE_AVL)
+        {
+            for (i = 0; i < depth; ++i)
+                --(*path[i])->size;
+        }
+        else
+        {
+            for (exchPtr = root; exchPtr != dltPtr; exchPtr = (_compare_key(tree, key, dataPtr, exchPtr) < 0) ? exchPtr->left : exchPtr->right)
+                --exchPtr->size;
+        }
+     }
+     if (!(tree->mode & BST_MODE_INDEX))
+     {
+        // a reader may still hold the record of a concurrent tree
+        if (tree->mode & BST_MODE_CONCURRENT)
+           _rcu_retire (tree, dltPtr->dataPtr, false);
+        else
+           BST_Free_Data (tree, dltPtr->dataPtr); // data memory
+     }
+     if (!dltPtr->left)
+     {
+        // No left subtree
+        *link = dltPtr->right;
+     }
+     else if (!dltPtr->right)
+     {
+        // Only left subtree
+        *link = dltPtr->left;
+     }
+     else
+     {
+        // Delete Node has two subtrees: move largest data on left subtree into it
+        if (tree->mode & BST_MODE_CONCURRENT)
+            dltPtr = *link = _cow(tree, *link);
+        if (tree->mode & BST_MODE_AVL)
+            path[depth++] = link;
+        --dltPtr->size;
+        exchLink = &dltPtr->left;
+        while ((*exchLink)->right)
+        {
+            if (tree->mode & BST_MODE_CONCURRENT)
+                *exchLink = _cow(tree, *exchLink);
+            if (tree->mode & BST_MODE_AVL)
+                path[depth++] = exchLink;
+            --(*exchLink)->size;
+            exchLink = &(*exchLink)->right;
+        }
+        exchPtr = *exchLink;
+        if(trace_flag)
+            printf("\n TRACE[05.09]: largest data on left subtree: %p", (void *)exchPtr);
+        dltPtr->dataPtr = exchPtr->dataPtr;
+        dltPtr->key = exchPtr->key;
+        *exchLink = exchPtr->left;
+        dltPtr = exchPtr;
+     }
+     if (tree->mode & BST_MODE_CONCURRENT)
+        _rcu_retire (tree, dltPtr, true);
+     else
+        _pool_free (&tree->node_pool, dltPtr); // BST Node
+     *success = true;
+     // Retrace deletion path; stop once a subtree keeps its old height
+     while (depth > 0)
+     {
+        link = path[--depth];
+        old_height = (*link)->height;
+        *link = _rebalance(tree, *link);
+        if ((*link)->height == old_height)
+            break;
+     }
+     return root;
+}
+
+/*******************************************************************
+ Function Name  : BST_Retrieve
+ Description    : Retrieve node searches tree for the node containing
+                  the requested key and returns pointer to its data.
+ Pre            : Tree has been created (may be null) data is pointer to data structure
+                   containing key to be located
+ Post           :  Tree searched and data pointer returned Return Address of matching node returned.
+                   If not found, NULL returned
+ Remarks        : O(1) expected in BST_MODE_HASH, from the hash side index.
+                  BST_MODE_CONCURRENT searches the last published tree without waiting;
+                  the data returned stays valid while the caller holds a BST_Read_Lock
+                  taken before the call
+ Func ID        : 6
+*******************************************************************/
+void* BST_Retrieve (BST_TREE* tree, void* keyPtr)
+{
+BST_BPLUS_NODE* leaf;
+void* dataPtr;
+int key, slot, phase;
+
+if (tree->shards)
+    return BST_Retrieve (tree->shards->trees[_shard_index (tree->shards, tree->getKey (keyPtr))], keyPtr);
+if (tree->dense)
+{
+    slot = _dense_slot (tree->dense, tree->getKey(keyPtr));
+    return (slot >= 0 && BST_DENSE_HAS(tree->dense, slot)) ? tree->dense->slots[slot] : NULL;
+}
+if (tree->mode & BST_MODE_HASH)
+    return _hash_find (&tree->hash, tree->getKey(keyPtr));
+if (tree->mode & BST_MODE_MAPPED)
+    return BST_Frozen_Retrieve (tree->frozen, keyPtr);
+if (tree->mode & BST_MODE_BPLUS)
+{
+    key = tree->getKey(keyPtr);
+    leaf = _bplus_seek (tree, key, &slot);
+    return (leaf && leaf->keys[slot] == key) ? leaf->ptrs[slot] : NULL;
+}
+phase = BST_Read_Lock (tree);
+if (BST_LOCK_FREE(tree))
+    dataPtr = _lf_retrieve (tree, keyPtr);
+else
+    dataPtr = _retrieve (tree, keyPtr, _root (tree));
+BST_Read_Unlock (tree, phase);
+return dataPtr;
+}
+
+/*******************************************************************
+ Function Name  : _retrieve
+ Description    : Searches tree for node containing requested key
+                  and returns its data to the calling function.
+ Pre            : _retrieve passes tree, dataPtr, root, dataPtr is pointer to data structure
+                   containing key to be located
+ Post           :  tree searched; data pointer returned Return Address of data in matching node.
+                   If not found, NULL returned
+ Remarks        : iterative; compare is called once per level
+ Func ID        : 7
+*******************************************************************/
+void* _retrieve (BST_TREE* tree, void* dataPtr, NODE* root)
+{
+    int cmp, key = 0;
+
+    if (tree->mode & BST_MODE_INLINE_KEY)
+       key = tree->getKey(dataPtr);
+    while (root)
+    {
+         cmp = _compare_key(tree, key, dataPtr, root);
+         if (cmp == 0)
+         {
+             // Found equal key
+             if(trace_flag)
+                 printf("\n TRACE[07.03]: = 0 root: %p, dataPtr: %p", (void *)root, root->dataPtr);
+             return root->dataPtr;
+         }
+         if(trace_flag)
+             printf("\n TRACE[07.01]: %s 0 dataPtr: %p, root: %p", (cmp < 0 ? "<" : ">"), dataPtr, (void *)root);
+         root = (cmp < 0) ? root->left : root->right;
+    }
+    // Data not in tree
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : BST_Traverse
+ Description    : Process tree using inorder traversal.
+ Pre            : Tree has been created (may be null) process “visits” nodes during traversal
+ Post           : Nodes processed in LNR (inorder) sequence
+ Remarks        : BST_MODE_BPLUS scans the linked leaves in order; BST_MODE_MAPPED walks
+                  the mapped records. BST_MODE_CONCURRENT walks the tree published when
+                  the walk starts, in a read side section; process must not change the tree.
+                  The lock-free engine visits each key present for the whole walk once,
+                  in order, in O(n depth). A sharded tree is walked a shard at a time,
+                  each under its own read side section
+ Func ID        : 8
+*******************************************************************/
+void BST_Traverse (BST_TREE* tree, void (*process) (void* dataPtr))
+{
+    BST_BPLUS_NODE* leaf;
+    BST_LF_NODE* lfLeaf;
+    unsigned int bits;
+    int i, phase;
+
+	// Statements
+    if (tree->shards)
+    {
+       for (i = 0; i < tree->shards->num_shards; ++i)
+           BST_Traverse (tree->shards->trees[i], process);
+       return;
+    }
+    if (tree->dense)
+    {
+       // a word at a time: BST_CTZ finds the next key, bits &= bits - 1 drops it
+       for (i = 0; i < tree->dense->num_words; ++i)
+       {
+           for (bits = tree->dense->bits[i]; bits; bits &= bits - 1)
+               process (tree->dense->slots[(i << 5) + BST_CTZ(bits)]);
+       }
+       return;
+    }
+    if (tree->mode & BST_MODE_MAPPED)
+    {
+       BST_Frozen_Traverse (tree->frozen, process);
+       return;
+    }
+    if (tree->mode & BST_MODE_BPLUS)
+    {
+       for (leaf = _bplus_edge (tree, true); leaf; leaf = leaf->next)
+       {
+           for (i = 0; i < leaf->num_keys; ++i)
+               process (leaf->ptrs[i]);
+       }
+       return;
+    }
+    phase = BST_Read_Lock (tree);
+    if (BST_LOCK_FREE(tree))
+    {
+       for (lfLeaf = _lf_next (tree, NULL); lfLeaf; lfLeaf = _lf_next (tree, &lfLeaf->key))
+           process (lfLeaf->dataPtr);
+    }
+    else
+       _traverse (_root (tree), process);
+    BST_Read_Unlock (tree, phase);
+     return;
+}
+/*******************************************************************
+ Function Name  : _traverse
+ Description    : Inorder tree traversal. To process a node, we use
+                  the function passed when traversal was called.
+ Pre            : Tree has been created (may be null)
+ Post           : All nodes processed
+ Remarks        : iterative with an explicit stack; sets system_status to ERR_BST_FULL and
+                  stops if the stack of a very deep tree cannot grow
+ Func ID        : 9
+*******************************************************************/
+void _traverse (NODE* root, void (*process) (void* dataPtr))
+{
+     BST_STACK stack;
+
+     _stack_init(&stack);
+     while (root || stack.top > 0)
+     {
+         // descend to leftmost node, remembering the path
+         while (root)
+         {
+             if (!_stack_push(&stack, root))
+             {
+                 system_status = ERR_BST_FULL;
+                 _stack_free(&stack);
+                 return;
+             }
+             if(trace_flag)
+                 printf("\n TRACE[09.01]: root: %p, root->left: %p", (void *)root, (void *)root->left);
+             root = root->left;
+         }
+         root = _stack_pop(&stack);
+         if(trace_flag)
+             printf("\n TRACE[09.02]: root: %p, root->dataPtr: %p", (void *)root, root->dataPtr);
+         process (root->dataPtr);
+         root = root->right;
      }
-     BST_Insert (list, stuPtr);
+     _stack_free(&stack);
+     return;
+}
+
+/*******************************************************************
+ Function Name  : BST_ParallelReduce
+ Description    : Folds every data of a tree into one result on a pool of threads.
+ Pre            : tree has been created. result holds the identity of combine and is
+                  acc_size bytes. map folds one data into an accumulator; combine folds
+                  the accumulator other into acc. nthreads <= 0 uses every online core
+                  (BST_PAR_DEFAULT_THREADS where that count is not available)
+ Post           : result holds the fold of all data in key order. Return true, or false
+                  on memory overflow or for a sharded tree, with result unchanged
+ Remarks        : the tree is cut into chunks of whole subtrees, each folded into its own
+                  accumulator (a copy of the identity) by whichever thread takes it; the
+                  accumulators are then combined in key order on the calling thread, so
+                  combine need only be associative. map runs on several threads at once,
+                  on different accumulators. See _par_run
+ Func ID        : 182
+*******************************************************************/
+bool BST_ParallelReduce (BST_TREE* tree, void (*map) (void* acc, void* dataPtr),
+                         void (*combine) (void* acc, void* other), void* result, size_t acc_size, int nthreads)
+{
+    BST_PAR_JOB job;
+    int i;
+
+    memset (&job, 0, sizeof (job));
+    job.tree = tree;
+    job.map = map;
+    job.result = result;
+    job.acc_size = acc_size;
+    // accumulators a cache line apart, so threads never write the same line
+    job.acc_stride = (acc_size + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1);
+    if (!_par_run (&job, nthreads))
+       return false;
+    for (i = 0; i < job.num_chunks; ++i)
+        combine (result, job.accs + (size_t)i * job.acc_stride);
+    BST_ALIGNED_FREE (job.accs);
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : BST_ParallelTraverse
+ Description    : Processes every data of a tree on a pool of threads, chunk by chunk.
+ Pre            : tree has been created. nthreads <= 0 uses every online core
+ Post           : every data processed once with the number of its chunk. Return number
+                  of chunks (at most BST_PAR_MAX_CHUNKS); -1 on memory overflow or for
+                  a sharded tree
+ Remarks        : chunks are numbered in key order and each is processed in key order by
+                  one thread, so per chunk output (an export buffer each) joins back in
+                  order. Different chunks run at once: process must be thread safe
+ Func ID        : 183
+*******************************************************************/
+int BST_ParallelTraverse (BST_TREE* tree, void (*process) (void* dataPtr, int chunk), int nthreads)
+{
+    BST_PAR_JOB job;
+
+    memset (&job, 0, sizeof (job));
+    job.tree = tree;
+    job.process = process;
+    if (!_par_run (&job, nthreads))
+       return -1;
+    return job.num_chunks;
+}
+
+/*******************************************************************
+ Function Name  : _par_run
+ Description    : Cuts a tree into chunks and walks them on a work stealing pool.
+ Pre            : job holds the tree and map (with result and acc_size) or process
+ Post           : every chunk walked; job->accs holds a reduce's accumulators. Return
+                  true, or false on memory overflow
+ Remarks        : about BST_PAR_CHUNKS_PER_THREAD chunks per thread, dealt out as equal
+                  runs; a thread walks its own run from the low end and, once it is out,
+                  steals the upper half of another thread's run. The calling thread is
+                  worker 0; if a thread cannot start, the others steal its run.
+                  A BST_MODE_CONCURRENT tree is walked as published at the start, under
+                  the caller's read lock; the lock-free engine in one chunk, on the
+                  calling thread
+ Func ID        : 184
+*******************************************************************/
+bool _par_run (BST_PAR_JOB* job, int nthreads)
+{
+    BST_TREE* tree = job->tree;
+    thrd_t threads[BST_PAR_MAX_THREADS];
+    bool started[BST_PAR_MAX_THREADS];
+    BST_PAR_WORKER workers[BST_PAR_MAX_THREADS];
+    int target, depth, max_chunks, phase, i;
+    bool success = true;
+
+    if (tree->shards)
+       return false;
+    if (nthreads <= 0)
+#if defined(__unix__) || defined(__APPLE__)
+       nthreads = (int)sysconf (_SC_NPROCESSORS_ONLN);
+#else
+       nthreads = BST_PAR_DEFAULT_THREADS;
+#endif
+    nthreads = nthreads < 1 ? 1 : (nthreads > BST_PAR_MAX_THREADS ? BST_PAR_MAX_THREADS : nthreads);
+    target = nthreads * BST_PAR_CHUNKS_PER_THREAD;
+    target = target > BST_PAR_MAX_CHUNKS / 2 ? BST_PAR_MAX_CHUNKS / 2 : target;
+    // depth levels of subtrees give up to 2^depth subtree chunks and as many lone nodes
+    for (depth = 0; (1 << depth) < target; ++depth)
+        ;
+    max_chunks = 2 << depth;
+    job->chunks = (BST_PAR_CHUNK*) malloc ((size_t)max_chunks * sizeof (BST_PAR_CHUNK));
+    if (!job->chunks)
+       return false;
+    phase = BST_Read_Lock (tree);
+    job->num_chunks = 0;
+    if (tree->mode & BST_MODE_MAPPED)
+       _par_split_slots (job, 1, depth);
+    else if (tree->dense)
+       _par_split_words (job, target);
+    else if (tree->mode & BST_MODE_BPLUS)
+       _par_split_leaves (job, target);
+    else if (BST_LOCK_FREE(tree))
+    {
+       job->chunks[0].root = NULL;
+       job->chunks[0].last = NULL;
+       job->num_chunks = 1;
+       nthreads = 1;
+    }
+    else
+       _par_split_nodes (job, _root (tree), depth);
+    if (job->map && job->num_chunks)
+    {
+       job->accs = (char*) BST_ALIGNED_ALLOC (BST_POOL_ALIGN, (size_t)job->num_chunks * job->acc_stride);
+       if (!job->accs)
+       {
+          BST_Read_Unlock (tree, phase);
+          free (job->chunks);
+          return false;
+       }
+       for (i = 0; i < job->num_chunks; ++i)
+           memcpy (job->accs + (size_t)i * job->acc_stride, job->result, job->acc_size);
+    }
+    nthreads = nthreads > job->num_chunks ? (job->num_chunks ? job->num_chunks : 1) : nthreads;
+    job->num_workers = nthreads;
+    for (i = 0; i < nthreads; ++i)
+        atomic_init (&job->deques[i].range, BST_PAR_RUN(job->num_chunks * i / nthreads,
+                                                        job->num_chunks * (i + 1) / nthreads));
+    atomic_init (&job->failed, 0);
+    if(trace_flag)
+       printf("\n TRACE[184.01]: chunks: %d, threads: %d", job->num_chunks, nthreads);
+    for (i = 1; i < nthreads; ++i)
+    {
+        workers[i].job = job;
+        workers[i].worker = i;
+        started[i] = thrd_create (&threads[i], _par_worker, &workers[i]) == thrd_success;
+    }
+    workers[0].job = job;
+    workers[0].worker = 0;
+    _par_worker (&workers[0]);
+    for (i = 1; i < nthreads; ++i)
+    {
+        if (started[i])
+           thrd_join (threads[i], NULL);
+    }
+    BST_Read_Unlock (tree, phase);
+    free (job->chunks);
+    if (atomic_load (&job->failed))
+    {
+       system_status = ERR_BST_FULL;
+       BST_ALIGNED_FREE (job->accs);
+       success = false;
+    }
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _par_split_nodes
+ Description    : Cuts a subtree into chunks, in key order.
+ Pre            : job->chunks has room for 2^(depth+1) more chunks
+ Post           : the subtrees depth levels down are chunks; each node above them is
+                  walked after the chunk before it, or alone when that one has a last node
+ Remarks        : recursion depth is at most depth
+ Func ID        : 185
+*******************************************************************/
+void _par_split_nodes (BST_PAR_JOB* job, NODE* root, int depth)
+{
+    BST_PAR_CHUNK* chunk;
+
+    if (!root)
+       return;
+    if (depth == 0)
+    {
+       chunk = &job->chunks[job->num_chunks++];
+       chunk->root = root;
+       chunk->last = NULL;
+       return;
+    }
+    _par_split_nodes (job, root->left, depth - 1);
+    chunk = job->num_chunks ? &job->chunks[job->num_chunks - 1] : NULL;
+    if (!chunk || chunk->last)
+    {
+       chunk = &job->chunks[job->num_chunks++];
+       chunk->root = NULL;
+    }
+    chunk->last = root;
+    _par_split_nodes (job, root->right, depth - 1);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _par_split_slots
+ Description    : Cuts the mapped snapshot of a tree into chunks, in key order.
+ Pre            : k is a slot of the snapshot; job->chunks has room for 2^(depth+1) more
+ Post           : as _par_split_nodes, over the implicit tree of the Eytzinger layout
+                  (children of k at 2k and 2k+1)
+ Remarks        :
+ Func ID        : 186
+*******************************************************************/
+void _par_split_slots (BST_PAR_JOB* job, int k, int depth)
+{
+    BST_PAR_CHUNK* chunk;
+
+    if (k > job->tree->frozen->count)
+       return;
+    if (depth == 0)
+    {
+       chunk = &job->chunks[job->num_chunks++];
+       chunk->slot = k;
+       chunk->last_slot = 0;
+       return;
+    }
+    _par_split_slots (job, 2 * k, depth - 1);
+    chunk = job->num_chunks ? &job->chunks[job->num_chunks - 1] : NULL;
+    if (!chunk || chunk->last_slot)
+    {
+       chunk = &job->chunks[job->num_chunks++];
+       chunk->slot = 0;
+    }
+    chunk->last_slot = k;
+    _par_split_slots (job, 2 * k + 1, depth - 1);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _par_split_leaves
+ Description    : Cuts a BST_MODE_BPLUS tree into chunks of linked leaves, in key order.
+ Pre            : job->chunks has room for max_chunks chunks
+ Post           : each chunk is the leaf run [leaf, stop) under one node of the lowest
+                  level that has at most max_chunks nodes
+ Remarks        : each level is expanded in place from the back, so a node is read before
+                  its slot is overwritten by children of the nodes before it
+ Func ID        : 187
+*******************************************************************/
+void _par_split_leaves (BST_PAR_JOB* job, int max_chunks)
+{
+    BST_PAR_CHUNK* chunks = job->chunks;
+    BST_BPLUS_NODE* node;
+    int n, total, i, j, c;
+
+    if (!job->tree->bplus_root)
+       return;
+    n = 1;
+    chunks[0].leaf = job->tree->bplus_root;
+    while (!chunks[0].leaf->leaf)
+    {
+        for (total = 0, i = 0; i < n; ++i)
+            total += chunks[i].leaf->num_keys + 1;
+        if (total > max_chunks)
+           break;
+        for (j = total, i = n - 1; i >= 0; --i)
+        {
+            node = chunks[i].leaf;
+            for (c = node->num_keys; c >= 0; --c)
+                chunks[--j].leaf = (BST_BPLUS_NODE*) node->ptrs[c];
+        }
+        n = total;
+    }
+    for (i = 0; i < n; ++i)
+    {
+        for (node = chunks[i].leaf; !node->leaf; node = (BST_BPLUS_NODE*) node->ptrs[0])
+            ;
+        chunks[i].leaf = node;
+    }
+    for (i = 0; i < n; ++i)
+        chunks[i].stop = (i + 1 < n) ? chunks[i + 1].leaf : NULL;
+    job->num_chunks = n;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _par_split_words
+ Description    : Cuts a dense tree into chunks of bitmap words, in key order.
+ Pre            : job->chunks has room for max_chunks chunks
+ Post           : each chunk is the words [slot, last_slot) of about an equal share
+ Remarks        : equal ranges of the domain, not of the keys present; keys are dense
+ Func ID        : 217
+*******************************************************************/
+void _par_split_words (BST_PAR_JOB* job, int max_chunks)
+{
+    BST_DENSE* dense = job->tree->dense;
+    int n = dense->num_words < max_chunks ? dense->num_words : max_chunks;
+    int i;
+
+    for (i = 0; i < n; ++i)
+    {
+        job->chunks[i].slot = (int)((long)dense->num_words * i / n);
+        job->chunks[i].last_slot = (int)((long)dense->num_words * (i + 1) / n);
+    }
+    job->num_chunks = n;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _par_worker
+ Description    : Runs one worker of the pool of _par_run.
+ Pre            : arg is pointer to a BST_PAR_WORKER
+ Post           : no chunk left to take or steal. Return 0
+ Remarks        : chunks only move between runs, never appear, so a worker that finds
+                  every run empty is done
+ Func ID        : 188
+*******************************************************************/
+int _par_worker (void* arg)
+{
+    BST_PAR_WORKER* worker = (BST_PAR_WORKER*) arg;
+    int chunk;
+
+    while ((chunk = _par_take (worker->job, worker->worker)) >= 0)
+        _par_walk (worker->job, chunk);
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : _par_take
+ Description    : Takes the next chunk for a worker, stealing once its own run is out.
+ Pre            : worker < job->num_workers
+ Post           : Return chunk number; -1 if every run is empty
+ Remarks        : a run [lo, hi) is one word, so taking or stealing is one compare and
+                  swap. A thief keeps the stolen upper half as its own run; its run was
+                  empty, so nobody else writes it meanwhile
+ Func ID        : 189
+*******************************************************************/
+int _par_take (BST_PAR_JOB* job, int worker)
+{
+    _Atomic(uint64_t)* own = &job->deques[worker].range;
+    _Atomic(uint64_t)* other;
+    uint64_t range;
+    uint32_t lo, hi, mid;
+    int i;
+
+    range = atomic_load (own);
+    while ((lo = BST_PAR_RUN_LO(range)) < (hi = BST_PAR_RUN_HI(range)))
+    {
+        if (atomic_compare_exchange_weak (own, &range, BST_PAR_RUN(lo + 1, hi)))
+           return (int)lo;
+    }
+    for (i = 1; i < job->num_workers; ++i)
+    {
+        other = &job->deques[(worker + i) % job->num_workers].range;
+        range = atomic_load (other);
+        while ((lo = BST_PAR_RUN_LO(range)) < (hi = BST_PAR_RUN_HI(range)))
+        {
+            mid = lo + (hi - lo) / 2;
+            if (atomic_compare_exchange_weak (other, &range, BST_PAR_RUN(lo, mid)))
+            {
+                if(trace_flag)
+                   printf("\n TRACE[189.01]: worker: %d, stole: [%u, %u)", worker, mid, hi);
+                atomic_store (own, BST_PAR_RUN(mid + 1, hi));
+                return (int)mid;
+            }
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************
+ Function Name  : _par_walk
+ Description    : Walks one chunk in key order.
+ Pre            : chunk was taken by _par_take
+ Post           : every data of the chunk mapped into its accumulator or processed
+ Remarks        : a subtree chunk walks as _traverse; a stack that cannot grow marks the
+                  job failed
+ Func ID        : 190
+*******************************************************************/
+void _par_walk (BST_PAR_JOB* job, int chunk)
+{
+    BST_PAR_CHUNK* part = &job->chunks[chunk];
+    BST_TREE* tree = job->tree;
+    BST_FROZEN* frozen = tree->frozen;
+    BST_BPLUS_NODE* leaf;
+    BST_LF_NODE* lfLeaf;
+    BST_STACK stack;
+    NODE* root;
+    unsigned int bits;
+    int i, k;
+
+    if (tree->dense)
+    {
+       for (i = part->slot; i < part->last_slot; ++i)
+       {
+           for (bits = tree->dense->bits[i]; bits; bits &= bits - 1)
+               _par_visit (job, chunk, tree->dense->slots[(i << 5) + BST_CTZ(bits)]);
+       }
+       return;
+    }
+    if (tree->mode & BST_MODE_MAPPED)
+    {
+       if ((k = part->slot) != 0)
+       {
+          while (2 * k <= frozen->count)
+              k *= 2;
+          while (true)
+          {
+              _par_visit (job, chunk, BST_Frozen_Data (frozen, k));
+              // in order successor of k inside the subtree of part->slot
+              if (2 * k + 1 <= frozen->count)
+              {
+                 for (k = 2 * k + 1; 2 * k <= frozen->count; k *= 2)
+                     ;
+                 continue;
+              }
+              while (k != part->slot && (k & 1))
+                  k >>= 1;
+              if (k == part->slot)
+                 break;
+              k >>= 1;
+          }
+       }
+       if (part->last_slot)
+          _par_visit (job, chunk, BST_Frozen_Data (frozen, part->last_slot));
+       return;
+    }
+    if (tree->mode & BST_MODE_BPLUS)
+    {
+       for (leaf = part->leaf; leaf != part->stop; leaf = leaf->next)
+       {
+           for (i = 0; i < leaf->num_keys; ++i)
+               _par_visit (job, chunk, leaf->ptrs[i]);
+       }
+       return;
+    }
+    if (BST_LOCK_FREE(tree))
+    {
+       for (lfLeaf = _lf_next (tree, NULL); lfLeaf; lfLeaf = _lf_next (tree, &lfLeaf->key))
+           _par_visit (job, chunk, lfLeaf->dataPtr);
+       return;
+    }
+    _stack_init (&stack);
+    root = part->root;
+    while (root || stack.top > 0)
+    {
+        while (root)
+        {
+            if (!_stack_push (&stack, root))
+            {
+                atomic_store (&job->failed, 1);
+                _stack_free (&stack);
+                return;
+            }
+            root = root->left;
+        }
+        root = _stack_pop (&stack);
+        _par_visit (job, chunk, root->dataPtr);
+        root = root->right;
+    }
+    _stack_free (&stack);
+    if (part->last)
+       _par_visit (job, chunk, part->last->dataPtr);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _par_visit
+ Description    : Hands one data of a chunk to the job's map or process.
+ Pre            : chunk is being walked by the calling thread
+ Post           : data mapped into the chunk's accumulator, or processed
+ Remarks        :
+ Func ID        : 191
+*******************************************************************/
+void _par_visit (BST_PAR_JOB* job, int chunk, void* dataPtr)
+{
+    if (job->map)
+       job->map (job->accs + (size_t)chunk * job->acc_stride, dataPtr);
+    else
+       job->process (dataPtr, chunk);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Empty
+ Description    : Returns true if tree is empty; false if any data.
+ Pre            : Tree has been created. (May be null)
+ Post           : Returns True if tree empty, false if any data
+ Remarks        :
+ Func ID        : 10
+*******************************************************************/
+bool BST_Empty(BST_TREE* tree)
+{
+    // Statements
+    return (BST_Count(tree) == 0);
+}
+
+/*******************************************************************
+ Function Name  : BST_Full
+ Description    : If there is no room for another node, returns true.
+ Pre            : Tree has been created. (May be null)
+ Post           : true if no room for another insert
+ Remarks        : answered from the pools; a slab is added only when a pool has
+                  no free object left, and it is kept for the next insert.
+                  A BST_MODE_MAPPED tree is always full, a dense tree once every key
+                  of its domain is present
+ Func ID        : 11
+*******************************************************************/
+bool BST_Full(BST_TREE* tree)
+{
+    BST_POOL* pool;
+
+    if (tree->mode & BST_MODE_MAPPED)
+       return true;
+    pool = &tree->node_pool;
+    if (tree->dense ? tree->count == tree->dense->num_slots
+                    : !pool->free_list && pool->bump == pool->bump_end && !_pool_grow(pool))
+       return true;
+    pool = &tree->data_pool;
+    if (pool->obj_size && !pool->free_list && pool->bump == pool->bump_end && !_pool_grow(pool))
+       return true;
+    return false;
+}
+/*******************************************************************
+ Function Name  : BST_Count
+ Description    : Returns number of nodes in tree.
+ Pre            : Tree has been created. (May be null)
+ Post           : Returns tree count
+ Remarks        : the count of the last published tree in BST_MODE_CONCURRENT. The
+                  lock-free engine adds up the slots' counts, exact once writers pause,
+                  and a sharded tree those of its shards
+ Func ID        : 12
+*******************************************************************/
+int BST_Count (BST_TREE* tree)
+{
+    long count = 0;
+    int i;
+
+    if (tree->shards)
+    {
+       for (i = 0; i < tree->shards->num_shards; ++i)
+           count += BST_Count (tree->shards->trees[i]);
+       return (int)count;
+    }
+    if (BST_LOCK_FREE(tree))
+    {
+       for (i = 0; i < BST_RCU_SLOTS; ++i)
+           count += atomic_load_explicit (&tree->rcu->slots[i].count, memory_order_relaxed);
+       return (int)count;
+    }
+    if (tree->mode & BST_MODE_CONCURRENT)
+       return atomic_load (&tree->rcu->count);
+    return (tree->count);
+}
+
+/*******************************************************************
+ Function Name  : BST_Read_Lock
+ Description    : Starts a read side section on a BST_MODE_CONCURRENT tree.
+ Pre            : tree has been created
+ Post           : nodes and data the thread reaches stay valid until the matching
+                  BST_Read_Unlock. Return the phase to pass to it (0 if not concurrent);
+                  -1 for a sharded tree, which protects nothing (system_status
+                  ERR_INVALID_DATA)
+ Remarks        : never blocks and takes no lock: it bumps a counter in the thread's
+                  slot, a cache line shared only with every BST_RCU_SLOTS'th thread.
+                  Sections may nest. A thread must not insert or delete in the tree
+                  while it holds one, since the writer may wait for it.
+                  Each shard of a sharded tree has its own readers, so lock the
+                  BST_Get_Shard of the key instead
+ Func ID        : 148
+*******************************************************************/
+int BST_Read_Lock (BST_TREE* tree)
+{
+    int phase;
+
+    if (tree->shards)
+    {
+       if(trace_flag)
+          printf("\n TRACE[148.01]: read lock on a sharded tree");
+       system_status = ERR_INVALID_DATA;
+       return -1;
+    }
+    if (!(tree->mode & BST_MODE_CONCURRENT))
+       return 0;
+    phase = (int)(atomic_load_explicit (&tree->rcu->phase, memory_order_relaxed) & 1);
+    // sequentially consistent, so the root is read after the writer sees this reader
+    atomic_fetch_add (&_rcu_slot (tree->rcu)->active[phase], 1);
+    return phase;
+}
+
+/*******************************************************************
+ Function Name  : BST_Read_Unlock
+ Description    : Ends a read side section started by BST_Read_Lock.
+ Pre            : phase was returned by the matching BST_Read_Lock of this thread
+ Post           : nodes and data reached in the section may be freed by a writer
+ Remarks        : a failed BST_Read_Lock (-1) has nothing to end
+ Func ID        : 149
+*******************************************************************/
+void BST_Read_Unlock (BST_TREE* tree, int phase)
+{
+    if ((tree->mode & BST_MODE_CONCURRENT) && phase >= 0)
+       atomic_fetch_sub_explicit (&tree->rcu->slots[bst_rcu_slot].active[phase], 1, memory_order_release);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Alloc_Data
+ Description    : Allocates a zeroed, fixed size data record from the tree's data pool.
+ Pre            : tree has been created. data_size is size of the record; every call
+                  on a tree must pass the same size
+ Post           : Return pointer to record; null if overflow or size differs
+ Remarks        : once used, the tree recycles deleted records into the pool and
+                  BST_Destroy releases them a slab at a time (with the arena of a
+                  BST_Create_Arena tree). Records not taken from
+                  here must not be inserted in the same tree. BST_MODE_CONCURRENT
+                  guards the pool with its own lock, as writers recycle into it.
+                  A sharded tree's records come from calloc, as any shard may free them.
+ Func ID        : 33
+*******************************************************************/
+void* BST_Alloc_Data (BST_TREE* tree, size_t data_size)
+{
+    void* dataPtr = NULL;
+
+    if (tree->shards)
+       return calloc (1, data_size);
+    if (tree->mode & BST_MODE_CONCURRENT)
+       mtx_lock (&tree->rcu->data_lock);
+    if (!tree->data_pool.obj_size)
+    {
+       _pool_init(&tree->data_pool, data_size);
+       tree->data_pool.arena = tree->arena;
+    }
+    if (data_size <= tree->data_pool.obj_size && data_size + sizeof (void*) > tree->data_pool.obj_size)
+       dataPtr = _pool_alloc(&tree->data_pool);
+    if (tree->mode & BST_MODE_CONCURRENT)
+       mtx_unlock (&tree->rcu->data_lock);
+    if (dataPtr)
+       memset(dataPtr, 0, tree->data_pool.obj_size);
+    return dataPtr;
+}
+
+/*******************************************************************
+ Function Name  : BST_Free_Data
+ Description    : Releases a data record owned by the tree.
+ Pre            : dataPtr came from BST_Alloc_Data of this tree or, if that was
+                  never called, from malloc/calloc
+ Post           : record recycled
+ Remarks        : the destroy of a BST_Create_Arena tree is called on it first
+ Func ID        : 34
+*******************************************************************/
+void BST_Free_Data (BST_TREE* tree, void* dataPtr)
+{
+    if (tree->arena && tree->arena->destroy)
+       tree->arena->destroy (dataPtr);
+    if (tree->mode & BST_MODE_CONCURRENT)
+       mtx_lock (&tree->rcu->data_lock);
+    if (tree->data_pool.obj_size)
+       _pool_free(&tree->data_pool, dataPtr);
+    else
+       free (dataPtr);
+    if (tree->mode & BST_MODE_CONCURRENT)
+       mtx_unlock (&tree->rcu->data_lock);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_BuildFromSorted
+ Description    : Builds a perfectly balanced tree from an array of data sorted by key.
+ Pre            : tree has been created and is empty. dataArray holds count data pointers
+                  in non decreasing key order
+ Post           : data inserted in O(count). Return true, or false if tree was not empty,
+                  data was out of order or memory overflow; tree is then left empty and
+                  the data stays with the caller. Secondary indexes are filled after the build
+ Remarks        : see BST_BuildFromStream
+ Func ID        : 43
+*******************************************************************/
+bool BST_BuildFromSorted (BST_TREE* tree, void** dataArray, int count)
+{
+    BST_ARRAY_STREAM stream;
+
+    stream.dataArray = dataArray;
+    stream.index = 0;
+    return BST_BuildFromStream (tree, _next_array, &stream, count);
+}
+
+/*******************************************************************
+ Function Name  : BST_BuildFromStream
+ Description    : Builds a perfectly balanced tree from a stream of data sorted by key.
+ Pre            : tree has been created and is empty. next returns the next data pointer
+                  of the stream each time it is called with ctx, count times, in non
+                  decreasing key order (increasing in BST_MODE_HASH)
+ Post           : data inserted in O(count). Return true, or false if tree was not empty,
+                  data was out of order or memory overflow; tree is then left empty and
+                  the data stays with the caller. Secondary indexes are filled after the build.
+                  A journaled tree is not built, but filled before BST_Journal_Open
+ Remarks        : the tree shape is laid out in order with a frame stack of depth log2(count),
+                  so each record is pulled exactly once and compared only with its
+                  predecessor to check the sort order. Heights follow from subtree sizes.
+                  BST_MODE_CONCURRENT builds under the writer lock and publishes the
+                  whole tree at once; the lock-free engine is not built
+ Func ID        : 44
+*******************************************************************/
+bool BST_BuildFromStream (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count)
+{
+    bool success;
+
+    if (tree->shards)
+       return false;
+    if (!(tree->mode & BST_MODE_CONCURRENT))
+       return _build_stream (tree, next, ctx, count);
+    if (BST_LOCK_FREE(tree) || !_rcu_write_begin (tree, 0))
+       return false;
+    // a failed build drops the node pool, so no retired node may still be in it
+    _rcu_reclaim (tree);
+    success = _build_stream (tree, next, ctx, count);
+    _rcu_write_end (tree);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _build_stream
+ Description    : Builds a balanced tree from a stream for BST_BuildFromStream.
+ Pre            : in BST_MODE_CONCURRENT, caller holds the writer lock
+ Post           : as BST_BuildFromStream
+ Remarks        :
+ Func ID        : 157
+*******************************************************************/
+bool _build_stream (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count)
+{
+    BST_BUILD_FRAME frames[BST_MAX_HEIGHT];
+    BST_BUILD_FRAME* frame;
+    void* prevPtr = NULL;
+    void* dataPtr;
+    int top = 0, size, mid, i;
+
+    if (tree->count != 0 || count < 0 || (tree->mode & BST_MODE_MAPPED) || tree->journal)
+       return false;
+    if ((tree->mode & BST_MODE_HASH) && !_hash_reserve(&tree->hash, count))
+       return false;
+    frames[0].lo = 0;
+    frames[0].hi = count;
+    frames[0].link = &tree->root;
+    frames[0].state = 0;
+    // the B+ and dense engines are built by appending, below
+    top = ((tree->mode & BST_MODE_BPLUS) || tree->dense) ? 0 : 1;
+    while (top > 0)
+    {
+        frame = &frames[top - 1];
+        mid = frame->lo + (frame->hi - frame->lo) / 2;
+        if (frame->state == 0)
+        {
+            // allocate subtree root, then build its left subtree
+            size = frame->hi - frame->lo;
+            if (size == 0)
+            {
+                *frame->link = NULL;
+                --top;
+                continue;
+            }
+            frame->node = (NODE*) _pool_alloc(&tree->node_pool);
+            if (!frame->node)
+               break;
+            *frame->link = frame->node;
+            frame->node->size = size;
+            frame->node->height = 0;
+            frame->node->fresh = 0;
+            while (size)
+            {
+                ++frame->node->height;
+                size >>= 1;
+            }
+            frame->state = 1;
+            frames[top].lo = frame->lo;
+            frames[top].hi = mid;
+            frames[top].link = &frame->node->left;
+            frames[top].state = 0;
+            ++top;
+        }
+        else if (frame->state == 1)
+        {
+            // left subtree done: take next data in order, then build right subtree
+            dataPtr = next(ctx);
+            // a hashed tree takes no duplicate keys either
+            if (prevPtr && tree->compare(prevPtr, dataPtr) > ((tree->mode & BST_MODE_HASH) ? -1 : 0))
+            {
+                if(trace_flag)
+                   printf("\n TRACE[44.01]: data out of order at %d: %p", mid, dataPtr);
+                break;
+            }
+            prevPtr = dataPtr;
+            frame->node->dataPtr = dataPtr;
+            if (tree->mode & BST_MODE_INLINE_KEY)
+               frame->node->key = tree->getKey(dataPtr);
+            if (tree->mode & BST_MODE_HASH)
+               _hash_put(&tree->hash, frame->node->key, dataPtr);
+            frame->state = 2;
+            frames[top].lo = mid + 1;
+            frames[top].hi = frame->hi;
+            frames[top].link = &frame->node->right;
+            frames[top].state = 0;
+            ++top;
+        }
+        else
+            --top;
+    }
+    if (top > 0 || ((tree->mode & BST_MODE_BPLUS) && !_bplus_build(tree, next, ctx, count))
+        || (tree->dense && !_dense_build(tree, next, ctx, count)))
+    {
+        // failed: the tree was empty, so the whole node pool can go
+        tree->root = NULL;
+        tree->bplus_root = NULL;
+        _pool_destroy(&tree->node_pool);
+        _hash_clear(&tree->hash);
+        return false;
+    }
+    tree->count = count;
+    for (i = 0; i < tree->num_indexes && _index_fill(tree, tree->indexes[i]); ++i)
+        ;
+    if (i < tree->num_indexes || (tree->trie && !_trie_fill(tree, tree->trie)))
+    {
+        // the indexes were empty too, so drop all their nodes with the tree's
+        for (i = 0; i < tree->num_indexes; ++i)
+        {
+            tree->indexes[i]->root = NULL;
+            tree->indexes[i]->count = 0;
+            _pool_destroy(&tree->indexes[i]->node_pool);
+        }
+        if (tree->trie)
+           _trie_clear(tree->trie);
+        tree->root = NULL;
+        tree->bplus_root = NULL;
+        tree->count = 0;
+        _pool_destroy(&tree->node_pool);
+        _hash_clear(&tree->hash);
+        if (tree->dense)
+           memset(tree->dense->bits, 0, (size_t)tree->dense->num_words * sizeof (unsigned int));
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _next_array
+ Description    : stream function over an array of data pointers.
+ Pre            : ctx is pointer to a BST_ARRAY_STREAM
+ Post           : Return next data pointer of the array
+ Remarks        :
+ Func ID        : 45
+*******************************************************************/
+void* _next_array (void* ctx)
+{
+    BST_ARRAY_STREAM* stream = (BST_ARRAY_STREAM*) ctx;
+
+    return stream->dataArray[stream->index++];
+}
+
+/*******************************************************************
+ Function Name  : BST_InsertBatch
+ Description    : inserts a batch of data, reusing the previous insertion path (finger).
+ Pre            : tree has been created. dataArray holds count data pointers, best
+                  sorted by key (ascending or descending)
+ Post           : data inserted as by BST_Insert. Return number of data inserted;
+                  less than count only on memory overflow (or a duplicate key in BST_MODE_HASH)
+ Remarks        : the finger keeps every link of the last insertion path with the key
+                  range that link covers. The next data climbs only until a link whose
+                  range holds its key and descends from there, so a sorted batch of k
+                  keys costs about O(k log(n/k)) compares instead of O(k log n).
+                  A rotation at a finger link keeps that link's range, so the finger is
+                  only cut below it. BST_MODE_ORDER_STAT still bumps every ancestor's count.
+                  BST_MODE_BPLUS inserts one by one: its descent is already short, as
+                  does a dense tree, which has none.
+                  So does a journaled tree, logging each insert, a sharded tree, and
+                  BST_MODE_CONCURRENT, whose readers see each insert as it is published
+ Func ID        : 46
+*******************************************************************/
+int BST_InsertBatch (BST_TREE* tree, void** dataArray, int count)
+{
+    BST_FINGER finger[BST_MAX_HEIGHT];
+    NODE** link;
+    NODE* newPtr;
+    NODE* oldPtr;
+    NODE* lastPtr = NULL;
+    int top, depth, inserted, old_height, key = 0, dir = 0;
+
+    if ((tree->mode & (BST_MODE_BPLUS | BST_MODE_MAPPED | BST_MODE_CONCURRENT)) || tree->journal || tree->shards || tree->dense)
+    {
+        for (inserted = 0; inserted < count && BST_Insert(tree, dataArray[inserted]); ++inserted)
+            ;
+        return inserted;
+    }
+    finger[0].link = &tree->root;
+    finger[0].lo = NULL;
+    finger[0].hi = NULL;
+    top = 1;
+    for (inserted = 0; inserted < count; ++inserted)
+    {
+        if ((tree->mode & BST_MODE_HASH) && (_hash_find(&tree->hash, tree->getKey(dataArray[inserted])) || !_hash_reserve(&tree->hash, tree->count + 1)))
+           break;
+        if ((tree->num_indexes || tree->trie) && !_index_insert(tree, dataArray[inserted]))
+           break;
+        newPtr = (NODE*)_pool_alloc(&tree->node_pool);
+        if (!newPtr)
+        {
+           _index_delete(tree, dataArray[inserted]);
+           break;
+        }
+        newPtr->right = NULL;
+        newPtr->left = NULL;
+        newPtr->dataPtr = dataArray[inserted];
+        newPtr->height = 1;
+        newPtr->size = 1;
+        newPtr->fresh = 0;
+        if (tree->mode & BST_MODE_INLINE_KEY)
+           key = newPtr->key = tree->getKey(newPtr->dataPtr);
+        // climb until the finger link's range holds the new key; every finger range holds
+        // the last key, so only the bound on the side the new key moved to can fail
+        if (lastPtr)
+           dir = _compare_key(tree, key, newPtr->dataPtr, lastPtr);
+        if (dir >= 0)
+        {
+            while (top > 1 && finger[top - 1].hi && _compare_key(tree, key, newPtr->dataPtr, finger[top - 1].hi) >= 0)
+               --top;
+        }
+        else
+        {
+            while (top > 1 && finger[top - 1].lo && _compare_key(tree, key, newPtr->dataPtr, finger[top - 1].lo) < 0)
+               --top;
+        }
+        if(trace_flag)
+           printf("\n TRACE[46.01]: data: %p, restart at depth: %d", newPtr->dataPtr, top - 1);
+        if (tree->mode & BST_MODE_ORDER_STAT)
+        {
+            for (depth = 0; depth < top - 1; ++depth)
+                ++(*finger[depth].link)->size;
+        }
+        // descend from there as _insert does, extending the finger
+        link = finger[top - 1].link;
+        while (*link)
+        {
+            if (tree->mode & BST_MODE_ORDER_STAT)
+               ++(*link)->size;
+            if (top < BST_MAX_HEIGHT)
+            {
+                finger[top].lo = finger[top - 1].lo;
+                finger[top].hi = finger[top - 1].hi;
+            }
+            if (_compare_key(tree, key, newPtr->dataPtr, *link) < 0)
+            {
+                if (top < BST_MAX_HEIGHT)
+                   finger[top].hi = *link;
+                link = &(*link)->left;
+            }
+            else
+            {
+                if (top < BST_MAX_HEIGHT)
+                   finger[top].lo = *link;
+                link = &(*link)->right;
+            }
+            if (top < BST_MAX_HEIGHT)
+               finger[top++].link = link;
+        }
+        *link = newPtr;
+        lastPtr = newPtr;
+        ++tree->count;
+        if (tree->mode & BST_MODE_HASH)
+           _hash_put(&tree->hash, key, newPtr->dataPtr);
+        if (!(tree->mode & BST_MODE_AVL))
+           continue;
+        // retrace from the new node's parent; a rotation cuts the finger below it
+        for (depth = top - 2; depth >= 0; --depth)
+        {
+            link = finger[depth].link;
+            oldPtr = *link;
+            old_height = oldPtr->height;
+            *link = _rebalance(tree, oldPtr);
+            if (*link != oldPtr)
+               top = depth + 1;
+            if ((*link)->height == old_height)
+               break;
+        }
+    }
+    return inserted;
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Create
+ Description    : Allocates an ordered cursor over a tree.
+ Pre            : tree has been created
+ Post           : Return cursor, not yet positioned; null if overflow or the tree is
+                  a lock-free or sharded one
+ Remarks        : a cursor is invalid once its tree is modified; reposition it with
+                  BST_Cursor_First, BST_Cursor_Last, BST_Cursor_Seek or BST_Cursor_Range.
+                  In BST_MODE_CONCURRENT it stays valid, on the tree published when it was
+                  positioned, while the caller holds a BST_Read_Lock taken before that
+ Func ID        : 47
+*******************************************************************/
+BST_CURSOR* BST_Cursor_Create (BST_TREE* tree)
+{
+    BST_CURSOR* cursor;
+
+    if (BST_LOCK_FREE(tree) || tree->shards)
+       return NULL;
+    cursor = (BST_CURSOR*) calloc (1, sizeof (BST_CURSOR));
+    if (cursor)
+    {
+       cursor->tree = tree;
+       cursor->hiPtr = NULL;
+       _stack_init(&cursor->path);
+       // slot 0 is a key of a dense tree; -1 is off the tree
+       if (tree->dense)
+          cursor->slot = -1;
+    }
+    return cursor;
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Destroy
+ Description    : Releases a cursor.
+ Pre            : cursor came from BST_Cursor_Create (may be null)
+ Post           : cursor released. Return null cursor pointer
+ Remarks        :
+ Func ID        : 48
+*******************************************************************/
+BST_CURSOR* BST_Cursor_Destroy (BST_CURSOR* cursor)
+{
+    if (cursor)
+       _stack_free(&cursor->path);
+    free (cursor);
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_First
+ Description    : Positions cursor at the smallest key, with no range end.
+ Pre            : cursor has been created
+ Post           : Return data at cursor; null if tree empty
+ Remarks        :
+ Func ID        : 49
+*******************************************************************/
+void* BST_Cursor_First (BST_CURSOR* cursor)
+{
+    _stack_free(&cursor->path);
+    cursor->hiPtr = NULL;
+    if (cursor->tree->mode & BST_MODE_MAPPED)
+    {
+        cursor->slot = BST_Frozen_First(cursor->tree->frozen);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->dense)
+    {
+        cursor->slot = _dense_next(cursor->tree->dense, 0);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->mode & BST_MODE_BPLUS)
+    {
+        cursor->leaf = _bplus_edge(cursor->tree, true);
+        cursor->slot = 0;
+        return BST_Cursor_Data(cursor);
+    }
+    return _cursor_descend(cursor, _root(cursor->tree), true);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Last
+ Description    : Positions cursor at the largest key, with no range end.
+ Pre            : cursor has been created
+ Post           : Return data at cursor; null if tree empty
+ Remarks        : BST_Cursor_Prev from here walks the tree in descending order
+ Func ID        : 50
+*******************************************************************/
+void* BST_Cursor_Last (BST_CURSOR* cursor)
+{
+    _stack_free(&cursor->path);
+    cursor->hiPtr = NULL;
+    if (cursor->tree->mode & BST_MODE_MAPPED)
+    {
+        cursor->slot = BST_Frozen_Last(cursor->tree->frozen);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->dense)
+    {
+        cursor->slot = _dense_prev(cursor->tree->dense, cursor->tree->dense->num_slots - 1);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->mode & BST_MODE_BPLUS)
+    {
+        cursor->leaf = _bplus_edge(cursor->tree, false);
+        cursor->slot = cursor->leaf ? cursor->leaf->num_keys - 1 : 0;
+        return BST_Cursor_Data(cursor);
+    }
+    return _cursor_descend(cursor, _root(cursor->tree), false);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Seek
+ Description    : Positions cursor at the first data whose key is not less than keyPtr
+                  (lower bound), with no range end.
+ Pre            : cursor has been created. keyPtr is pointer to key as for BST_Retrieve
+ Post           : Return data at cursor; null if every key is less than keyPtr
+ Remarks        : O(log n); the path to the lower bound is a prefix of the search path
+ Func ID        : 51
+*******************************************************************/
+void* BST_Cursor_Seek (BST_CURSOR* cursor, void* keyPtr)
+{
+    BST_TREE* tree = cursor->tree;
+    NODE* root = _root(tree);
+    int found = 0, key = 0;
+
+    _stack_free(&cursor->path);
+    cursor->hiPtr = NULL;
+    if (tree->mode & BST_MODE_INLINE_KEY)
+       key = tree->getKey(keyPtr);
+    if (tree->mode & BST_MODE_MAPPED)
+    {
+        cursor->slot = BST_Frozen_Seek(tree->frozen, keyPtr);
+        return BST_Cursor_Data(cursor);
+    }
+    if (tree->dense)
+    {
+        // a key below the domain seeks its first slot, one above it finds none
+        found = key <= tree->dense->lo ? 0 : _dense_slot(tree->dense, key);
+        cursor->slot = found < 0 ? -1 : _dense_next(tree->dense, found);
+        return BST_Cursor_Data(cursor);
+    }
+    if (tree->mode & BST_MODE_BPLUS)
+    {
+        cursor->leaf = _bplus_seek(tree, key, &cursor->slot);
+        return BST_Cursor_Data(cursor);
+    }
+    while (root)
+    {
+        if (!_stack_push(&cursor->path, root))
+        {
+            system_status = ERR_BST_FULL;
+            _stack_free(&cursor->path);
+            return NULL;
+        }
+        if (_compare_key(tree, key, keyPtr, root) <= 0)
+        {
+            found = cursor->path.top;
+            root = root->left;
+        }
+        else
+            root = root->right;
+    }
+    cursor->path.top = found;
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Range
+ Description    : Positions cursor for a range scan of keys in [loKey, hiKey).
+ Pre            : cursor has been created. loKey and hiKey are pointers to keys as for
+                  BST_Retrieve; hiKey must stay valid during the scan. A null loKey
+                  starts at the first key, a null hiKey runs to the end of the tree
+ Post           : Return first data in range; null if range empty
+ Remarks        : BST_Cursor_Next returns null past hiKey, so a range of k data costs O(log n + k)
+ Func ID        : 52
+*******************************************************************/
+void* BST_Cursor_Range (BST_CURSOR* cursor, void* loKey, void* hiKey)
+{
+    if (loKey)
+       BST_Cursor_Seek(cursor, loKey);
+    else
+       BST_Cursor_First(cursor);
+    cursor->hiPtr = hiKey;
+    if (hiKey && (cursor->tree->mode & BST_MODE_INLINE_KEY))
+       cursor->hiKey = cursor->tree->getKey(hiKey);
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Next
+ Description    : Moves cursor to the next key in order.
+ Pre            : cursor has been positioned
+ Post           : Return data at cursor; null at end of tree or range
+ Remarks        : amortised O(1)
+ Func ID        : 53
+*******************************************************************/
+void* BST_Cursor_Next (BST_CURSOR* cursor)
+{
+    BST_STACK* path = &cursor->path;
+    NODE* child;
+
+    if (cursor->tree->mode & BST_MODE_MAPPED)
+    {
+        if (cursor->slot)
+           cursor->slot = BST_Frozen_Next(cursor->tree->frozen, cursor->slot);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->dense)
+    {
+        if (cursor->slot >= 0)
+           cursor->slot = _dense_next(cursor->tree->dense, cursor->slot + 1);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->mode & BST_MODE_BPLUS)
+    {
+        if (cursor->leaf && ++cursor->slot == cursor->leaf->num_keys)
+        {
+            cursor->leaf = cursor->leaf->next;
+            cursor->slot = 0;
+        }
+        return BST_Cursor_Data(cursor);
+    }
+    if (path->top == 0)
+       return NULL;
+    child = path->items[path->top - 1];
+    if (child->right)
+       return _cursor_descend(cursor, child->right, true);
+    // climb until we come up from a left child
+    do
+    {
+        child = _stack_pop(path);
+    } while (path->top > 0 && path->items[path->top - 1]->left != child);
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Prev
+ Description    : Moves cursor to the previous key in order.
+ Pre            : cursor has been positioned
+ Post           : Return data at cursor; null at start of tree
+ Remarks        : amortised O(1)
+ Func ID        : 54
+*******************************************************************/
+void* BST_Cursor_Prev (BST_CURSOR* cursor)
+{
+    BST_STACK* path = &cursor->path;
+    NODE* child;
+
+    if (cursor->tree->mode & BST_MODE_MAPPED)
+    {
+        if (cursor->slot)
+           cursor->slot = BST_Frozen_Prev(cursor->tree->frozen, cursor->slot);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->dense)
+    {
+        if (cursor->slot >= 0)
+           cursor->slot = _dense_prev(cursor->tree->dense, cursor->slot - 1);
+        return BST_Cursor_Data(cursor);
+    }
+    if (cursor->tree->mode & BST_MODE_BPLUS)
+    {
+        if (cursor->leaf && cursor->slot-- == 0)
+        {
+            cursor->leaf = cursor->leaf->prev;
+            cursor->slot = cursor->leaf ? cursor->leaf->num_keys - 1 : 0;
+        }
+        return BST_Cursor_Data(cursor);
+    }
+    if (path->top == 0)
+       return NULL;
+    child = path->items[path->top - 1];
+    if (child->left)
+       return _cursor_descend(cursor, child->left, false);
+    // climb until we come up from a right child
+    do
+    {
+        child = _stack_pop(path);
+    } while (path->top > 0 && path->items[path->top - 1]->right != child);
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Data
+ Description    : Returns data at cursor.
+ Pre            : cursor has been created
+ Post           : Return data at cursor; null if cursor is off the tree or past its range end
+ Remarks        :
+ Func ID        : 55
+*******************************************************************/
+void* BST_Cursor_Data (BST_CURSOR* cursor)
+{
+    NODE* node;
+
+    if (cursor->tree->mode & BST_MODE_MAPPED)
+    {
+        if (!cursor->slot)
+           return NULL;
+        if (cursor->hiPtr && cursor->tree->frozen->keys[cursor->slot] >= cursor->hiKey)
+        {
+            cursor->slot = 0;
+            return NULL;
+        }
+        return BST_Frozen_Data(cursor->tree->frozen, cursor->slot);
+    }
+    if (cursor->tree->dense)
+    {
+        if (cursor->slot < 0)
+           return NULL;
+        if (cursor->hiPtr && (long)cursor->tree->dense->lo + cursor->slot >= cursor->hiKey)
+        {
+            cursor->slot = -1;
+            return NULL;
+        }
+        return cursor->tree->dense->slots[cursor->slot];
+    }
+    if (cursor->tree->mode & BST_MODE_BPLUS)
+    {
+        if (!cursor->leaf)
+           return NULL;
+        if (cursor->hiPtr && cursor->leaf->keys[cursor->slot] >= cursor->hiKey)
+        {
+            cursor->leaf = NULL;
+            return NULL;
+        }
+        return cursor->leaf->ptrs[cursor->slot];
+    }
+    if (cursor->path.top == 0)
+       return NULL;
+    node = cursor->path.items[cursor->path.top - 1];
+    if (cursor->hiPtr && _compare_key(cursor->tree, cursor->hiKey, cursor->hiPtr, node) <= 0)
+    {
+        // past range end: park the cursor
+        cursor->path.top = 0;
+        return NULL;
+    }
+    return node->dataPtr;
+}
+
+/*******************************************************************
+ Function Name  : _cursor_descend
+ Description    : pushes root and its leftmost (or rightmost) chain on the cursor path.
+ Pre            : cursor path leads to the parent of root (may be null)
+ Post           : Return data at cursor; null if root null or stack overflow
+ Remarks        :
+ Func ID        : 56
+*******************************************************************/
+void* _cursor_descend (BST_CURSOR* cursor, NODE* root, bool left)
+{
+    while (root)
+    {
+        if (!_stack_push(&cursor->path, root))
+        {
+            system_status = ERR_BST_FULL;
+            _stack_free(&cursor->path);
+            return NULL;
+        }
+        root = left ? root->left : root->right;
+    }
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Select
+ Description    : Returns the data with the given rank (index in key order).
+ Pre            : tree was created with BST_MODE_ORDER_STAT. index is 0 based
+ Post           : Return data of index-th smallest key; null if index out of range
+                  or tree keeps no subtree counts
+ Remarks        : O(log n) in BST_MODE_AVL; a sharded tree first skips the counts of
+                  the shards below. A dense tree counts bitmap words, with or without
+                  BST_MODE_ORDER_STAT
+ Func ID        : 59
+*******************************************************************/
+void* BST_Select (BST_TREE* tree, int index)
+{
+    NODE* root;
+    int left, i;
+
+    if (tree->shards)
+    {
+       for (i = 0; i < tree->shards->num_shards - 1 && index >= (left = BST_Count (tree->shards->trees[i])); ++i)
+           index -= left;
+       return BST_Select (tree->shards->trees[i], index);
+    }
+    if (tree->dense)
+       return (index < 0 || index >= tree->count) ? NULL : tree->dense->slots[_dense_select (tree->dense, index)];
+    root = _root(tree);
+    if (!(tree->mode & BST_MODE_ORDER_STAT) || index < 0 || index >= BST_Count(tree))
+       return NULL;
+    while (root)
+    {
+        left = _size(root->left);
+        if (index == left)
+           return root->dataPtr;
+        if (index < left)
+           root = root->left;
+        else
+        {
+            index -= left + 1;
+            root = root->right;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : BST_Rank
+ Description    : Returns the number of data whose key is less than keyPtr.
+ Pre            : tree was created with BST_MODE_ORDER_STAT. keyPtr is pointer to key
+                  as for BST_Retrieve
+ Post           : Return rank of key (index it has or would have); -1 if tree keeps
+                  no subtree counts
+ Remarks        : O(log n) in BST_MODE_AVL; a sharded tree adds the counts of the shards
+                  below the key's. A dense tree counts bitmap words, with or without
+                  BST_MODE_ORDER_STAT
+ Func ID        : 60
+*******************************************************************/
+int BST_Rank (BST_TREE* tree, void* keyPtr)
+{
+    NODE* root;
+    int rank = 0, key = 0, i, shard;
+
+    if (tree->shards)
+    {
+       shard = _shard_index (tree->shards, tree->getKey (keyPtr));
+       for (i = 0; i < shard; ++i)
+           rank += BST_Count (tree->shards->trees[i]);
+       key = BST_Rank (tree->shards->trees[shard], keyPtr);
+       return key < 0 ? -1 : rank + key;
+    }
+    if (tree->dense)
+    {
+       // a key past either end of the domain ranks as the domain's edge
+       key = tree->getKey (keyPtr);
+       if (key <= tree->dense->lo)
+          return 0;
+       i = _dense_slot (tree->dense, key);
+       return _dense_rank (tree->dense, i < 0 ? tree->dense->num_slots : i);
+    }
+    root = _root(tree);
+    if (!(tree->mode & BST_MODE_ORDER_STAT))
+       return -1;
+    if (tree->mode & BST_MODE_INLINE_KEY)
+       key = tree->getKey(keyPtr);
+    while (root)
+    {
+        if (_compare_key(tree, key, keyPtr, root) <= 0)
+           root = root->left;
+        else
+        {
+            rank += _size(root->left) + 1;
+            root = root->right;
+        }
+    }
+    return rank;
+}
+
+/*******************************************************************
+ Function Name  : BST_Cursor_Select
+ Description    : Positions cursor at the data with the given rank, with no range end.
+ Pre            : cursor tree was created with BST_MODE_ORDER_STAT. index is 0 based
+ Post           : Return data at cursor; null if index out of range
+ Remarks        : with BST_Cursor_Next, a page of k data costs O(log n + k); a dense
+                  tree needs no BST_MODE_ORDER_STAT
+ Func ID        : 61
+*******************************************************************/
+void* BST_Cursor_Select (BST_CURSOR* cursor, int index)
+{
+    BST_TREE* tree = cursor->tree;
+    NODE* root = _root(tree);
+    int left;
+
+    _stack_free(&cursor->path);
+    cursor->hiPtr = NULL;
+    if (tree->dense)
+    {
+        cursor->slot = (index < 0 || index >= tree->count) ? -1 : _dense_select (tree->dense, index);
+        return BST_Cursor_Data(cursor);
+    }
+    if (!(tree->mode & BST_MODE_ORDER_STAT) || index < 0 || index >= BST_Count(tree))
+       return NULL;
+    while (root)
+    {
+        if (!_stack_push(&cursor->path, root))
+        {
+            system_status = ERR_BST_FULL;
+            _stack_free(&cursor->path);
+            return NULL;
+        }
+        left = _size(root->left);
+        if (index == left)
+           break;
+        if (index < left)
+           root = root->left;
+        else
+        {
+            index -= left + 1;
+            root = root->right;
+        }
+    }
+    return BST_Cursor_Data(cursor);
+}
+
+/*******************************************************************
+ Function Name  : BST_Add_Index
+ Description    : Adds a secondary index over the data of a tree.
+ Pre            : tree has been created. compare orders data of the tree and must not
+                  treat two data as equal (break ties by the tree's own key)
+ Post           : index filled with the tree's data. Return index, or null on memory
+                  overflow, when the tree already has BST_MAX_INDEXES indexes or
+                  is BST_MODE_CONCURRENT or sharded
+ Remarks        : the index holds pointers to the tree's data, not copies, and is kept
+                  in sync by BST_Insert, BST_InsertBatch, BST_BuildFromStream and
+                  BST_Delete on tree. Query it with cursors, BST_Select and BST_Rank,
+                  but never insert or delete in it directly. BST_Destroy of tree
+                  destroys it.
+ Func ID        : 63
+*******************************************************************/
+BST_TREE* BST_Add_Index (BST_TREE* tree, int (*compare) (void* argu1, void* argu2), const uint8_t mode)
+{
+    BST_TREE* index;
+
+    if (tree->num_indexes >= BST_MAX_INDEXES || (tree->mode & BST_MODE_CONCURRENT) || tree->shards)
+       return NULL;
+    index = BST_Create(compare, mode | BST_MODE_INDEX);
+    if (!index)
+       return NULL;
+    if (!_index_fill(tree, index))
+       return BST_Destroy(index);
+    tree->indexes[tree->num_indexes++] = index;
+    if(trace_flag)
+       printf("\n TRACE[63.01]: index[%d]: %p", tree->num_indexes - 1, (void *)index);
+    return index;
+}
+
+/*******************************************************************
+ Function Name  : BST_Get_Index
+ Description    : Returns a secondary index of a tree.
+ Pre            : tree has been created
+ Post           : Return index added by the index_num'th (from 0) BST_Add_Index; null if none
+ Remarks        :
+ Func ID        : 64
+*******************************************************************/
+BST_TREE* BST_Get_Index (BST_TREE* tree, int index_num)
+{
+    if (!tree || index_num < 0 || index_num >= tree->num_indexes)
+       return NULL;
+    return tree->indexes[index_num];
+}
+
+/*******************************************************************
+ Function Name  : _index_insert
+ Description    : Inserts data in every secondary index and the string index of a tree.
+ Pre            : data is not yet in the tree
+ Post           : Return true, or false on memory overflow with data in none of the indexes
+ Remarks        :
+ Func ID        : 65
+*******************************************************************/
+bool _index_insert (BST_TREE* tree, void* dataPtr)
+{
+    int i;
+
+    for (i = 0; i < tree->num_indexes; ++i)
+    {
+        if (!BST_Insert(tree->indexes[i], dataPtr))
+        {
+            while (i-- > 0)
+               BST_Delete(tree->indexes[i], dataPtr);
+            return false;
+        }
+    }
+    if (tree->trie && !BST_Trie_Insert(tree->trie, dataPtr))
+    {
+        for (i = 0; i < tree->num_indexes; ++i)
+            BST_Delete(tree->indexes[i], dataPtr);
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _index_delete
+ Description    : Deletes data from every secondary index and the string index of a tree.
+ Pre            : data is in the indexes
+ Post           : data removed from the indexes; the data itself is not freed
+ Remarks        :
+ Func ID        : 66
+*******************************************************************/
+void _index_delete (BST_TREE* tree, void* dataPtr)
+{
+    int i;
+
+    for (i = 0; i < tree->num_indexes; ++i)
+        BST_Delete(tree->indexes[i], dataPtr);
+    if (tree->trie)
+       BST_Trie_Delete(tree->trie, dataPtr);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _index_fill
+ Description    : Inserts every data of a tree in an empty index.
+ Pre            : index is empty and was created with BST_MODE_INDEX
+ Post           : Return true, or false on memory overflow; index is then left empty
+ Remarks        : O(n log n); the tree is walked in its own order with a cursor
+ Func ID        : 67
+*******************************************************************/
+bool _index_fill (BST_TREE* tree, BST_TREE* index)
+{
+    BST_CURSOR* cursor;
+    void* dataPtr;
+    bool success = true;
+
+    if (tree->count == 0)
+       return true;
+    cursor = BST_Cursor_Create(tree);
+    if (!cursor)
+       return false;
+    for (dataPtr = BST_Cursor_First(cursor); dataPtr && success; dataPtr = BST_Cursor_Next(cursor))
+        success = BST_Insert(index, dataPtr);
+    BST_Cursor_Destroy(cursor);
+    if (!success)
+    {
+        index->root = NULL;
+        index->count = 0;
+        _pool_destroy(&index->node_pool);
+    }
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : BST_Destroy
+ Description    : Deletes all data in tree and recycles memory.
+                  Nodes (and pooled data) are released a whole slab at a time.
+ Pre            : tree is a pointer to a valid tree
+ Post           : All data and head structure deleted. Return null head pointer
+ Remarks        : data not taken from BST_Alloc_Data is freed by _destroy in constant space.
+                  Secondary indexes are destroyed too; a BST_MODE_INDEX tree frees no data,
+                  and a BST_MODE_MAPPED tree just unmaps its file. A journal is committed
+                  and closed. No other thread may still use a BST_MODE_CONCURRENT or
+                  sharded tree.
+                  A BST_Create_Arena tree frees its arena's blocks; only its destroy, if
+                  any, visits the records
+ Func ID        : 13
+*******************************************************************/
+BST_TREE* BST_Destroy (BST_TREE* tree)
+{
+    int i;
+
+    if (tree)
+    {
+       BST_Journal_Close (tree);
+       for (i = 0; i < tree->num_indexes; ++i)
+          BST_Destroy (tree->indexes[i]);
+       if (tree->shards)
+       {
+          for (i = 0; i < tree->shards->num_shards; ++i)
+             BST_Destroy (tree->shards->trees[i]);
+          free (tree->shards);
+       }
+       if (tree->trie)
+       {
+          _trie_clear (tree->trie);
+          free (tree->trie);
+       }
+       if (tree->rcu)
+       {
+          if (BST_LOCK_FREE(tree))
+             _lf_destroy (tree);
+          _rcu_free (tree);
+          tree->mode &= ~BST_MODE_CONCURRENT;
+       }
+       _release_data (tree);
+       _pool_destroy (&tree->node_pool);
+       _pool_destroy (&tree->data_pool);
+       _hash_clear (&tree->hash);
+       BST_Frozen_Destroy (tree->frozen);
+       if (tree->arena)
+          _arena_free (tree->arena);
+       if (tree->dense)
+       {
+          free (tree->dense->bits);
+          free (tree->dense->slots);
+          free (tree->dense);
+       }
+    }
+     // All nodes deleted. Free structure
+     free (tree);
+     return NULL;
+}
+
+/*******************************************************************
+ Function Name  : _destroy
+ Description    : Deletes all heap allocated data in tree.
+                  Left subtrees are rotated up until the root has none, then the root data is freed.
+ Pre            : root is pointer to valid tree/subtree
+ Post           : All data deleted; nodes are left for the node pool to release
+ Remarks        : iterative in constant space
+ Func ID        : 14
+*******************************************************************/
+void _destroy (BST_TREE* tree, NODE* root)
+{
+    NODE* next;
+
+    while (root)
+    {
+        if (root->left)
+        {
+            // rotate right so that the left subtree is drained first
+            next = root->left;
+            root->left = next->right;
+            next->right = root;
+            if(trace_flag)
+                printf("\n TRACE[14.01]: root: %p, rotate to: %p", (void *)root, (void *)next);
+        }
+        else
+        {
+            next = root->right;
+            if(trace_flag)
+                printf("\n TRACE[14.02]: root: %p, delete: %p", (void *)root, root->dataPtr);
+            BST_Free_Data (tree, root->dataPtr);
+        }
+        root = next;
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Clear
+ Description    : Deletes all data in a tree and keeps the empty tree.
+ Pre            : tree has been created; not BST_MODE_MAPPED, BST_MODE_CONCURRENT or
+                  sharded, and not journaled
+ Post           : tree, its secondary indexes and trie empty. Return true, or false if
+                  the tree cannot be cleared
+ Remarks        : data is released as by BST_Destroy, so records from BST_Alloc_Data
+                  that are not in the tree are released too. A BST_Create_Arena tree
+                  rewinds its arena and keeps the blocks for the next records
+ Func ID        : 199
+*******************************************************************/
+bool BST_Clear (BST_TREE* tree)
+{
+    int i;
+
+    if ((tree->mode & (BST_MODE_MAPPED | BST_MODE_CONCURRENT)) || tree->journal || tree->shards)
+       return false;
+    for (i = 0; i < tree->num_indexes; ++i)
+        BST_Clear (tree->indexes[i]);
+    if (tree->trie)
+       _trie_clear (tree->trie);
+    _release_data (tree);
+    tree->root = NULL;
+    tree->bplus_root = NULL;
+    tree->count = 0;
+    _pool_destroy (&tree->node_pool);
+    _pool_destroy (&tree->data_pool);
+    _hash_clear (&tree->hash);
+    if (tree->arena)
+       _arena_reset (tree->arena);
+    if (tree->dense)
+       memset (tree->dense->bits, 0, (size_t)tree->dense->num_words * sizeof (unsigned int));
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _release_data
+ Description    : Releases every data a tree owns, ahead of dropping its nodes.
+ Pre            : tree is not BST_MODE_CONCURRENT
+ Post           : data not from BST_Alloc_Data freed, destroy of a BST_Create_Arena
+                  tree called on each record; pooled records are left for their slabs
+ Remarks        : pooled records with no destroy cost nothing here. Otherwise the nodes
+                  are rotated apart by _destroy, so the tree must be dropped after
+ Func ID        : 200
+*******************************************************************/
+void _release_data (BST_TREE* tree)
+{
+    BST_BPLUS_NODE* leaf;
+    int i;
+
+    if ((tree->mode & BST_MODE_INDEX) || (tree->data_pool.obj_size && !(tree->arena && tree->arena->destroy)))
+       return;
+    // BST_Free_Data calls destroy, and frees the record or recycles it into the pool
+    if (tree->dense)
+    {
+       for (i = _dense_next (tree->dense, 0); i >= 0; i = _dense_next (tree->dense, i + 1))
+           BST_Free_Data (tree, tree->dense->slots[i]);
+       return;
+    }
+    _destroy (tree, tree->root);
+    for (leaf = _bplus_edge (tree, true); leaf; leaf = leaf->next)
+    {
+        for (i = 0; i < leaf->num_keys; ++i)
+            BST_Free_Data (tree, leaf->ptrs[i]);
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _height
+ Description    : Returns height of a subtree.
+ Pre            : root is pointer to valid tree/subtree (may be null)
+ Post           : Return height of subtree; 0 for null subtree
+ Remarks        :
+ Func ID        : 24
+*******************************************************************/
+int _height (NODE* root)
+{
+    return (root ? root->height : 0);
+}
+
+/*******************************************************************
+ Function Name  : _size
+ Description    : Returns number of nodes in a subtree.
+ Pre            : root is pointer to valid tree/subtree (may be null)
+ Post           : Return subtree count; 0 for null subtree
+ Remarks        : only maintained in BST_MODE_ORDER_STAT
+ Func ID        : 58
+*******************************************************************/
+int _size (NODE* root)
+{
+    return (root ? root->size : 0);
+}
+
+/*******************************************************************
+ Function Name  : _update_node
+ Description    : recomputes height and subtree count of a node from its children.
+ Pre            : root is pointer to valid node, children heights and counts are valid
+ Post           : root->height and root->size updated
+ Remarks        :
+ Func ID        : 25
+*******************************************************************/
+void _update_node (NODE* root)
+{
+    int left_height = _height(root->left), right_height = _height(root->right);
+
+    root->height = 1 + (left_height > right_height ? left_height : right_height);
+    root->size = 1 + _size(root->left) + _size(root->right);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rotate_left
+ Description    : single left rotation of a subtree.
+ Pre            : root and root->right are valid nodes
+ Post           : root->right becomes subtree root. Return pointer to new subtree root
+ Remarks        :
+ Func ID        : 26
+*******************************************************************/
+NODE* _rotate_left (NODE* root)
+{
+    NODE* newRoot = root->right;
+
+    if(trace_flag)
+        printf("\n TRACE[26.01]: rotate left - root: %p, newRoot: %p", (void *)root, (void *)newRoot);
+    root->right = newRoot->left;
+    newRoot->left = root;
+    _update_node(root);
+    _update_node(newRoot);
+    return newRoot;
+}
+
+/*******************************************************************
+ Function Name  : _rotate_right
+ Description    : single right rotation of a subtree.
+ Pre            : root and root->left are valid nodes
+ Post           : root->left becomes subtree root. Return pointer to new subtree root
+ Remarks        :
+ Func ID        : 27
+*******************************************************************/
+NODE* _rotate_right (NODE* root)
+{
+    NODE* newRoot = root->left;
+
+    if(trace_flag)
+        printf("\n TRACE[27.01]: rotate right - root: %p, newRoot: %p", (void *)root, (void *)newRoot);
+    root->left = newRoot->right;
+    newRoot->right = root;
+    _update_node(root);
+    _update_node(newRoot);
+    return newRoot;
+}
+
+/*******************************************************************
+ Function Name  : _rebalance
+ Description    : updates height of a subtree root and restores AVL balance
+                  with single or double rotations.
+ Pre            : root is pointer to valid subtree (may be null) whose children are balanced
+ Post           : Return pointer to [potentially] new subtree root
+ Remarks        : only called in BST_MODE_AVL; heights are not maintained in BST_MODE_BASIC.
+                  In BST_MODE_CONCURRENT root is fresh, and the nodes a rotation moves are
+                  copied first
+ Func ID        : 28
+*******************************************************************/
+NODE* _rebalance (BST_TREE* tree, NODE* root)
+{
+    int balance;
+
+    if (!root)
+       return NULL;
+    _update_node(root);
+    balance = _height(root->left) - _height(root->right);
+    if (balance > 1)
+    {
+        // left heavy
+        if (tree->mode & BST_MODE_CONCURRENT)
+           root->left = _cow(tree, root->left);
+        if (_height(root->left->left) < _height(root->left->right))
+        {
+           if (tree->mode & BST_MODE_CONCURRENT)
+              root->left->right = _cow(tree, root->left->right);
+           root->left = _rotate_left(root->left);
+        }
+        return _rotate_right(root);
+    }
+    if (balance < -1)
+    {
+        // right heavy
+        if (tree->mode & BST_MODE_CONCURRENT)
+           root->right = _cow(tree, root->right);
+        if (_height(root->right->right) < _height(root->right->left))
+        {
+           if (tree->mode & BST_MODE_CONCURRENT)
+              root->right->left = _cow(tree, root->right->left);
+           root->right = _rotate_right(root->right);
+        }
+        return _rotate_left(root);
+    }
+    return root;
+}
+
+/*******************************************************************
+ Function Name  : _stack_init
+ Description    : initialises an empty traversal stack in its local storage.
+ Pre            : stack is pointer to a BST_STACK
+ Post           : stack is empty
+ Remarks        :
+ Func ID        : 29
+*******************************************************************/
+void _stack_init (BST_STACK* stack)
+{
+    stack->items = stack->local;
+    stack->top = 0;
+    stack->capacity = BST_MAX_HEIGHT;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _stack_push
+ Description    : pushes a node, doubling the stack on heap when local storage is full.
+ Pre            : stack has been initialised
+ Post           : node pushed. Return true or false if stack could not grow
+ Remarks        :
+ Func ID        : 30
+*******************************************************************/
+bool _stack_push (BST_STACK* stack, NODE* node)
+{
+    NODE** items;
+
+    if (stack->top == stack->capacity)
+    {
+        if (stack->items == stack->local)
+        {
+            items = (NODE**) malloc (2 * stack->capacity * sizeof (NODE*));
+            if (items)
+               memcpy (items, stack->local, stack->capacity * sizeof (NODE*));
+        }
+        else
+            items = (NODE**) realloc (stack->items, 2 * stack->capacity * sizeof (NODE*));
+        if (!items)
+           return false;
+        stack->items = items;
+        stack->capacity *= 2;
+    }
+    stack->items[stack->top++] = node;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _stack_pop
+ Description    : pops the top node of a traversal stack.
+ Pre            : stack is not empty
+ Post           : Return popped node
+ Remarks        :
+ Func ID        : 31
+*******************************************************************/
+NODE* _stack_pop (BST_STACK* stack)
+{
+    return stack->items[--stack->top];
+}
+
+/*******************************************************************
+ Function Name  : _stack_free
+ Description    : releases heap storage of a traversal stack, if any.
+ Pre            : stack has been initialised
+ Post           : stack is empty and back on local storage
+ Remarks        :
+ Func ID        : 32
+*******************************************************************/
+void _stack_free (BST_STACK* stack)
+{
+    if (stack->items != stack->local)
+       free (stack->items);
+    _stack_init(stack);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _pool_init
+ Description    : initialises an empty object pool.
+ Pre            : pool is pointer to a BST_POOL. obj_size is 0 for an unused pool
+ Post           : pool has no slabs and takes them from malloc
+ Remarks        : objects are rounded up to hold a free list link
+ Func ID        : 35
+*******************************************************************/
+void _pool_init (BST_POOL* pool, size_t obj_size)
+{
+    if (obj_size && obj_size < sizeof (void*))
+       obj_size = sizeof (void*);
+    pool->obj_size = (obj_size + sizeof (void*) - 1) & ~(sizeof (void*) - 1);
+    pool->slab_objs = BST_POOL_MIN_SLAB_OBJS;
+    pool->num_slabs = 0;
+    pool->capacity = 0;
+    pool->in_use = 0;
+    pool->free_list = NULL;
+    pool->bump = NULL;
+    pool->bump_end = NULL;
+    pool->slabs = NULL;
+    pool->arena = NULL;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _pool_grow
+ Description    : adds a slab to the pool; slabs double in size up to BST_POOL_MAX_SLAB_OBJS.
+ Pre            : pool has been initialised with a non zero object size
+ Post           : new slab becomes the bump region. Return true or false on overflow
+ Remarks        : only called once the previous slab is fully carved
+ Func ID        : 36
+*******************************************************************/
+bool _pool_grow (BST_POOL* pool)
+{
+    BST_SLAB* slab;
+
+    if (pool->arena)
+       slab = (BST_SLAB*) _arena_alloc (pool->arena, sizeof (BST_SLAB) + BST_POOL_ALIGN + pool->slab_objs * pool->obj_size);
+    else
+       slab = (BST_SLAB*) malloc (sizeof (BST_SLAB) + BST_POOL_ALIGN + pool->slab_objs * pool->obj_size);
+    if (!slab)
+       return false;
+    if(trace_flag)
+       printf("\n TRACE[36.01]: new slab: %p, objs: %d", (void *)slab, pool->slab_objs);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->bump = (char *)(((size_t)(slab + 1) + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+    pool->bump_end = pool->bump + pool->slab_objs * pool->obj_size;
+    pool->capacity += pool->slab_objs;
+    ++pool->num_slabs;
+    if (pool->slab_objs < BST_POOL_MAX_SLAB_OBJS)
+       pool->slab_objs *= 2;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _pool_alloc
+ Description    : takes an object from the free list, else from the newest slab.
+ Pre            : pool has been initialised with a non zero object size
+ Post           : Return pointer to object (not zeroed); null if overflow
+ Remarks        : malloc is called only when every slab is in use
+ Func ID        : 37
+*******************************************************************/
+void* _pool_alloc (BST_POOL* pool)
+{
+    void* objPtr;
+
+    if (pool->free_list)
+    {
+       objPtr = pool->free_list;
+       pool->free_list = *(void **)objPtr;
+    }
+    else
+    {
+       if (pool->bump == pool->bump_end && !_pool_grow(pool))
+          return NULL;
+       objPtr = pool->bump;
+       pool->bump += pool->obj_size;
+    }
+    ++pool->in_use;
+    return objPtr;
+}
+
+/*******************************************************************
+ Function Name  : _pool_free
+ Description    : returns an object to the pool's free list.
+ Pre            : objPtr came from _pool_alloc of this pool
+ Post           : object recycled
+ Remarks        :
+ Func ID        : 38
+*******************************************************************/
+void _pool_free (BST_POOL* pool, void* objPtr)
+{
+    *(void **)objPtr = pool->free_list;
+    pool->free_list = objPtr;
+    --pool->in_use;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _pool_destroy
+ Description    : releases every slab of a pool.
+ Pre            : pool has been initialised
+ Post           : all objects released; pool is empty. Runs in O(#slabs)
+ Remarks        : slabs from an arena stay in it until the arena is reset or freed
+ Func ID        : 39
+*******************************************************************/
+void _pool_destroy (BST_POOL* pool)
+{
+    BST_ARENA* arena = pool->arena;
+    BST_SLAB* slab;
+
+    while (pool->slabs)
+    {
+       slab = pool->slabs;
+       pool->slabs = slab->next;
+       if (!arena)
+          free (slab);
+    }
+    _pool_init(pool, pool->obj_size);
+    pool->arena = arena;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _arena_alloc
+ Description    : Carves a block of memory from an arena.
+ Pre            : arena came from BST_Create_Arena
+ Post           : Return cache line aligned memory of size bytes; null if overflow
+ Remarks        : after a reset the kept blocks are used again in turn, skipping any too
+                  small; a new block doubles the last new one, up to BST_ARENA_MAX_BLOCK
+ Func ID        : 201
+*******************************************************************/
+void* _arena_alloc (BST_ARENA* arena, size_t size)
+{
+    BST_ARENA_BLOCK* block;
+    char* objPtr;
+    size_t block_size;
+
+    while (arena->current && (size_t)(arena->bump_end - arena->bump) < size && arena->current->next)
+    {
+        arena->current = arena->current->next;
+        arena->bump = (char*)(((size_t)(arena->current + 1) + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+        arena->bump_end = (char*)(arena->current + 1) + arena->current->size;
+    }
+    if (!arena->current || (size_t)(arena->bump_end - arena->bump) < size)
+    {
+        for (block_size = arena->next_size; block_size < size + BST_POOL_ALIGN; block_size *= 2)
+            ;
+        block = (BST_ARENA_BLOCK*) malloc (sizeof (BST_ARENA_BLOCK) + block_size);
+        if (!block)
+           return NULL;
+        if(trace_flag)
+           printf("\n TRACE[201.01]: new block: %p, size: %zu", (void *)block, block_size);
+        block->next = NULL;
+        block->size = block_size;
+        if (arena->current)
+           arena->current->next = block;
+        else
+           arena->first = block;
+        arena->current = block;
+        arena->bump = (char*)(((size_t)(block + 1) + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+        arena->bump_end = (char*)(block + 1) + block_size;
+        if (arena->next_size < BST_ARENA_MAX_BLOCK)
+           arena->next_size *= 2;
+    }
+    objPtr = arena->bump;
+    arena->bump = (char*)(((size_t)(objPtr + size) + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+    if (arena->bump > arena->bump_end)
+       arena->bump = arena->bump_end;
+    return objPtr;
+}
+
+/*******************************************************************
+ Function Name  : _arena_reset
+ Description    : Rewinds an arena to its first block.
+ Pre            : nothing carved from the arena is in use
+ Post           : every block is free for reuse; none is released
+ Remarks        : O(1)
+ Func ID        : 202
+*******************************************************************/
+void _arena_reset (BST_ARENA* arena)
+{
+    arena->current = arena->first;
+    if (arena->current)
+    {
+       arena->bump = (char*)(((size_t)(arena->current + 1) + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+       arena->bump_end = (char*)(arena->current + 1) + arena->current->size;
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _arena_free
+ Description    : Releases an arena and all its blocks.
+ Pre            : arena came from BST_Create_Arena
+ Post           : arena freed
+ Remarks        : O(#blocks); blocks grow geometrically, so a few dozen hold millions
+                  of records
+ Func ID        : 203
+*******************************************************************/
+void _arena_free (BST_ARENA* arena)
+{
+    BST_ARENA_BLOCK* block;
+
+    while (arena->first)
+    {
+        block = arena->first;
+        arena->first = block->next;
+        free (block);
+    }
+    free (arena);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _root
+ Description    : Returns the root readers of a tree start from.
+ Pre            : tree has been created; in BST_MODE_CONCURRENT the caller holds a
+                  read lock or the writer lock
+ Post           : Return the published root in BST_MODE_CONCURRENT, else tree->root
+ Remarks        :
+ Func ID        : 150
+*******************************************************************/
+NODE* _root (BST_TREE* tree)
+{
+    if (tree->mode & BST_MODE_CONCURRENT)
+       return atomic_load (&tree->rcu->root);
+    return tree->root;
+}
+
+/*******************************************************************
+ Function Name  : _cow
+ Description    : Copies a published node before a writer changes it.
+ Pre            : caller holds the writer lock of a BST_MODE_CONCURRENT tree, with
+                  the copies reserved by _rcu_write_begin
+ Post           : Return the node itself if fresh, else a fresh copy; the original is retired
+ Remarks        : readers may be on the original, so it is freed only after a grace period
+ Func ID        : 151
+*******************************************************************/
+NODE* _cow (BST_TREE* tree, NODE* node)
+{
+    BST_RCU* rcu = tree->rcu;
+    NODE* copy;
+
+    if (node->fresh)
+       return node;
+    copy = (NODE*) _pool_alloc (&tree->node_pool);
+    *copy = *node;
+    copy->fresh = 1;
+    rcu->fresh[rcu->num_fresh++] = copy;
+    _rcu_retire (tree, node, true);
+    if(trace_flag)
+       printf("\n TRACE[151.01]: node: %p, copy: %p", (void *)node, (void *)copy);
+    return copy;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_retire
+ Description    : Holds an unlinked node or a deleted record until no reader can see it.
+ Pre            : caller holds the writer lock of a BST_MODE_CONCURRENT tree
+ Post           : objPtr is freed by the next _rcu_reclaim
+ Remarks        : the lists have room for one change past BST_RCU_BATCH
+ Func ID        : 152
+*******************************************************************/
+void _rcu_retire (BST_TREE* tree, void* objPtr, bool node)
+{
+    BST_RCU* rcu = tree->rcu;
+
+    if (node)
+       rcu->retired_nodes[rcu->num_retired_nodes++] = (NODE*) objPtr;
+    else
+       rcu->retired_data[rcu->num_retired_data++] = objPtr;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_write_begin
+ Description    : Takes the writer lock of a BST_MODE_CONCURRENT tree.
+ Pre            : copies is the most nodes the change may take from the node pool
+ Post           : Return true with the lock held, or false on memory overflow with the
+                  lock released
+ Remarks        : the nodes are reserved up front, so a change never stops half way with
+                  a path copied but not published. When the pool grows, the rest of the
+                  current slab goes on the free list, as the new slab takes over the bump.
+ Func ID        : 153
+*******************************************************************/
+bool _rcu_write_begin (BST_TREE* tree, int copies)
+{
+    BST_POOL* pool = &tree->node_pool;
+    void* objPtr;
+
+    mtx_lock (&tree->rcu->write_lock);
+    while (pool->capacity - pool->in_use < copies)
+    {
+        while (pool->bump != pool->bump_end)
+        {
+            objPtr = pool->bump;
+            pool->bump += pool->obj_size;
+            ++pool->in_use;
+            _pool_free (pool, objPtr);
+        }
+        if (!_pool_grow (pool))
+        {
+            mtx_unlock (&tree->rcu->write_lock);
+            system_status = ERR_BST_FULL;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_write_end
+ Description    : Publishes a writer's change and releases the writer lock.
+ Pre            : caller holds the writer lock from _rcu_write_begin
+ Post           : readers starting from now see tree->root and tree->count
+ Remarks        : the fresh copies become shared once published. Retired objects are
+                  reclaimed a batch at a time, so one grace period serves BST_RCU_BATCH changes
+ Func ID        : 154
+*******************************************************************/
+void _rcu_write_end (BST_TREE* tree)
+{
+    BST_RCU* rcu = tree->rcu;
+    int i;
+
+    for (i = 0; i < rcu->num_fresh; ++i)
+        rcu->fresh[i]->fresh = 0;
+    rcu->num_fresh = 0;
+    atomic_store (&rcu->count, tree->count);
+    atomic_store (&rcu->root, tree->root);
+    if (rcu->num_retired_nodes >= BST_RCU_BATCH || rcu->num_retired_data >= BST_RCU_BATCH)
+       _rcu_reclaim (tree);
+    mtx_unlock (&rcu->write_lock);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_synchronize
+ Description    : Waits for a grace period: every read lock held when it is called is released.
+ Pre            : caller holds the writer lock, and no read lock of its own on this tree
+ Post           : no reader can still see an object retired before the call
+ Remarks        : readers count in the slot of the phase they started in. The phase is
+                  flipped and the old phase drained twice, so a reader that read the
+                  phase just before a flip is still waited for. New readers go to the
+                  new phase and cannot hold the wait up.
+ Func ID        : 155
+*******************************************************************/
+void _rcu_synchronize (BST_RCU* rcu)
+{
+    unsigned int phase;
+    int pass, i;
+
+    for (pass = 0; pass < 2; ++pass)
+    {
+        phase = atomic_fetch_add (&rcu->phase, 1) & 1;
+        for (i = 0; i < BST_RCU_SLOTS; ++i)
+        {
+            while (atomic_load (&rcu->slots[i].active[phase]) != 0)
+                thrd_yield ();
+        }
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_reclaim
+ Description    : Frees the retired nodes and records of a BST_MODE_CONCURRENT tree.
+ Pre            : caller holds the writer lock, or no other thread uses the tree
+ Post           : retired lists empty
+ Remarks        : one grace period covers the whole batch
+ Func ID        : 156
+*******************************************************************/
+void _rcu_reclaim (BST_TREE* tree)
+{
+    BST_RCU* rcu = tree->rcu;
+    int i;
+
+    if (rcu->num_retired_nodes == 0 && rcu->num_retired_data == 0)
+       return;
+    _rcu_synchronize (rcu);
+    if(trace_flag)
+       printf("\n TRACE[156.01]: nodes: %d, data: %d", rcu->num_retired_nodes, rcu->num_retired_data);
+    for (i = 0; i < rcu->num_retired_nodes; ++i)
+        _pool_free (&tree->node_pool, rcu->retired_nodes[i]);
+    for (i = 0; i < rcu->num_retired_data; ++i)
+        BST_Free_Data (tree, rcu->retired_data[i]);
+    rcu->num_retired_nodes = 0;
+    rcu->num_retired_data = 0;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_init
+ Description    : Sets up the concurrent state of a BST_MODE_CONCURRENT tree.
+ Pre            : tree was just created with BST_MODE_CONCURRENT
+ Post           : Return true, or false on memory overflow with tree->rcu left null
+ Remarks        : the lock-free engine also gets its sentinel nodes
+ Func ID        : 161
+*******************************************************************/
+bool _rcu_init (BST_TREE* tree)
+{
+    BST_RCU* rcu;
+    int i;
+
+    // the slots are cache line aligned, so the size is a multiple of the alignment
+    rcu = (BST_RCU*) BST_ALIGNED_ALLOC (BST_POOL_ALIGN, sizeof (BST_RCU));
+    if (!rcu)
+       return false;
+    memset (rcu, 0, sizeof (BST_RCU));
+    atomic_init (&rcu->root, NULL);
+    atomic_init (&rcu->count, 0);
+    atomic_init (&rcu->phase, 0);
+    atomic_flag_clear (&rcu->reclaim_lock);
+    for (i = 0; i < BST_RCU_SLOTS; ++i)
+    {
+        atomic_flag_clear (&rcu->slots[i].lock);
+        _pool_init (&rcu->slots[i].node_pool, sizeof (BST_LF_NODE));
+    }
+    if (mtx_init (&rcu->write_lock, mtx_plain) != thrd_success)
+    {
+        BST_ALIGNED_FREE (rcu);
+        return false;
+    }
+    if (mtx_init (&rcu->data_lock, mtx_plain) != thrd_success)
+    {
+        mtx_destroy (&rcu->write_lock);
+        BST_ALIGNED_FREE (rcu);
+        return false;
+    }
+    tree->rcu = rcu;
+    if (BST_LOCK_FREE(tree) && !_lf_init (tree))
+    {
+        _rcu_free (tree);
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_free
+ Description    : Releases the concurrent state of a tree.
+ Pre            : no other thread uses the tree; the lock-free engine's records have
+                  been freed by _lf_destroy
+ Post           : retired objects and the slot pools freed; tree->rcu is null
+ Remarks        :
+ Func ID        : 162
+*******************************************************************/
+void _rcu_free (BST_TREE* tree)
+{
+    BST_RCU* rcu = tree->rcu;
+    int i;
+
+    _rcu_reclaim (tree);
+    for (i = 0; i < BST_RCU_SLOTS; ++i)
+        _pool_destroy (&rcu->slots[i].node_pool);
+    mtx_destroy (&rcu->write_lock);
+    mtx_destroy (&rcu->data_lock);
+    BST_ALIGNED_FREE (rcu);
+    tree->rcu = NULL;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_slot
+ Description    : Returns the calling thread's slot of a concurrent tree.
+ Pre            : rcu is the concurrent state of a tree
+ Post           : Return slot; a thread's first call picks its slot for every tree
+ Remarks        : threads take slots in turn, so up to BST_RCU_SLOTS threads share none
+ Func ID        : 163
+*******************************************************************/
+BST_RCU_SLOT* _rcu_slot (BST_RCU* rcu)
+{
+    if (bst_rcu_slot < 0)
+       bst_rcu_slot = (int)(atomic_fetch_add (&bst_rcu_threads, 1) % BST_RCU_SLOTS);
+    return &rcu->slots[bst_rcu_slot];
+}
+
+/*******************************************************************
+ Function Name  : _rcu_slot_lock
+ Description    : Locks a slot's node pool and retired list.
+ Pre            : slot came from _rcu_slot
+ Post           : slot locked
+ Remarks        : a spin lock: only threads sharing the slot contend, and they hold it
+                  for a pool or list update
+ Func ID        : 164
+*******************************************************************/
+void _rcu_slot_lock (BST_RCU_SLOT* slot)
+{
+    while (atomic_flag_test_and_set_explicit (&slot->lock, memory_order_acquire))
+        thrd_yield ();
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _rcu_slot_unlock
+ Description    : Unlocks a slot locked by _rcu_slot_lock.
+ Pre            : the calling thread holds the slot lock
+ Post           : slot unlocked
+ Remarks        :
+ Func ID        : 165
+*******************************************************************/
+void _rcu_slot_unlock (BST_RCU_SLOT* slot)
+{
+    atomic_flag_clear_explicit (&slot->lock, memory_order_release);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_init
+ Description    : Builds the empty lock-free tree.
+ Pre            : tree->rcu is set up
+ Post           : Return true, or false on memory overflow
+ Remarks        : the root (inf 3) holds S (inf 2) and a leaf inf 3; S holds leaves inf 1
+                  and inf 2. Every int key lives under S's left link, so a delete always
+                  finds a parent and a grandparent.
+ Func ID        : 166
+*******************************************************************/
+bool _lf_init (BST_TREE* tree)
+{
+    BST_LF_NODE *root, *sentinel, *leaf1, *leaf2, *leaf3;
+
+    root = _lf_alloc (tree, 0, 3, NULL);
+    sentinel = _lf_alloc (tree, 0, 2, NULL);
+    leaf1 = _lf_alloc (tree, 0, 1, NULL);
+    leaf2 = _lf_alloc (tree, 0, 2, NULL);
+    leaf3 = _lf_alloc (tree, 0, 3, NULL);
+    if (!root || !sentinel || !leaf1 || !leaf2 || !leaf3)
+       return false;
+    atomic_store (&sentinel->left, (uintptr_t)leaf1);
+    atomic_store (&sentinel->right, (uintptr_t)leaf2);
+    atomic_store (&root->left, (uintptr_t)sentinel);
+    atomic_store (&root->right, (uintptr_t)leaf3);
+    tree->lf_root = root;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _lf_alloc
+ Description    : Takes a lock-free engine node from the calling thread's slot pool.
+ Pre            : tree is a lock-free tree
+ Post           : Return leaf node with no children; null on memory overflow
+ Remarks        :
+ Func ID        : 167
+*******************************************************************/
+BST_LF_NODE* _lf_alloc (BST_TREE* tree, int key, int inf, void* dataPtr)
+{
+    BST_RCU_SLOT* slot = _rcu_slot (tree->rcu);
+    BST_LF_NODE* node;
+
+    _rcu_slot_lock (slot);
+    node = (BST_LF_NODE*) _pool_alloc (&slot->node_pool);
+    _rcu_slot_unlock (slot);
+    if (node)
+    {
+        node->key = key;
+        node->inf = inf;
+        atomic_init (&node->left, 0);
+        atomic_init (&node->right, 0);
+        node->dataPtr = dataPtr;
+    }
+    return node;
+}
+
+/*******************************************************************
+ Function Name  : _lf_free
+ Description    : Returns a node no other thread has seen to the slot pool.
+ Pre            : node came from _lf_alloc and was never linked in (may be null)
+ Post           : node recycled
+ Remarks        : a node that was linked in goes through _lf_retire instead
+ Func ID        : 168
+*******************************************************************/
+void _lf_free (BST_TREE* tree, BST_LF_NODE* node)
+{
+    BST_RCU_SLOT* slot = _rcu_slot (tree->rcu);
+
+    if (!node)
+       return;
+    _rcu_slot_lock (slot);
+    _pool_free (&slot->node_pool, node);
+    _rcu_slot_unlock (slot);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_less
+ Description    : Tells if an int key goes left of a lock-free engine node.
+ Pre            : node is a node of a lock-free tree
+ Post           : Return true if key is below the node's key
+ Remarks        : every sentinel key is above every int key
+ Func ID        : 169
+*******************************************************************/
+bool _lf_less (int key, BST_LF_NODE* node)
+{
+    return node->inf || key < node->key;
+}
+
+/*******************************************************************
+ Function Name  : _lf_seek
+ Description    : Finds the leaf a key leads to in a lock-free tree, with the nodes a
+                  delete there would splice.
+ Pre            : caller holds a read lock of the tree
+ Post           : seek holds leaf, its parent, and the ancestor whose link to successor
+                  is the last untagged link on the path; leaf_link is the link to leaf
+ Remarks        : every node from successor down to parent is already being removed,
+                  so one splice at ancestor removes them all
+ Func ID        : 170
+*******************************************************************/
+void _lf_seek (BST_TREE* tree, int key, BST_LF_SEEK* seek)
+{
+    uintptr_t parentLink, link;
+
+    seek->ancestor = tree->lf_root;
+    seek->successor = BST_LF_ADDR(atomic_load (&tree->lf_root->left));
+    seek->parent = seek->successor;
+    parentLink = atomic_load (&seek->parent->left);
+    seek->leaf = BST_LF_ADDR(parentLink);
+    link = atomic_load (_lf_less (key, seek->leaf) ? &seek->leaf->left : &seek->leaf->right);
+    while (BST_LF_ADDR(link))
+    {
+        if (!(parentLink & BST_LF_TAG))
+        {
+            seek->ancestor = seek->parent;
+            seek->successor = seek->leaf;
+        }
+        seek->parent = seek->leaf;
+        seek->leaf = BST_LF_ADDR(link);
+        parentLink = link;
+        link = atomic_load (_lf_less (key, seek->leaf) ? &seek->leaf->left : &seek->leaf->right);
+    }
+    seek->leaf_link = parentLink;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_insert
+ Description    : Inserts data in a lock-free tree.
+ Pre            : caller holds a read lock of the tree
+ Post           : Return true, or false if the key is in the tree or on memory overflow
+ Remarks        : the leaf the key leads to is replaced, in one compare and swap of its
+                  link, by a new internal node over it and the new leaf. A link that is
+                  flagged or tagged belongs to a delete in progress, which is helped to
+                  finish before the insert retries.
+ Func ID        : 171
+*******************************************************************/
+bool _lf_insert (BST_TREE* tree, void* dataPtr)
+{
+    BST_LF_SEEK seek;
+    BST_LF_NODE *leaf, *newLeaf, *newInternal;
+    _Atomic(uintptr_t)* childLink;
+    uintptr_t expected;
+    int key = tree->getKey(dataPtr);
+
+    newLeaf = _lf_alloc (tree, key, 0, dataPtr);
+    newInternal = _lf_alloc (tree, 0, 0, NULL);
+    if (!newLeaf || !newInternal)
+    {
+        _lf_free (tree, newLeaf);
+        _lf_free (tree, newInternal);
+        return false;
+    }
+    while (true)
+    {
+        _lf_seek (tree, key, &seek);
+        leaf = seek.leaf;
+        childLink = _lf_less (key, seek.parent) ? &seek.parent->left : &seek.parent->right;
+        if (!leaf->inf && leaf->key == key && !(seek.leaf_link & BST_LF_FLAG))
+        {
+            _lf_free (tree, newLeaf);
+            _lf_free (tree, newInternal);
+            return false;
+        }
+        // the internal node routes keys below the larger key to the smaller leaf
+        if (_lf_less (key, leaf))
+        {
+            newInternal->key = leaf->key;
+            newInternal->inf = leaf->inf;
+            atomic_store_explicit (&newInternal->left, (uintptr_t)newLeaf, memory_order_relaxed);
+            atomic_store_explicit (&newInternal->right, (uintptr_t)leaf, memory_order_relaxed);
+        }
+        else
+        {
+            newInternal->key = key;
+            newInternal->inf = 0;
+            atomic_store_explicit (&newInternal->left, (uintptr_t)leaf, memory_order_relaxed);
+            atomic_store_explicit (&newInternal->right, (uintptr_t)newLeaf, memory_order_relaxed);
+        }
+        expected = (uintptr_t)leaf;
+        if (atomic_compare_exchange_strong (childLink, &expected, (uintptr_t)newInternal))
+        {
+            atomic_fetch_add_explicit (&_rcu_slot (tree->rcu)->count, 1, memory_order_relaxed);
+            return true;
+        }
+        if (BST_LF_ADDR(expected) == leaf && (expected & (BST_LF_FLAG | BST_LF_TAG)))
+           _lf_cleanup (tree, key, &seek);
+    }
+}
+
+/*******************************************************************
+ Function Name  : _lf_delete
+ Description    : Deletes the data with a key from a lock-free tree.
+ Pre            : caller holds a read lock of the tree. dltKey is as for BST_Delete
+ Post           : Return true if this call deleted the data; false if the key was not found
+ Remarks        : the delete takes effect when it flags the link to the leaf; from there
+                  any thread that meets the flag may finish it. This call retries the
+                  splice until it or a helper has unlinked the leaf.
+ Func ID        : 172
+*******************************************************************/
+bool _lf_delete (BST_TREE* tree, void* dltKey)
+{
+    BST_LF_SEEK seek;
+    BST_LF_NODE* leaf = NULL;
+    _Atomic(uintptr_t)* childLink;
+    uintptr_t expected;
+    bool injecting = true;
+    int key = tree->getKey(dltKey);
+
+    while (true)
+    {
+        _lf_seek (tree, key, &seek);
+        childLink = _lf_less (key, seek.parent) ? &seek.parent->left : &seek.parent->right;
+        if (injecting)
+        {
+            leaf = seek.leaf;
+            if (leaf->inf || leaf->key != key)
+               return false;
+            expected = (uintptr_t)leaf;
+            if (atomic_compare_exchange_strong (childLink, &expected, (uintptr_t)leaf | BST_LF_FLAG))
+            {
+                injecting = false;
+                atomic_fetch_sub_explicit (&_rcu_slot (tree->rcu)->count, 1, memory_order_relaxed);
+                if (_lf_cleanup (tree, key, &seek))
+                   return true;
+            }
+            else if (BST_LF_ADDR(expected) == leaf && (expected & (BST_LF_FLAG | BST_LF_TAG)))
+            {
+                // another delete is on this leaf or its sibling: help it, then retry
+                _lf_cleanup (tree, key, &seek);
+            }
+        }
+        else if (seek.leaf != leaf || _lf_cleanup (tree, key, &seek))
+            return true;
+    }
+}
+
+/*******************************************************************
+ Function Name  : _lf_cleanup
+ Description    : Splices a flagged leaf and its parent out of a lock-free tree.
+ Pre            : seek was filled by _lf_seek for key; the parent holds a flagged link
+ Post           : Return true if this call did the splice
+ Remarks        : the parent's other link is tagged so it cannot change, then the
+                  ancestor's link to successor is swung to the node it holds. The
+                  thread whose swap succeeds retires the unlinked nodes.
+ Func ID        : 173
+*******************************************************************/
+bool _lf_cleanup (BST_TREE* tree, int key, BST_LF_SEEK* seek)
+{
+    _Atomic(uintptr_t)* successorLink;
+    _Atomic(uintptr_t)* childLink;
+    _Atomic(uintptr_t)* siblingLink;
+    uintptr_t sibling, expected;
+
+    successorLink = _lf_less (key, seek->ancestor) ? &seek->ancestor->left : &seek->ancestor->right;
+    if (_lf_less (key, seek->parent))
+    {
+        childLink = &seek->parent->left;
+        siblingLink = &seek->parent->right;
+    }
+    else
+    {
+        childLink = &seek->parent->right;
+        siblingLink = &seek->parent->left;
+    }
+    // the flagged link leads to the leaf going out; the other one stays
+    if (!(atomic_load (childLink) & BST_LF_FLAG))
+       siblingLink = childLink;
+    atomic_fetch_or (siblingLink, BST_LF_TAG);
+    sibling = atomic_load (siblingLink);
+    expected = (uintptr_t)seek->successor;
+    if (!atomic_compare_exchange_strong (successorLink, &expected, sibling & ~BST_LF_TAG))
+       return false;
+    _lf_unlink (tree, key, seek->successor, seek->parent, BST_LF_ADDR(sibling));
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _lf_unlink
+ Description    : Retires the nodes a splice took out of a lock-free tree.
+ Pre            : the ancestor's link to node was swung to kept, a child of parent
+ Post           : every internal node from node down to parent and each one's deleted
+                  leaf (with its data, unless BST_MODE_INDEX) are retired
+ Remarks        : these links are all flagged or tagged, so none of them changes any more.
+                  Above parent the deleted leaf is the child off the key's path.
+ Func ID        : 174
+*******************************************************************/
+void _lf_unlink (BST_TREE* tree, int key, BST_LF_NODE* node, BST_LF_NODE* parent, BST_LF_NODE* kept)
+{
+    BST_LF_NODE *left, *right, *leaf;
+
+    while (true)
+    {
+        left = BST_LF_ADDR(atomic_load (&node->left));
+        right = BST_LF_ADDR(atomic_load (&node->right));
+        if (node == parent)
+           leaf = (left == kept) ? right : left;
+        else
+           leaf = _lf_less (key, node) ? right : left;
+        _lf_retire (tree, leaf, !(tree->mode & BST_MODE_INDEX));
+        _lf_retire (tree, node, false);
+        if (node == parent)
+           break;
+        node = _lf_less (key, node) ? left : right;
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_retire
+ Description    : Holds an unlinked node, and maybe its record, until no reader can see it.
+ Pre            : node was unlinked by this thread
+ Post           : node (and its record if with_data) is freed by a later _lf_reclaim
+ Remarks        : the node is chained into its slot's retired list through its own
+                  retired link, so retiring needs no memory and cannot fail
+ Func ID        : 175
+*******************************************************************/
+void _lf_retire (BST_TREE* tree, BST_LF_NODE* node, bool with_data)
+{
+    BST_RCU_SLOT* slot = _rcu_slot (tree->rcu);
+
+    _rcu_slot_lock (slot);
+    node->retired = (uintptr_t)slot->retired | (with_data ? BST_LF_RECORD : 0);
+    slot->retired = node;
+    ++slot->num_retired;
+    _rcu_slot_unlock (slot);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_reclaim
+ Description    : Frees the objects the calling thread's slot retired, once
+                  BST_RCU_BATCH of them are waiting.
+ Pre            : the calling thread holds no read lock of the tree
+ Post           : objects retired before the call are freed, unless another slot is in
+                  a grace period; they are then left for the next call
+ Remarks        : one grace period at a time per tree, so the phase flips stay paired;
+                  a thread that finds one running goes on instead of waiting. The list
+                  is taken whole before the grace period, so what is retired meanwhile
+                  waits for the next one
+ Func ID        : 176
+*******************************************************************/
+void _lf_reclaim (BST_TREE* tree)
+{
+    BST_RCU* rcu = tree->rcu;
+    BST_RCU_SLOT* slot = _rcu_slot (rcu);
+    BST_LF_NODE *node, *next;
+    int num;
+
+    _rcu_slot_lock (slot);
+    num = slot->num_retired;
+    _rcu_slot_unlock (slot);
+    if (num < BST_RCU_BATCH || atomic_flag_test_and_set (&rcu->reclaim_lock))
+       return;
+    _rcu_slot_lock (slot);
+    node = slot->retired;
+    num = slot->num_retired;
+    slot->retired = NULL;
+    slot->num_retired = 0;
+    _rcu_slot_unlock (slot);
+    _rcu_synchronize (rcu);
+    atomic_flag_clear (&rcu->reclaim_lock);
+    if(trace_flag)
+       printf("\n TRACE[176.01]: slot: %d, reclaimed: %d", bst_rcu_slot, num);
+    _rcu_slot_lock (slot);
+    for (; node; node = next)
+    {
+        next = (BST_LF_NODE*)(node->retired & ~BST_LF_RECORD);
+        if (node->retired & BST_LF_RECORD)
+           BST_Free_Data (tree, node->dataPtr);
+        _pool_free (&slot->node_pool, node);
+    }
+    _rcu_slot_unlock (slot);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _lf_retrieve
+ Description    : Searches a lock-free tree for a key.
+ Pre            : caller holds a read lock of the tree
+ Post           : Return data of the key; null if not found
+ Remarks        : a leaf reached by a flagged link is already deleted
+ Func ID        : 177
+*******************************************************************/
+void* _lf_retrieve (BST_TREE* tree, void* keyPtr)
+{
+    BST_LF_NODE* node = tree->lf_root;
+    uintptr_t link = 0, next;
+    int key = tree->getKey(keyPtr);
+
+    while ((next = atomic_load_explicit (_lf_less (key, node) ? &node->left : &node->right, memory_order_acquire)) != 0)
+    {
+        link = next;
+        node = BST_LF_ADDR(next);
+    }
+    if (node->inf || node->key != key || (link & BST_LF_FLAG))
+       return NULL;
+    return node->dataPtr;
+}
+
+/*******************************************************************
+ Function Name  : _lf_next
+ Description    : Finds the leaf of the smallest key above a key in a lock-free tree.
+ Pre            : caller holds a read lock of the tree. after is pointer to the key, or
+                  null for the smallest key
+ Post           : Return leaf; null if none
+ Remarks        : each call descends from the root, so a walk needs no stack and every
+                  key present for the whole walk is met once, in order. O(depth) a call,
+                  and again if a delete moved the subtree it looked in.
+ Func ID        : 178
+*******************************************************************/
+BST_LF_NODE* _lf_next (BST_TREE* tree, const int* after)
+{
+    BST_LF_NODE *node, *upper;
+    uintptr_t link, next;
+    int key = after ? *after : 0;
+
+    while (true)
+    {
+        // descend to where key is; upper is the last node the descent left to the left
+        node = tree->lf_root;
+        upper = NULL;
+        link = 0;
+        while (true)
+        {
+            if (!after || _lf_less (key, node))
+            {
+                next = atomic_load_explicit (&node->left, memory_order_acquire);
+                if (next)
+                   upper = node;
+            }
+            else
+                next = atomic_load_explicit (&node->right, memory_order_acquire);
+            if (!next)
+               break;
+            link = next;
+            node = BST_LF_ADDR(next);
+        }
+        if (after && (node->inf || node->key <= key))
+        {
+            // the leaf is at or below key: take the leftmost leaf right of upper
+            link = atomic_load_explicit (&upper->right, memory_order_acquire);
+            node = BST_LF_ADDR(link);
+            while ((next = atomic_load_explicit (&node->left, memory_order_acquire)) != 0)
+            {
+                link = next;
+                node = BST_LF_ADDR(next);
+            }
+            // upper was spliced out since, and its right subtree moved up to where
+            // smaller keys go: descend again
+            if (!node->inf && node->key <= key)
+               continue;
+        }
+        if (node->inf)
+           return NULL;
+        if (!(link & BST_LF_FLAG))
+           return node;
+        // deleted: look past it
+        key = node->key;
+        after = &key;
+    }
+}
+
+/*******************************************************************
+ Function Name  : _lf_destroy
+ Description    : Frees the records of a lock-free tree.
+ Pre            : no other thread uses the tree
+ Post           : live and retired records freed (not in BST_MODE_INDEX); the nodes are
+                  left for the slot pools to release
+ Remarks        : in constant space, rotating left links up as _destroy does
+ Func ID        : 179
+*******************************************************************/
+void _lf_destroy (BST_TREE* tree)
+{
+    BST_RCU* rcu = tree->rcu;
+    BST_LF_NODE *node, *left;
+    int i;
+
+    if (tree->mode & BST_MODE_INDEX)
+       return;
+    node = tree->lf_root;
+    while (node)
+    {
+        left = BST_LF_ADDR(atomic_load (&node->left));
+        if (left)
+        {
+            atomic_store (&node->left, atomic_load (&left->right));
+            atomic_store (&left->right, (uintptr_t)node);
+            node = left;
+        }
+        else
+        {
+            // leaves hold the records; internal and sentinel nodes hold none
+            if (node->dataPtr)
+               BST_Free_Data (tree, node->dataPtr);
+            node = BST_LF_ADDR(atomic_load (&node->right));
+        }
+    }
+    for (i = 0; i < BST_RCU_SLOTS; ++i)
+    {
+        for (node = rcu->slots[i].retired; node; node = (BST_LF_NODE*)(node->retired & ~BST_LF_RECORD))
+        {
+            if (node->retired & BST_LF_RECORD)
+               BST_Free_Data (tree, node->dataPtr);
+        }
+        rcu->slots[i].retired = NULL;
+        rcu->slots[i].num_retired = 0;
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Add_Trie_Index
+ Description    : Adds a string index (adaptive radix trie) over the data of a tree.
+ Pre            : tree has been created and has no string index yet. getStr returns the
+                  null terminated string of a data, which must not change while indexed
+ Post           : trie filled with the tree's data. Return trie, or null on memory overflow
+                  or if the tree is BST_MODE_CONCURRENT or sharded
+ Remarks        : like BST_Add_Index, the trie holds pointers to the tree's data and is
+                  kept in sync by the tree's insert and delete calls. Query it with
+                  BST_Trie_Prefix and BST_Trie_Match. BST_Destroy of tree destroys it.
+ Func ID        : 71
+*******************************************************************/
+BST_TRIE* BST_Add_Trie_Index (BST_TREE* tree, const char* (*getStr) (void* argu))
+{
+    BST_TRIE* trie;
+
+    if (tree->trie || !getStr || (tree->mode & BST_MODE_CONCURRENT) || tree->shards)
+       return NULL;
+    trie = (BST_TRIE*) calloc (1, sizeof (BST_TRIE));
+    if (!trie)
+       return NULL;
+    trie->getStr = getStr;
+    _pool_init(&trie->node_pools[BST_TRIE_KIND4], sizeof (BST_TRIE_NODE4));
+    _pool_init(&trie->node_pools[BST_TRIE_KIND16], sizeof (BST_TRIE_NODE16));
+    _pool_init(&trie->node_pools[BST_TRIE_KIND256], sizeof (BST_TRIE_NODE256));
+    _pool_init(&trie->value_pool, sizeof (BST_TRIE_VALUE));
+    if (!_trie_fill(tree, trie))
+    {
+        free (trie);
+        return NULL;
+    }
+    tree->trie = trie;
+    return trie;
+}
+
+/*******************************************************************
+ Function Name  : BST_Trie_Insert
+ Description    : Inserts data in a trie under its string.
+ Pre            : trie came from BST_Add_Trie_Index; data is not in the trie
+ Post           : Return true, or false on memory overflow with the data not inserted
+ Remarks        : O(len). A key leaving a compressed path splits that node at the first
+                  differing char; a full node grows to the next kind.
+ Func ID        : 72
+*******************************************************************/
+bool BST_Trie_Insert (BST_TRIE* trie, void* dataPtr)
+{
+    const unsigned char* key = (const unsigned char*)trie->getStr(dataPtr);
+    BST_TRIE_NODE** link = &trie->root;
+    BST_TRIE_NODE** slot;
+    BST_TRIE_NODE* node;
+    BST_TRIE_NODE* parent;
+    BST_TRIE_NODE* child = NULL;
+    BST_TRIE_VALUE* value;
+    int match;
+
+    value = (BST_TRIE_VALUE*)_pool_alloc(&trie->value_pool);
+    if (!value)
+       return false;
+    for (;;)
+    {
+        node = *link;
+        if (!node)
+        {
+            // empty trie
+            node = _trie_make_path(trie, link, key);
+            if (!node)
+            {
+               _trie_free_path(trie, *link);
+               *link = NULL;
+            }
+            break;
+        }
+        for (match = 0; match < node->prefix_len && key[match] == node->prefix[match]; ++match)
+            ;
+        if (match < node->prefix_len)
+        {
+            // key leaves the compressed path: split it at the first differing char
+            parent = _trie_alloc(trie, BST_TRIE_KIND4);
+            if (!parent)
+            {
+               node = NULL;
+               break;
+            }
+            memcpy(parent->prefix, node->prefix, match);
+            parent->prefix_len = match;
+            parent->num_children = 1;
+            ((BST_TRIE_NODE4*)parent)->keys[0] = node->prefix[match];
+            ((BST_TRIE_NODE4*)parent)->children[0] = node;
+            node->prefix_len -= match + 1;
+            memmove(node->prefix, node->prefix + match + 1, node->prefix_len);
+            *link = node = parent;
+        }
+        key += match;
+        if (!*key)
+           break;
+        slot = _trie_find_child(node, *key);
+        if (!slot)
+        {
+            // new branch: build the rest of the key, then hang it from node
+            node = _trie_make_path(trie, &child, key + 1);
+            if (node && !_trie_add_child(trie, link, *key, child))
+               node = NULL;
+            if (!node)
+               _trie_free_path(trie, child);
+            break;
+        }
+        link = slot;
+        ++key;
+    }
+    if (!node)
+    {
+        _pool_free(&trie->value_pool, value);
+        return false;
+    }
+    if(trace_flag)
+       printf("\n TRACE[72.01]: data: %p, node: %p", dataPtr, (void *)node);
+    value->dataPtr = dataPtr;
+    value->next = node->values;
+    node->values = value;
+    ++trie->count;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : BST_Trie_Delete
+ Description    : Deletes data from a trie.
+ Pre            : trie came from BST_Add_Trie_Index
+ Post           : Return true, or false if data was not in the trie. The data is not freed
+ Remarks        : O(len + data with the same string). Nodes left with no data and no
+                  children are dropped; a node left with one child is folded into it.
+ Func ID        : 73
+*******************************************************************/
+bool BST_Trie_Delete (BST_TRIE* trie, void* dataPtr)
+{
+    const unsigned char* key = (const unsigned char*)trie->getStr(dataPtr);
+    BST_TRIE_STEP local[BST_MAX_HEIGHT];
+    BST_TRIE_STEP* path = local;
+    BST_TRIE_NODE** link = &trie->root;
+    BST_TRIE_NODE* node;
+    BST_TRIE_VALUE** valueLink = NULL;
+    BST_TRIE_VALUE* value = NULL;
+    size_t len = strlen((const char*)key);
+    unsigned char edge = 0;
+    int depth = 0;
+
+    // every node below the root takes at least its edge char, so len + 1 steps suffice
+    if (len + 1 > BST_MAX_HEIGHT)
+    {
+        path = (BST_TRIE_STEP*) malloc ((len + 1) * sizeof (BST_TRIE_STEP));
+        if (!path)
+           return false;
+    }
+    while (link && (node = *link) != NULL)
+    {
+        path[depth].link = link;
+        path[depth++].edge = edge;
+        if (strncmp((const char*)key, (const char*)node->prefix, node->prefix_len) != 0)
+           break;
+        key += node->prefix_len;
+        if (!*key)
+        {
+            for (valueLink = &node->values; *valueLink && (*valueLink)->dataPtr != dataPtr; valueLink = &(*valueLink)->next)
+                ;
+            value = *valueLink;
+            break;
+        }
+        edge = *key++;
+        link = _trie_find_child(node, edge);
+    }
+    if (value)
+    {
+        *valueLink = value->next;
+        _pool_free(&trie->value_pool, value);
+        --trie->count;
+        // climb while nodes are left with no data and at most one child
+        while (depth > 0)
+        {
+            link = path[--depth].link;
+            node = *link;
+            if (node->values || node->num_children > 1)
+               break;
+            if (node->num_children == 1)
+            {
+                _trie_merge(trie, link);
+                break;
+            }
+            if (depth == 0)
+               *link = NULL;
+            else
+               _trie_remove_child(trie, path[depth - 1].link, path[depth].edge);
+            if(trace_flag)
+               printf("\n TRACE[73.01]: drop node: %p", (void *)node);
+            _pool_free(&trie->node_pools[node->kind], node);
+        }
+    }
+    if (path != local)
+       free (path);
+    return (value != NULL);
+}
+
+/*******************************************************************
+ Function Name  : BST_Trie_Prefix
+ Description    : Processes every data whose string starts with a prefix.
+ Pre            : trie came from BST_Add_Trie_Index. prefix is null terminated
+ Post           : data processed in string order. Return number of data processed
+ Remarks        : O(len + k) for k matches; an empty prefix walks the whole trie
+ Func ID        : 74
+*******************************************************************/
+int BST_Trie_Prefix (BST_TRIE* trie, const char* prefix, void (*process) (void* dataPtr))
+{
+    return _trie_walk(_trie_seek(trie, prefix, true), process);
+}
+
+/*******************************************************************
+ Function Name  : BST_Trie_Match
+ Description    : Processes every data whose string equals a string.
+ Pre            : trie came from BST_Add_Trie_Index. str is null terminated
+ Post           : matching data processed. Return number of data processed
+ Remarks        : O(len + k) for k matches
+ Func ID        : 75
+*******************************************************************/
+int BST_Trie_Match (BST_TRIE* trie, const char* str, void (*process) (void* dataPtr))
+{
+    BST_TRIE_NODE* node;
+    BST_TRIE_VALUE* value;
+    int count = 0;
+
+    node = _trie_seek(trie, str, false);
+    if (node)
+    {
+        for (value = node->values; value; value = value->next, ++count)
+            process(value->dataPtr);
+    }
+    return count;
+}
+
+/*******************************************************************
+ Function Name  : _trie_seek
+ Description    : Finds the trie node of a string or of a prefix.
+ Pre            : str is null terminated
+ Post           : Return node where str ends (prefix false) or top node of the subtree
+                  holding every string that starts with str (prefix true); null if none
+ Remarks        :
+ Func ID        : 76
+*******************************************************************/
+BST_TRIE_NODE* _trie_seek (BST_TRIE* trie, const char* str, bool prefix)
+{
+    const unsigned char* key = (const unsigned char*)str;
+    BST_TRIE_NODE** slot;
+    BST_TRIE_NODE* node = trie->root;
+    int match;
+
+    while (node)
+    {
+        for (match = 0; match < node->prefix_len && key[match] == node->prefix[match]; ++match)
+            ;
+        if (prefix && !key[match])
+           return node;
+        if (match < node->prefix_len)
+           return NULL;
+        key += match;
+        if (!*key)
+           return node;
+        slot = _trie_find_child(node, *key++);
+        node = (slot ? *slot : NULL);
+    }
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : _trie_walk
+ Description    : Processes every data of a trie subtree in string order.
+ Pre            : root is a trie node (may be null)
+ Post           : Return number of data processed
+ Remarks        : explicit stack; starts in local storage, grows on heap for wide subtrees.
+                  On memory overflow the walk stops early.
+ Func ID        : 77
+*******************************************************************/
+int _trie_walk (BST_TRIE_NODE* root, void (*process) (void* dataPtr))
+{
+    BST_TRIE_NODE* local[BST_MAX_HEIGHT];
+    BST_TRIE_NODE** stack = local;
+    BST_TRIE_NODE** grown;
+    BST_TRIE_NODE** children;
+    BST_TRIE_NODE* node;
+    BST_TRIE_VALUE* value;
+    unsigned char* keys;
+    int top = 0, capacity = BST_MAX_HEIGHT, count = 0, i;
+
+    if (root)
+       stack[top++] = root;
+    while (top > 0)
+    {
+        node = stack[--top];
+        for (value = node->values; value; value = value->next, ++count)
+            process(value->dataPtr);
+        if (top + node->num_children > capacity)
+        {
+            capacity = 2 * (top + node->num_children);
+            grown = (BST_TRIE_NODE**) malloc (capacity * sizeof (BST_TRIE_NODE*));
+            if (!grown)
+               break;
+            memcpy(grown, stack, top * sizeof (BST_TRIE_NODE*));
+            if (stack != local)
+               free (stack);
+            stack = grown;
+        }
+        // push the last edge first, so the smallest edge is walked next
+        children = _trie_children(node, &keys);
+        if (keys)
+        {
+            for (i = node->num_children - 1; i >= 0; --i)
+                stack[top++] = children[i];
+        }
+        else
+        {
+            for (i = 255; i >= 0; --i)
+            {
+                if (children[i])
+                   stack[top++] = children[i];
+            }
+        }
+    }
+    if (stack != local)
+       free (stack);
+    return count;
+}
+
+/*******************************************************************
+ Function Name  : _trie_alloc
+ Description    : Allocates an empty trie node of a kind.
+ Pre            : kind is BST_TRIE_KIND4, BST_TRIE_KIND16 or BST_TRIE_KIND256
+ Post           : Return zeroed node; null if overflow
+ Remarks        : each kind has its own node pool
+ Func ID        : 78
+*******************************************************************/
+BST_TRIE_NODE* _trie_alloc (BST_TRIE* trie, int kind)
+{
+    BST_TRIE_NODE* node;
+
+    node = (BST_TRIE_NODE*)_pool_alloc(&trie->node_pools[kind]);
+    if (node)
+    {
+        memset(node, 0, trie->node_pools[kind].obj_size);
+        node->kind = kind;
+    }
+    return node;
+}
+
+/*******************************************************************
+ Function Name  : _trie_children
+ Description    : Returns the child array of a trie node.
+ Pre            : node is a valid trie node
+ Post           : Return child array. keys is set to the sorted edge chars of a small
+                  node, or null for BST_TRIE_KIND256 whose children are indexed by edge
+ Remarks        :
+ Func ID        : 79
+*******************************************************************/
+BST_TRIE_NODE** _trie_children (BST_TRIE_NODE* node, unsigned char** keys)
+{
+    switch (node->kind)
+    {
+        case BST_TRIE_KIND4:
+            *keys = ((BST_TRIE_NODE4*)node)->keys;
+            return ((BST_TRIE_NODE4*)node)->children;
+        case BST_TRIE_KIND16:
+            *keys = ((BST_TRIE_NODE16*)node)->keys;
+            return ((BST_TRIE_NODE16*)node)->children;
+        default:
+            *keys = NULL;
+            return ((BST_TRIE_NODE256*)node)->children;
+    }
+}
+
+/*******************************************************************
+ Function Name  : _trie_find_child
+ Description    : Finds the child link of a trie node for an edge char.
+ Pre            : node is a valid trie node
+ Post           : Return link to the child; null if none
+ Remarks        : small nodes are scanned up to the first larger edge
+ Func ID        : 80
+*******************************************************************/
+BST_TRIE_NODE** _trie_find_child (BST_TRIE_NODE* node, unsigned char edge)
+{
+    BST_TRIE_NODE** children;
+    unsigned char* keys;
+    int i;
+
+    children = _trie_children(node, &keys);
+    if (!keys)
+       return (children[edge] ? &children[edge] : NULL);
+    for (i = 0; i < node->num_children && keys[i] <= edge; ++i)
+    {
+        if (keys[i] == edge)
+           return &children[i];
+    }
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : _trie_add_child
+ Description    : Adds a child to the trie node at link.
+ Pre            : the node has no child for edge; edge is not the null char
+ Post           : Return true, or false on memory overflow with the node unchanged
+ Remarks        : a full node is replaced (at link) by one of the next kind
+ Func ID        : 81
+*******************************************************************/
+bool _trie_add_child (BST_TRIE* trie, BST_TRIE_NODE** link, unsigned char edge, BST_TRIE_NODE* child)
+{
+    BST_TRIE_NODE* node = *link;
+    BST_TRIE_NODE** children;
+    unsigned char* keys;
+    int i;
+
+    if (node->kind != BST_TRIE_KIND256 && node->num_children == BST_TRIE_CAPACITY(node->kind))
+    {
+        if (!_trie_resize(trie, link, node->kind + 1))
+           return false;
+        node = *link;
+    }
+    children = _trie_children(node, &keys);
+    if (keys)
+    {
+        for (i = node->num_children; i > 0 && keys[i - 1] > edge; --i)
+        {
+            keys[i] = keys[i - 1];
+            children[i] = children[i - 1];
+        }
+        keys[i] = edge;
+        children[i] = child;
+    }
+    else
+        children[edge] = child;
+    ++node->num_children;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _trie_remove_child
+ Description    : Removes a child from the trie node at link.
+ Pre            : the node has a child for edge
+ Post           : child unlinked (not freed)
+ Remarks        : a sparse node is replaced (at link) by a smaller kind, with some slack
+                  so a node on the boundary does not change kind on every call
+ Func ID        : 82
+*******************************************************************/
+void _trie_remove_child (BST_TRIE* trie, BST_TRIE_NODE** link, unsigned char edge)
+{
+    BST_TRIE_NODE* node = *link;
+    BST_TRIE_NODE** children;
+    unsigned char* keys;
+    int i;
+
+    children = _trie_children(node, &keys);
+    if (keys)
+    {
+        for (i = 0; keys[i] != edge; ++i)
+            ;
+        for (--node->num_children; i < node->num_children; ++i)
+        {
+            keys[i] = keys[i + 1];
+            children[i] = children[i + 1];
+        }
+    }
+    else
+    {
+        children[edge] = NULL;
+        --node->num_children;
+    }
+    // a failed shrink just keeps the bigger node
+    if (node->kind == BST_TRIE_KIND256 && node->num_children <= 12)
+       _trie_resize(trie, link, BST_TRIE_KIND16);
+    else if (node->kind == BST_TRIE_KIND16 && node->num_children <= 3)
+       _trie_resize(trie, link, BST_TRIE_KIND4);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _trie_resize
+ Description    : Replaces the trie node at link by a copy of another kind.
+ Pre            : the node's children fit in kind
+ Post           : Return true, or false on memory overflow with the node unchanged
+ Remarks        :
+ Func ID        : 83
+*******************************************************************/
+bool _trie_resize (BST_TRIE* trie, BST_TRIE_NODE** link, int kind)
+{
+    BST_TRIE_NODE* node = *link;
+    BST_TRIE_NODE* newPtr;
+    BST_TRIE_NODE** children;
+    BST_TRIE_NODE** newChildren;
+    unsigned char* keys;
+    unsigned char* newKeys;
+    int i, j = 0;
+
+    newPtr = _trie_alloc(trie, kind);
+    if (!newPtr)
+       return false;
+    newPtr->num_children = node->num_children;
+    newPtr->prefix_len = node->prefix_len;
+    memcpy(newPtr->prefix, node->prefix, node->prefix_len);
+    newPtr->values = node->values;
+    children = _trie_children(node, &keys);
+    newChildren = _trie_children(newPtr, &newKeys);
+    if (keys && newKeys)
+    {
+        memcpy(newKeys, keys, node->num_children);
+        memcpy(newChildren, children, node->num_children * sizeof (BST_TRIE_NODE*));
+    }
+    else if (keys)
+    {
+        for (i = 0; i < node->num_children; ++i)
+            newChildren[keys[i]] = children[i];
+    }
+    else
+    {
+        for (i = 0; i < 256; ++i)
+        {
+            if (children[i])
+            {
+                newKeys[j] = (unsigned char)i;
+                newChildren[j++] = children[i];
+            }
+        }
+    }
+    if(trace_flag)
+       printf("\n TRACE[83.01]: node: %p, kind: %d -> %d", (void *)node, node->kind, kind);
+    *link = newPtr;
+    _pool_free(&trie->node_pools[node->kind], node);
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _trie_make_path
+ Description    : Builds the trie nodes for the rest of a key.
+ Pre            : link is empty; key is null terminated (may be empty)
+ Post           : Return node where key ends; null on memory overflow, with the nodes
+                  built so far left at link for _trie_free_path
+ Remarks        : keys longer than BST_TRIE_MAX_PREFIX take a chain of one child nodes
+ Func ID        : 84
+*******************************************************************/
+BST_TRIE_NODE* _trie_make_path (BST_TRIE* trie, BST_TRIE_NODE** link, const unsigned char* key)
+{
+    BST_TRIE_NODE* node;
+    size_t len;
+
+    for (;;)
+    {
+        node = _trie_alloc(trie, BST_TRIE_KIND4);
+        *link = node;
+        if (!node)
+           return NULL;
+        len = strlen((const char*)key);
+        if (len > BST_TRIE_MAX_PREFIX)
+           len = BST_TRIE_MAX_PREFIX;
+        memcpy(node->prefix, key, len);
+        node->prefix_len = len;
+        key += len;
+        if (!*key)
+           return node;
+        ((BST_TRIE_NODE4*)node)->keys[0] = *key++;
+        node->num_children = 1;
+        link = &((BST_TRIE_NODE4*)node)->children[0];
+    }
+}
+
+/*******************************************************************
+ Function Name  : _trie_free_path
+ Description    : Frees a chain of trie nodes left by a failed _trie_make_path.
+ Pre            : node heads a chain of nodes with at most one child and no data
+ Post           : chain freed
+ Remarks        :
+ Func ID        : 85
+*******************************************************************/
+void _trie_free_path (BST_TRIE* trie, BST_TRIE_NODE* node)
+{
+    BST_TRIE_NODE* next;
+
+    while (node)
+    {
+        next = (node->num_children ? ((BST_TRIE_NODE4*)node)->children[0] : NULL);
+        _pool_free(&trie->node_pools[node->kind], node);
+        node = next;
+    }
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _trie_merge
+ Description    : Folds the trie node at link into its only child.
+ Pre            : the node has no data and exactly one child
+ Post           : child (with the node's prefix and edge in front of its own) now at link.
+                  Left alone if the joined prefix would not fit BST_TRIE_MAX_PREFIX
+ Remarks        :
+ Func ID        : 86
+*******************************************************************/
+void _trie_merge (BST_TRIE* trie, BST_TRIE_NODE** link)
+{
+    BST_TRIE_NODE* node = *link;
+    BST_TRIE_NODE* child;
+    BST_TRIE_NODE** children;
+    unsigned char* keys;
+    unsigned char edge;
+    int i = 0;
+
+    children = _trie_children(node, &keys);
+    if (!keys)
+    {
+        while (!children[i])
+            ++i;
+    }
+    child = children[i];
+    edge = (keys ? keys[0] : (unsigned char)i);
+    if (node->prefix_len + 1 + child->prefix_len > BST_TRIE_MAX_PREFIX)
+       return;
+    memmove(child->prefix + node->prefix_len + 1, child->prefix, child->prefix_len);
+    memcpy(child->prefix, node->prefix, node->prefix_len);
+    child->prefix[node->prefix_len] = edge;
+    child->prefix_len += node->prefix_len + 1;
+    *link = child;
+    _pool_free(&trie->node_pools[node->kind], node);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _trie_clear
+ Description    : Empties a trie.
+ Pre            : trie came from BST_Add_Trie_Index
+ Post           : all nodes released a whole slab at a time; data is not freed
+ Remarks        :
+ Func ID        : 87
+*******************************************************************/
+void _trie_clear (BST_TRIE* trie)
+{
+    int kind;
+
+    for (kind = 0; kind < BST_TRIE_NUM_KINDS; ++kind)
+        _pool_destroy(&trie->node_pools[kind]);
+    _pool_destroy(&trie->value_pool);
+    trie->root = NULL;
+    trie->count = 0;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _trie_fill
+ Description    : Inserts every data of a tree in an empty trie.
+ Pre            : trie is empty
+ Post           : Return true, or false on memory overflow; trie is then left empty
+ Remarks        :
+ Func ID        : 88
+*******************************************************************/
+bool _trie_fill (BST_TREE* tree, BST_TRIE* trie)
+{
+    BST_CURSOR* cursor;
+    void* dataPtr;
+    bool success = true;
+
+    if (tree->count == 0)
+       return true;
+    cursor = BST_Cursor_Create(tree);
+    if (!cursor)
+       return false;
+    for (dataPtr = BST_Cursor_First(cursor); dataPtr && success; dataPtr = BST_Cursor_Next(cursor))
+        success = BST_Trie_Insert(trie, dataPtr);
+    BST_Cursor_Destroy(cursor);
+    if (!success)
+       _trie_clear(trie);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _hash_slot
+ Description    : Home slot of a key in the hash side index.
+ Pre            : hash has slots
+ Post           : Return slot index
+ Remarks        : Fibonacci hashing: the top bits of key * 2^32 / golden ratio, so
+                  runs of consecutive ids spread over the whole table
+ Func ID        : 92
+*******************************************************************/
+static inline uint32_t _hash_slot (BST_HASH* hash, int key)
+{
+    return ((uint32_t)key * 2654435769u) >> hash->shift;
+}
+
+/*******************************************************************
+ Function Name  : _hash_find
+ Description    : Looks up a key in the hash side index.
+ Pre            : hash has been initialised
+ Post           : Return data with key; null if none
+ Remarks        : O(1) expected; probes linearly up to the first free slot
+ Func ID        : 93
+*******************************************************************/
+void* _hash_find (BST_HASH* hash, int key)
+{
+    uint32_t i;
+
+    if (!hash->slots)
+       return NULL;
+    for (i = _hash_slot(hash, key); hash->slots[i].dataPtr; i = (i + 1) & hash->mask)
+    {
+        if (hash->slots[i].key == key)
+           return hash->slots[i].dataPtr;
+    }
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : _hash_reserve
+ Description    : Makes room in the hash side index for a number of keys.
+ Pre            : hash has been initialised
+ Post           : Return true, or false on memory overflow with the table unchanged
+ Remarks        : the table doubles (and is rehashed) once count would pass
+                  BST_HASH_MAX_LOAD_PCT of its slots, so probe runs stay short
+ Func ID        : 94
+*******************************************************************/
+bool _hash_reserve (BST_HASH* hash, int count)
+{
+    BST_HASH_SLOT* oldSlots = hash->slots;
+    uint32_t oldCapacity = (oldSlots ? hash->mask + 1 : 0);
+    uint32_t capacity = (oldCapacity ? oldCapacity : BST_HASH_MIN_SLOTS);
+    uint32_t i;
+    int shift = 32;
+
+    if ((uint64_t)count * 100 <= (uint64_t)oldCapacity * BST_HASH_MAX_LOAD_PCT)
+       return true;
+    while ((uint64_t)count * 100 > (uint64_t)capacity * BST_HASH_MAX_LOAD_PCT)
+        capacity <<= 1;
+    hash->slots = (BST_HASH_SLOT*) calloc (capacity, sizeof (BST_HASH_SLOT));
+    if (!hash->slots)
+    {
+        hash->slots = oldSlots;
+        return false;
+    }
+    for (i = capacity; i > 1; i >>= 1)
+        --shift;
+    hash->shift = shift;
+    hash->mask = capacity - 1;
+    hash->count = 0;
+    if(trace_flag)
+       printf("\n TRACE[94.01]: hash slots: %u -> %u", oldCapacity, capacity);
+    for (i = 0; i < oldCapacity; ++i)
+    {
+        if (oldSlots[i].dataPtr)
+           _hash_put(hash, oldSlots[i].key, oldSlots[i].dataPtr);
+    }
+    free (oldSlots);
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _hash_put
+ Description    : Adds a key to the hash side index.
+ Pre            : key is not in the table and _hash_reserve made room for it
+ Post           : key and data stored
+ Remarks        :
+ Func ID        : 95
+*******************************************************************/
+void _hash_put (BST_HASH* hash, int key, void* dataPtr)
+{
+    uint32_t i;
+
+    for (i = _hash_slot(hash, key); hash->slots[i].dataPtr; i = (i + 1) & hash->mask)
+        ;
+    hash->slots[i].key = key;
+    hash->slots[i].dataPtr = dataPtr;
+    ++hash->count;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _hash_remove
+ Description    : Removes a key from the hash side index.
+ Pre            : hash has been initialised
+ Post           : key removed if present
+ Remarks        : backward shift deletion: later entries of the probe run move up into
+                  the hole unless their home slot lies after it, so no tombstones are left
+ Func ID        : 96
+*******************************************************************/
+void _hash_remove (BST_HASH* hash, int key)
+{
+    uint32_t i, j, home;
+
+    if (!hash->slots)
+       return;
+    for (i = _hash_slot(hash, key); hash->slots[i].dataPtr && hash->slots[i].key != key; i = (i + 1) & hash->mask)
+        ;
+    if (!hash->slots[i].dataPtr)
+       return;
+    for (j = (i + 1) & hash->mask; hash->slots[j].dataPtr; j = (j + 1) & hash->mask)
+    {
+        // the entry at j may fill the hole at i unless its home is cyclically in (i, j]
+        home = _hash_slot(hash, hash->slots[j].key);
+        if (((j - home) & hash->mask) >= ((j - i) & hash->mask))
+        {
+            hash->slots[i] = hash->slots[j];
+            i = j;
+        }
+    }
+    hash->slots[i].dataPtr = NULL;
+    --hash->count;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _hash_clear
+ Description    : Releases the hash side index.
+ Pre            : hash has been initialised
+ Post           : table freed; hash is empty
+ Remarks        :
+ Func ID        : 97
+*******************************************************************/
+void _hash_clear (BST_HASH* hash)
+{
+    free (hash->slots);
+    hash->slots = NULL;
+    hash->count = 0;
+    hash->mask = 0;
+    hash->shift = 32;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Freeze
+ Description    : Makes a read only snapshot of a tree in Eytzinger layout.
+ Pre            : tree has been created with BST_MODE_INLINE_KEY
+ Post           : Return snapshot holding every key and data of the tree; null if the tree
+                  has no inline keys or on memory overflow
+ Remarks        : keys are laid out in BFS order of a complete tree (root at 1, children
+                  of k at 2k and 2k+1) in one cache line aligned array, with the data
+                  pointers in a parallel array. The snapshot shares the tree's data: it is
+                  stale once the tree changes and invalid once a data is freed.
+                  BST_MODE_CONCURRENT holds the writer lock, so writers wait for the walk;
+                  a lock-free or sharded tree is not frozen
+ Func ID        : 98
+*******************************************************************/
+BST_FROZEN* BST_Freeze (BST_TREE* tree)
+{
+    BST_FROZEN* frozen;
+
+    if (tree->shards)
+       return NULL;
+    if (!(tree->mode & BST_MODE_CONCURRENT))
+       return _freeze (tree);
+    if (BST_LOCK_FREE(tree) || !_rcu_write_begin (tree, 0))
+       return NULL;
+    frozen = _freeze (tree);
+    _rcu_write_end (tree);
+    return frozen;
+}
+
+/*******************************************************************
+ Function Name  : _freeze
+ Description    : Makes the snapshot for BST_Freeze.
+ Pre            : in BST_MODE_CONCURRENT, caller holds the writer lock
+ Post           : as BST_Freeze
+ Remarks        :
+ Func ID        : 158
+*******************************************************************/
+BST_FROZEN* _freeze (BST_TREE* tree)
+{
+    BST_FROZEN* frozen;
+    BST_CURSOR* cursor;
+    void* dataPtr;
+    size_t size;
+    int k;
+
+    if (!(tree->mode & BST_MODE_INLINE_KEY))
+       return NULL;
+    frozen = (BST_FROZEN*) calloc (1, sizeof (BST_FROZEN));
+    if (!frozen)
+       return NULL;
+    frozen->count = tree->count;
+    frozen->getKey = tree->getKey;
+    // slot 0 is unused so index arithmetic stays 1 based; round up for BST_ALIGNED_ALLOC
+    size = ((size_t)tree->count + 1) * sizeof (int);
+    size = (size + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1);
+    frozen->keys = (int*) BST_ALIGNED_ALLOC (BST_POOL_ALIGN, size);
+    frozen->data = (void**) malloc (((size_t)tree->count + 1) * sizeof (void*));
+    cursor = BST_Cursor_Create (tree);
+    if (!frozen->keys || !frozen->data || !cursor)
+    {
+        BST_Cursor_Destroy (cursor);
+        return BST_Frozen_Destroy (frozen);
+    }
+    // an in order walk of the tree fills the implicit tree in order
+    k = BST_Frozen_First (frozen);
+    for (dataPtr = BST_Cursor_First (cursor); dataPtr; dataPtr = BST_Cursor_Next (cursor))
+    {
+        frozen->keys[k] = tree->getKey (dataPtr);
+        frozen->data[k] = dataPtr;
+        k = BST_Frozen_Next (frozen, k);
+    }
+    BST_Cursor_Destroy (cursor);
+    if(trace_flag)
+       printf("\n TRACE[98.01]: frozen: %p, count: %d", (void *)frozen, frozen->count);
+    return frozen;
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Destroy
+ Description    : Releases a snapshot.
+ Pre            : frozen came from BST_Freeze or BST_Open (may be null)
+ Post           : snapshot released; data is not freed. Return null snapshot pointer
+ Remarks        :
+ Func ID        : 99
+*******************************************************************/
+BST_FROZEN* BST_Frozen_Destroy (BST_FROZEN* frozen)
+{
+    if (frozen && frozen->map)
+       _file_unmap (frozen->map, frozen->map_size);
+    else if (frozen)
+    {
+       BST_ALIGNED_FREE (frozen->keys);
+       free (frozen->data);
+    }
+    free (frozen);
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : _frozen_lower_bound
+ Description    : Finds the first key not below a key in a snapshot.
+ Pre            : frozen came from BST_Freeze
+ Post           : Return position of the first key >= key; 0 if none
+ Remarks        : branch free descent: each level adds the compare result to the child
+                  index, and the loop runs a fixed log2(n) times. A cache line holds
+                  BST_FROZEN_PREFETCH keys, so prefetching keys[BST_FROZEN_PREFETCH * k]
+                  brings in every descendant of k four levels down. The answer is the
+                  last node where the descent went left: shift off the trailing right
+                  turns and that left turn.
+ Func ID        : 100
+*******************************************************************/
+static inline int _frozen_lower_bound (BST_FROZEN* frozen, int key)
+{
+    const int* keys = frozen->keys;
+    unsigned int k = 1, n = (unsigned int)frozen->count;
+
+    while (k <= n)
+    {
+        BST_PREFETCH(keys + BST_FROZEN_PREFETCH * k);
+        k = 2 * k + (keys[k] < key);
+    }
+    return (int)(k >> (BST_CTZ(~k) + 1));
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Retrieve
+ Description    : Searches a snapshot for the data with a key.
+ Pre            : frozen came from BST_Freeze. keyPtr is a pointer to a key as for BST_Retrieve
+ Post           : Return data with the key; null if not found
+ Remarks        : O(log n) with no data dependent branches in the descent
+ Func ID        : 101
+*******************************************************************/
+void* BST_Frozen_Retrieve (BST_FROZEN* frozen, void* keyPtr)
+{
+    int key = frozen->getKey (keyPtr);
+    int k = _frozen_lower_bound (frozen, key);
+
+    return ((k && frozen->keys[k] == key) ? BST_Frozen_Data (frozen, k) : NULL);
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Seek
+ Description    : Finds the position of the first key not below a key.
+ Pre            : frozen came from BST_Freeze. keyPtr is a pointer to a key as for BST_Retrieve
+ Post           : Return position for BST_Frozen_Data and BST_Frozen_Next; 0 if none
+ Remarks        : a range scan is BST_Frozen_Seek followed by BST_Frozen_Next
+ Func ID        : 102
+*******************************************************************/
+int BST_Frozen_Seek (BST_FROZEN* frozen, void* keyPtr)
+{
+    return _frozen_lower_bound (frozen, frozen->getKey (keyPtr));
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_First
+ Description    : Returns the position of the smallest key of a snapshot.
+ Pre            : frozen came from BST_Freeze
+ Post           : Return position; 0 if snapshot empty
+ Remarks        : leftmost node of the implicit tree
+ Func ID        : 103
+*******************************************************************/
+int BST_Frozen_First (BST_FROZEN* frozen)
+{
+    int k = 1;
+
+    if (frozen->count == 0)
+       return 0;
+    while (2 * k <= frozen->count)
+        k *= 2;
+    return k;
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Next
+ Description    : Returns the position of the next key in order.
+ Pre            : k is a position of frozen
+ Post           : Return position; 0 past the last key
+ Remarks        : leftmost node of the right subtree, else climb past the right turns
+                  and one left turn. Amortised O(1)
+ Func ID        : 104
+*******************************************************************/
+int BST_Frozen_Next (BST_FROZEN* frozen, int k)
+{
+    unsigned int pos = (unsigned int)k;
+
+    if (2 * pos + 1 <= (unsigned int)frozen->count)
+    {
+        for (pos = 2 * pos + 1; 2 * pos <= (unsigned int)frozen->count; pos *= 2)
+            ;
+        return (int)pos;
+    }
+    return (int)(pos >> (BST_CTZ(~pos) + 1));
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Last
+ Description    : Returns the position of the largest key of a snapshot.
+ Pre            : frozen came from BST_Freeze
+ Post           : Return position; 0 if snapshot empty
+ Remarks        : rightmost node of the implicit tree
+ Func ID        : 122
+*******************************************************************/
+int BST_Frozen_Last (BST_FROZEN* frozen)
+{
+    int k = 1;
+
+    if (frozen->count == 0)
+       return 0;
+    while (2 * k + 1 <= frozen->count)
+        k = 2 * k + 1;
+    return k;
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Prev
+ Description    : Returns the position of the previous key in order.
+ Pre            : k is a position of frozen
+ Post           : Return position; 0 before the first key
+ Remarks        : mirror of BST_Frozen_Next
+ Func ID        : 123
+*******************************************************************/
+int BST_Frozen_Prev (BST_FROZEN* frozen, int k)
+{
+    unsigned int pos = (unsigned int)k;
+
+    if (2 * pos <= (unsigned int)frozen->count)
+    {
+        for (pos = 2 * pos; 2 * pos + 1 <= (unsigned int)frozen->count; pos = 2 * pos + 1)
+            ;
+        return (int)pos;
+    }
+    return (int)(pos >> (BST_CTZ(pos) + 1));
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Data
+ Description    : Returns the data at a position of a snapshot.
+ Pre            : k is a position of frozen, or 0
+ Post           : Return data; null for position 0
+ Remarks        :
+ Func ID        : 105
+*******************************************************************/
+void* BST_Frozen_Data (BST_FROZEN* frozen, int k)
+{
+    if (!k)
+       return NULL;
+    if (frozen->records)
+       return frozen->records + (size_t)(k - 1) * frozen->record_size;
+    return frozen->data[k];
+}
+
+/*******************************************************************
+ Function Name  : BST_Frozen_Traverse
+ Description    : Processes every data of a snapshot in key order.
+ Pre            : frozen came from BST_Freeze
+ Post           : all data processed
+ Remarks        :
+ Func ID        : 106
+*******************************************************************/
+void BST_Frozen_Traverse (BST_FROZEN* frozen, void (*process) (void* dataPtr))
+{
+    int k;
+
+    for (k = BST_Frozen_First (frozen); k; k = BST_Frozen_Next (frozen, k))
+        process (BST_Frozen_Data (frozen, k));
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _bit_ctz
+ Description    : Counts the trailing zero bits of an unsigned int.
+ Pre            : x is not 0
+ Post           : Return number of trailing zero bits
+ Remarks        : portable BST_CTZ for compilers without __builtin_ctz
+ Func ID        : 107
+*******************************************************************/
+static inline int _bit_ctz (unsigned int x)
+{
+    int count = 0;
+
+    while (!(x & 1u))
+    {
+        x >>= 1;
+        ++count;
+    }
+    return count;
+}
+
+/*******************************************************************
+ Function Name  : _bit_clz
+ Description    : Counts the leading zero bits of an unsigned int.
+ Pre            : x is not 0
+ Post           : Return number of leading zero bits
+ Remarks        : portable BST_CLZ for compilers without __builtin_clz
+ Func ID        : 218
+*******************************************************************/
+static inline int _bit_clz (unsigned int x)
+{
+    int count = 0;
+
+    while (!(x & 0x80000000u))
+    {
+        x <<= 1;
+        ++count;
+    }
+    return count;
+}
+
+/*******************************************************************
+ Function Name  : _bit_count
+ Description    : Counts the bits set in an unsigned int.
+ Pre            :
+ Post           : Return number of bits set
+ Remarks        : portable BST_POPCOUNT for compilers without __builtin_popcount
+ Func ID        : 219
+*******************************************************************/
+static inline int _bit_count (unsigned int x)
+{
+    int count = 0;
+
+    for (; x; x &= x - 1)
+        ++count;
+    return count;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_rank
+ Description    : Counts the keys of a B+ node that are less than a key.
+ Pre            : keys is the cache line aligned key array of a node; n <= BST_BPLUS_KEYS
+ Post           : Return number of keys[0..n) less than key
+ Remarks        : the whole line is compared at once (2 AVX2 or 4 SSE2 compares) into a
+                  bit mask; keys are sorted, so the hits are the low bits and their count
+                  is the trailing zero count of the inverted mask. Keys at or past n are
+                  masked off, so they need not be initialised.
+ Func ID        : 108
+*******************************************************************/
+static inline int _bplus_rank (const int* keys, int n, int key)
+{
+    unsigned int mask;
+#if defined(__AVX2__)
+    __m256i k = _mm256_set1_epi32(key);
+
+    mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i*)keys))))
+         | ((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i*)(keys + 8)))))) << 8;
+#elif defined(__SSE2__)
+    __m128i k = _mm_set1_epi32(key);
+
+    mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, _mm_load_si128((const __m128i*)keys))))
+         | ((unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, _mm_load_si128((const __m128i*)(keys + 4)))))) << 4
+         | ((unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, _mm_load_si128((const __m128i*)(keys + 8)))))) << 8
+         | ((unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, _mm_load_si128((const __m128i*)(keys + 12)))))) << 12;
+#else
+    int i;
+
+    for (mask = 0, i = 0; i < n; ++i)
+        mask |= (unsigned int)(keys[i] < key) << i;
+#endif
+    return BST_CTZ(~(mask & ((1u << n) - 1)));
+}
+
+/*******************************************************************
+ Function Name  : _bplus_alloc
+ Description    : Allocates an empty B+ node from the tree's node pool.
+ Pre            : tree was created with BST_MODE_BPLUS
+ Post           : Return zeroed node; null if overflow
+ Remarks        :
+ Func ID        : 109
+*******************************************************************/
+BST_BPLUS_NODE* _bplus_alloc (BST_TREE* tree, int leaf)
+{
+    BST_BPLUS_NODE* node;
+
+    node = (BST_BPLUS_NODE*)_pool_alloc(&tree->node_pool);
+    if (node)
+    {
+        memset(node, 0, sizeof (BST_BPLUS_NODE));
+        node->leaf = leaf;
+    }
+    return node;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_insert
+ Description    : Inserts a key and its data in the B+ engine.
+ Pre            : tree was created with BST_MODE_BPLUS
+ Post           : Return true, or false if the key is already in the tree or on memory
+                  overflow; the tree is then unchanged
+ Remarks        : a full node splits and passes its separator up. Every node the insert
+                  may split is allocated before anything changes. Appending past the
+                  last key splits the rightmost nodes 16:1 instead of in half, so keys
+                  inserted in order fill nodes completely.
+ Func ID        : 110
+*******************************************************************/
+bool _bplus_insert (BST_TREE* tree, int key, void* dataPtr)
+{
+    BST_BPLUS_NODE* path[BST_MAX_HEIGHT];
+    BST_BPLUS_NODE* spare[BST_MAX_HEIGHT + 1];
+    BST_BPLUS_NODE* node = tree->bplus_root;
+    BST_BPLUS_NODE* right = NULL;
+    void* ptrs[BST_BPLUS_KEYS + 2];
+    int keys[BST_BPLUS_KEYS + 1];
+    int slots[BST_MAX_HEIGHT];
+    int depth = 0, pos, need = 0, i, split, sep = 0;
+    bool append;
+
+    if (!node)
+    {
+        node = _bplus_alloc(tree, 1);
+        if (!node)
+           return false;
+        node->keys[0] = key;
+        node->ptrs[0] = dataPtr;
+        node->num_keys = 1;
+        tree->bplus_root = node;
+        return true;
+    }
+    while (!node->leaf)
+    {
+        path[depth] = node;
+        slots[depth] = _bplus_rank(node->keys, node->num_keys, key);
+        node = (BST_BPLUS_NODE*)node->ptrs[slots[depth++]];
+    }
+    pos = _bplus_rank(node->keys, node->num_keys, key);
+    if (pos < node->num_keys && node->keys[pos] == key)
+       return false;
+    // the full nodes from the leaf up split, plus a new root if the root does
+    if (node->num_keys == BST_BPLUS_KEYS)
+    {
+        for (need = 1, i = depth - 1; i >= 0 && path[i]->num_keys == BST_BPLUS_KEYS; --i)
+            ++need;
+        if (i < 0)
+           ++need;
+    }
+    for (i = 0; i < need; ++i)
+    {
+        spare[i] = _bplus_alloc(tree, 0);
+        if (!spare[i])
+        {
+            while (i-- > 0)
+               _pool_free(&tree->node_pool, spare[i]);
+            return false;
+        }
+    }
+    if (node->num_keys < BST_BPLUS_KEYS)
+    {
+        memmove(node->keys + pos + 1, node->keys + pos, (node->num_keys - pos) * sizeof (int));
+        memmove(node->ptrs + pos + 1, node->ptrs + pos, (node->num_keys - pos) * sizeof (void*));
+        node->keys[pos] = key;
+        node->ptrs[pos] = dataPtr;
+        ++node->num_keys;
+        return true;
+    }
+    // split the leaf: left keeps the first split of the K + 1 entries
+    append = (!node->next && pos == node->num_keys);
+    split = append ? BST_BPLUS_KEYS : (BST_BPLUS_KEYS + 1) / 2;
+    memcpy(keys, node->keys, pos * sizeof (int));
+    memcpy(ptrs, node->ptrs, pos * sizeof (void*));
+    keys[pos] = key;
+    ptrs[pos] = dataPtr;
+    memcpy(keys + pos + 1, node->keys + pos, (BST_BPLUS_KEYS - pos) * sizeof (int));
+    memcpy(ptrs + pos + 1, node->ptrs + pos, (BST_BPLUS_KEYS - pos) * sizeof (void*));
+    right = spare[--need];
+    right->leaf = 1;
+    memcpy(node->keys, keys, split * sizeof (int));
+    memcpy(node->ptrs, ptrs, split * sizeof (void*));
+    node->num_keys = split;
+    memcpy(right->keys, keys + split, (BST_BPLUS_KEYS + 1 - split) * sizeof (int));
+    memcpy(right->ptrs, ptrs + split, (BST_BPLUS_KEYS + 1 - split) * sizeof (void*));
+    right->num_keys = BST_BPLUS_KEYS + 1 - split;
+    right->next = node->next;
+    if (right->next)
+       right->next->prev = right;
+    right->prev = node;
+    node->next = right;
+    sep = node->keys[split - 1];
+    if(trace_flag)
+       printf("\n TRACE[110.01]: split leaf: %p at %d, sep: %d", (void *)node, split, sep);
+    // pass (sep, right) up: child slots[i] + 1 of path[i]
+    for (i = depth - 1; i >= 0; --i)
+    {
+        node = path[i];
+        pos = slots[i];
+        if (node->num_keys < BST_BPLUS_KEYS)
+        {
+            memmove(node->keys + pos + 1, node->keys + pos, (node->num_keys - pos) * sizeof (int));
+            memmove(node->ptrs + pos + 2, node->ptrs + pos + 1, (node->num_keys - pos) * sizeof (void*));
+            node->keys[pos] = sep;
+            node->ptrs[pos + 1] = right;
+            ++node->num_keys;
+            return true;
+        }
+        // split the internal node: left keeps split keys, keys[split] moves up
+        memcpy(keys, node->keys, pos * sizeof (int));
+        memcpy(ptrs, node->ptrs, (pos + 1) * sizeof (void*));
+        keys[pos] = sep;
+        ptrs[pos + 1] = right;
+        memcpy(keys + pos + 1, node->keys + pos, (BST_BPLUS_KEYS - pos) * sizeof (int));
+        memcpy(ptrs + pos + 2, node->ptrs + pos + 1, (BST_BPLUS_KEYS - pos) * sizeof (void*));
+        split = append ? BST_BPLUS_KEYS : BST_BPLUS_KEYS / 2;
+        right = spare[--need];
+        memcpy(node->keys, keys, split * sizeof (int));
+        memcpy(node->ptrs, ptrs, (split + 1) * sizeof (void*));
+        node->num_keys = split;
+        memcpy(right->keys, keys + split + 1, (BST_BPLUS_KEYS - split) * sizeof (int));
+        memcpy(right->ptrs, ptrs + split + 1, (BST_BPLUS_KEYS + 1 - split) * sizeof (void*));
+        right->num_keys = BST_BPLUS_KEYS - split;
+        sep = keys[split];
+    }
+    // the root split: grow a level
+    node = spare[--need];
+    node->keys[0] = sep;
+    node->ptrs[0] = tree->bplus_root;
+    node->ptrs[1] = right;
+    node->num_keys = 1;
+    tree->bplus_root = node;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_delete
+ Description    : Deletes a key from the B+ engine.
+ Pre            : tree was created with BST_MODE_BPLUS
+ Post           : Return data of the key, which is not freed; null if not found
+ Remarks        : nodes are freed when they empty rather than merged when they fall
+                  below half full, as in many B+ trees under mixed workloads; a root
+                  left with a single child hands the root down
+ Func ID        : 111
+*******************************************************************/
+void* _bplus_delete (BST_TREE* tree, int key)
+{
+    BST_BPLUS_NODE* path[BST_MAX_HEIGHT];
+    BST_BPLUS_NODE* node = tree->bplus_root;
+    BST_BPLUS_NODE* child;
+    int slots[BST_MAX_HEIGHT];
+    int depth = 0, pos, i;
+    void* dataPtr;
+
+    if (!node)
+       return NULL;
+    while (!node->leaf)
+    {
+        path[depth] = node;
+        slots[depth] = _bplus_rank(node->keys, node->num_keys, key);
+        node = (BST_BPLUS_NODE*)node->ptrs[slots[depth++]];
+    }
+    pos = _bplus_rank(node->keys, node->num_keys, key);
+    if (pos == node->num_keys || node->keys[pos] != key)
+       return NULL;
+    dataPtr = node->ptrs[pos];
+    --node->num_keys;
+    memmove(node->keys + pos, node->keys + pos + 1, (node->num_keys - pos) * sizeof (int));
+    memmove(node->ptrs + pos, node->ptrs + pos + 1, (node->num_keys - pos) * sizeof (void*));
+    if (node->num_keys > 0)
+       return dataPtr;
+    // the leaf emptied: unlink it, and free it with every ancestor it was the only child of
+    if (node->prev)
+       node->prev->next = node->next;
+    if (node->next)
+       node->next->prev = node->prev;
+    child = node;
+    for (i = depth - 1; i >= 0 && path[i]->num_keys == 0; --i)
+    {
+        _pool_free(&tree->node_pool, child);
+        child = path[i];
+    }
+    _pool_free(&tree->node_pool, child);
+    if (i < 0)
+    {
+        tree->bplus_root = NULL;
+        return dataPtr;
+    }
+    // drop child slots[i] and the separator on one side of it
+    node = path[i];
+    pos = slots[i];
+    --node->num_keys;
+    i = (pos > 0 ? pos - 1 : 0);
+    memmove(node->keys + i, node->keys + i + 1, (node->num_keys - i) * sizeof (int));
+    memmove(node->ptrs + pos, node->ptrs + pos + 1, (node->num_keys + 1 - pos) * sizeof (void*));
+    while (!tree->bplus_root->leaf && tree->bplus_root->num_keys == 0)
+    {
+        child = tree->bplus_root;
+        tree->bplus_root = (BST_BPLUS_NODE*)child->ptrs[0];
+        _pool_free(&tree->node_pool, child);
+    }
+    return dataPtr;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_seek
+ Description    : Finds the first key not below a key in the B+ engine.
+ Pre            : tree was created with BST_MODE_BPLUS
+ Post           : Return leaf holding it and its slot; null if every key is below key
+ Remarks        : one SIMD rank per level
+ Func ID        : 112
+*******************************************************************/
+BST_BPLUS_NODE* _bplus_seek (BST_TREE* tree, int key, int* slot)
+{
+    BST_BPLUS_NODE* node = tree->bplus_root;
+    int pos;
+
+    *slot = 0;
+    if (!node)
+       return NULL;
+    while (!node->leaf)
+        node = (BST_BPLUS_NODE*)node->ptrs[_bplus_rank(node->keys, node->num_keys, key)];
+    pos = _bplus_rank(node->keys, node->num_keys, key);
+    if (pos == node->num_keys)
+    {
+        // past the leaf's last key: the answer opens the next leaf
+        node = node->next;
+        pos = 0;
+    }
+    *slot = pos;
+    return node;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_edge
+ Description    : Returns the first (or last) leaf of the B+ engine.
+ Pre            : tree was created with BST_MODE_BPLUS
+ Post           : Return leaf; null if tree empty
+ Remarks        :
+ Func ID        : 113
+*******************************************************************/
+BST_BPLUS_NODE* _bplus_edge (BST_TREE* tree, bool first)
+{
+    BST_BPLUS_NODE* node = tree->bplus_root;
+
+    while (node && !node->leaf)
+        node = (BST_BPLUS_NODE*)node->ptrs[first ? 0 : node->num_keys];
+    return node;
+}
+
+/*******************************************************************
+ Function Name  : _bplus_build
+ Description    : Loads a stream of data sorted by key into an empty B+ engine.
+ Pre            : as BST_BuildFromStream, with keys strictly increasing
+ Post           : Return true, or false if data was out of order or on memory overflow
+                  (the caller then empties the tree)
+ Remarks        : each key is appended, so the nodes come out full
+ Func ID        : 114
+*******************************************************************/
+bool _bplus_build (BST_TREE* tree, void* (*next) (void* ctx), void* ctx, int count)
+{
+    void* dataPtr;
+    int i, key, prevKey = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        dataPtr = next(ctx);
+        key = tree->getKey(dataPtr);
+        if ((i > 0 && key <= prevKey) || !_bplus_insert(tree, key, dataPtr))
+           return false;
+        if (tree->mode & BST_MODE_HASH)
+           _hash_put(&tree->hash, key, dataPtr);
+        prevKey = key;
+    }
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : BST_Save
+ Description    : Writes every record of a tree to a file that BST_Open maps back.
+ Pre            : tree has been created with BST_MODE_INLINE_KEY. Each record is
+                  record_size bytes holding no pointers, and getKey reads its key
+ Post           : Return true once the file is on disk, or false on memory overflow
+                  or a write error; an existing file is then left as it was, unless
+                  only the sync of its directory failed
+ Remarks        : the file is a BST_FILE_HEADER, then the keys and records in the
+                  layout of BST_Freeze, so child positions are implicit and nothing
+                  in the file is a pointer. The body is checksummed with CRC-32C.
+                  It is written and synced beside path, renamed over it once
+                  complete, and the rename synced through the directory.
+ Func ID        : 117
+*******************************************************************/
+bool BST_Save (BST_TREE* tree, const char* path, size_t record_size)
+{
+    static const char zeros[BST_POOL_ALIGN] = { 0 };
+    BST_FILE_HEADER header;
+    BST_FROZEN* frozen;
+    FILE* file;
+    char tmp_path[FILENAME_MAX];
+    size_t keys_size;
+    bool success;
+    int k;
+
+    if (record_size == 0 || record_size > 0xFFFFFFFFu)
+       return false;
+    if (snprintf(tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int)sizeof (tmp_path))
+       return false;
+    frozen = BST_Freeze (tree);
+    if (!frozen)
+       return false;
+    frozen->keys[0] = 0;
+    keys_size = ((size_t)frozen->count + 1) * sizeof (int);
+    memset (&header, 0, sizeof (header));
+    header.magic = BST_FILE_MAGIC;
+    header.version = BST_FILE_VERSION;
+    header.count = frozen->count;
+    header.record_size = (uint32_t)record_size;
+    // header and keys each pad to a cache line
+    header.keys_offset = BST_POOL_ALIGN;
+    header.records_offset = header.keys_offset + ((keys_size + BST_POOL_ALIGN - 1) & ~(size_t)(BST_POOL_ALIGN - 1));
+    header.file_size = header.records_offset + (uint64_t)frozen->count * record_size;
+    header.body_crc = _crc32c (0, frozen->keys, keys_size);
+    for (k = 1; k <= frozen->count; ++k)
+        header.body_crc = _crc32c (header.body_crc, frozen->data[k], record_size);
+    header.header_crc = _crc32c (0, &header, offsetof (BST_FILE_HEADER, header_crc));
+    file = fopen (tmp_path, "wb");
+    if (!file)
+    {
+       BST_Frozen_Destroy (frozen);
+       return false;
+    }
+    success = fwrite (&header, sizeof (header), 1, file) == 1
+           && fwrite (zeros, header.keys_offset - sizeof (header), 1, file) == 1
+           && fwrite (frozen->keys, keys_size, 1, file) == 1
+           && fwrite (zeros, 1, header.records_offset - header.keys_offset - keys_size, file) == header.records_offset - header.keys_offset - keys_size;
+    // records go out in key position order, 1..count
+    for (k = 1; success && k <= frozen->count; ++k)
+        success = fwrite (frozen->data[k], record_size, 1, file) == 1;
+    success = success && _file_sync (file);
+    success = (fclose (file) == 0) && success;
+    BST_Frozen_Destroy (frozen);
+    if (success && rename (tmp_path, path) != 0)
+       success = false;
+    if (!success)
+       remove (tmp_path);
+    else
+       success = _dir_sync (path);
+    if(trace_flag)
+       printf("\n TRACE[117.01]: saved %d records to %s: %s", header.count, path, success ? "ok" : "failed");
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : BST_Open
+ Description    : Opens a file written by BST_Save as a read only tree.
+ Pre            : compare and getKey are those of the saved tree
+                  verify is true to check the body checksum as well as the header
+ Post           : Return tree serving BST_Retrieve, BST_Traverse, cursors and BST_Count
+                  from the file; null if the file cannot be read, is not a
+                  BST_Save file of this version or fails a check (system_status is
+                  then ERR_INVALID_DATA), or on memory overflow
+ Remarks        : the file is mapped, not read: records are used where they lie, so
+                  opening costs O(1) and pages load as they are touched. The checksum
+                  has to read the whole body, so verify is not free for a large file.
+                  Insert and delete are refused (BST_MODE_MAPPED); BST_Destroy unmaps it.
+ Func ID        : 118
+*******************************************************************/
+BST_TREE* BST_Open (const char* path, int (*compare) (void* argu1, void* argu2), int (*getKey) (void* argu), bool verify)
+{
+    BST_FILE_HEADER header;
+    BST_FROZEN* frozen;
+    BST_TREE* tree;
+    char* map;
+    size_t map_size;
+    uint64_t keys_size;
+    uint32_t crc;
+
+    map = (char*) _file_map (path, &map_size);
+    if (!map)
+       return NULL;
+    // a file shorter than a header fails the magic check; offsets are checked against
+    // what is left of the file, so a crafted offset cannot wrap a sum past the end
+    memset (&header, 0, sizeof (header));
+    if (map_size >= sizeof (header))
+       memcpy (&header, map, sizeof (header));
+    keys_size = ((uint64_t)header.count + 1) * sizeof (int);
+    if (header.magic != BST_FILE_MAGIC || header.version != BST_FILE_VERSION
+        || header.header_crc != _crc32c (0, &header, offsetof (BST_FILE_HEADER, header_crc))
+        || header.count < 0 || header.record_size == 0 || header.file_size != map_size
+        || header.keys_offset < sizeof (header) || header.keys_offset % BST_POOL_ALIGN != 0
+        || header.keys_offset > header.file_size || keys_size > header.file_size - header.keys_offset
+        || header.records_offset < header.keys_offset + keys_size || header.records_offset > header.file_size
+        || (uint64_t)header.count * header.record_size != header.file_size - header.records_offset)
+    {
+        if(trace_flag)
+           printf("\n TRACE[118.01]: %s is not a valid tree file", path);
+        system_status = ERR_INVALID_DATA;
+        _file_unmap (map, map_size);
+        return NULL;
+    }
+    if (verify)
+    {
+        crc = _crc32c (0, map + header.keys_offset, keys_size);
+        crc = _crc32c (crc, map + header.records_offset, (size_t)header.count * header.record_size);
+        if (crc != header.body_crc)
+        {
+            if(trace_flag)
+               printf("\n TRACE[118.02]: %s checksum: %08X, expected: %08X", path, crc, header.body_crc);
+            system_status = ERR_INVALID_DATA;
+            _file_unmap (map, map_size);
+            return NULL;
+        }
+    }
+    frozen = (BST_FROZEN*) calloc (1, sizeof (BST_FROZEN));
+    tree = BST_Create_Key (compare, getKey, BST_MODE_INLINE_KEY);
+    if (!frozen || !tree)
+    {
+        free (frozen);
+        _file_unmap (map, map_size);
+        return BST_Destroy (tree);
+    }
+    frozen->count = header.count;
+    frozen->getKey = getKey;
+    frozen->keys = (int*)(map + header.keys_offset);
+    frozen->records = map + header.records_offset;
+    frozen->record_size = header.record_size;
+    frozen->map = map;
+    frozen->map_size = map_size;
+    tree->mode |= BST_MODE_MAPPED;
+    tree->frozen = frozen;
+    tree->count = header.count;
+    return tree;
+}
+
+/*******************************************************************
+ Function Name  : _crc32c
+ Description    : Extends a CRC-32C (Castagnoli) checksum over a buffer.
+ Pre            : crc is 0 to start, else the result for the preceding bytes
+ Post           : Return checksum
+ Remarks        : SSE4.2 has an instruction for it, 8 bytes at a time; elsewhere it
+                  runs a bit at a time
+ Func ID        : 119
+*******************************************************************/
+uint32_t _crc32c (uint32_t crc, const void* buf, size_t len)
+{
+    const unsigned char* p = (const unsigned char*) buf;
+#if defined(__SSE4_2__)
+    unsigned long long word;
+
+    crc = ~crc;
+    for (; len >= sizeof (word); len -= sizeof (word), p += sizeof (word))
+    {
+        memcpy (&word, p, sizeof (word));
+        crc = (uint32_t)_mm_crc32_u64 (crc, word);
+    }
+    for (; len > 0; --len)
+        crc = _mm_crc32_u8 (crc, *p++);
+#else
+    int i;
+
+    crc = ~crc;
+    for (; len > 0; --len)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; ++i)
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+    }
+#endif
+    return ~crc;
+}
+
+/*******************************************************************
+ Function Name  : _file_map
+ Description    : Maps a whole file read only.
+ Pre            : path names a file
+ Post           : Return address of the file's bytes and their count; null if the
+                  file cannot be opened or is empty
+ Remarks        : where mmap is missing the file is read into one heap block instead
+ Func ID        : 120
+*******************************************************************/
+void* _file_map (const char* path, size_t* size)
+{
+    void* map;
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st;
+    int fd;
+
+    fd = open (path, O_RDONLY);
+    if (fd < 0)
+       return NULL;
+    if (fstat (fd, &st) != 0 || st.st_size <= 0)
+    {
+       close (fd);
+       return NULL;
+    }
+    *size = (size_t)st.st_size;
+    map = mmap (NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    return (map == MAP_FAILED) ? NULL : map;
+#else
+    FILE* file;
+    long len;
+
+    file = fopen (path, "rb");
+    if (!file)
+       return NULL;
+    map = NULL;
+    if (fseek (file, 0, SEEK_END) == 0 && (len = ftell (file)) > 0 && fseek (file, 0, SEEK_SET) == 0)
+    {
+       *size = (size_t)len;
+       map = malloc (*size);
+       if (map && fread (map, *size, 1, file) != 1)
+       {
+          free (map);
+          map = NULL;
+       }
+    }
+    fclose (file);
+    return map;
+#endif
+}
+
+/*******************************************************************
+ Function Name  : _file_unmap
+ Description    : Releases a file mapped by _file_map.
+ Pre            : map and size came from _file_map
+ Post           : mapping released
+ Remarks        :
+ Func ID        : 121
+*******************************************************************/
+void _file_unmap (void* map, size_t size)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    munmap (map, size);
+#else
+    (void)size;
+    free (map);
+#endif
+    return;
+}
+
+/*******************************************************************
+ Function Name  : BST_Journal_Open
+ Description    : Replays a tree's write ahead journal, then journals its changes.
+ Pre            : tree has been created, is writable (not BST_MODE_MAPPED), is not
+                  journaled and holds the snapshot the journal follows: a tree from
+                  BST_Open is mapped read only, so its records are copied into a new
+                  tree first, as loadStu does. Records are record_size bytes with
+                  no pointers and, as in replay, all come from BST_Alloc_Data. batch_ops and batch_usec set the group commit
+ Post           : Return true, or false if the file is not a journal of record_size
+                  records (system_status ERR_INVALID_DATA), cannot be written, or on
+                  memory overflow; the tree may then hold part of the replay
+ Remarks        : replay is one sequential pass over the mapped file. It stops at the
+                  first torn or damaged entry, a write cut short by a crash, and the
+                  file is cut back to the entries before it. A logged insert replaces
+                  any record with its key, so replaying a journal over a snapshot
+                  that already holds its changes gives the same tree.
+                  From here BST_Insert and BST_Delete log each change, and a group
+                  commit writes and syncs the log once batch_ops changes wait or
+                  the oldest has waited batch_usec (<= 0: no time bound). A flusher
+                  thread keeps the time bound while no changes are logged;
+                  BST_Journal_Sync forces a commit.
+ Func ID        : 126
+*******************************************************************/
+bool BST_Journal_Open (BST_TREE* tree, const char* path, size_t record_size, int batch_ops, long batch_usec)
+{
+    BST_JOURNAL_HEADER header;
+    BST_JOURNAL* journal;
+    char* map;
+    size_t map_size, valid;
+
+    if (tree->journal || (tree->mode & BST_MODE_MAPPED) || BST_LOCK_FREE(tree) || tree->shards || record_size == 0
+        || record_size > 0xFFFFFFFFu || strlen(path) + 5 > FILENAME_MAX)
+       return false;
+    journal = (BST_JOURNAL*) calloc (1, sizeof (BST_JOURNAL));
+    if (!journal)
+       return false;
+    journal->record_size = record_size;
+    journal->batch_ops = batch_ops;
+    journal->batch_usec = batch_usec;
+    journal->capacity = sizeof (BST_JOURNAL_ENTRY) + record_size;
+    if (journal->capacity < BST_JOURNAL_BUFFER)
+       journal->capacity = BST_JOURNAL_BUFFER;
+    journal->buf = (char*) malloc (journal->capacity);
+    strcpy(journal->path, path);
+    if (!journal->buf)
+    {
+       free (journal);
+       return false;
+    }
+    memset (&header, 0, sizeof (header));
+    header.magic = BST_JOURNAL_MAGIC;
+    header.version = BST_JOURNAL_VERSION;
+    header.record_size = (uint32_t)record_size;
+    header.header_crc = _crc32c (0, &header, offsetof (BST_JOURNAL_HEADER, header_crc));
+    map = (char*) _file_map (path, &map_size);
+    if (map)
+    {
+       valid = _journal_replay (tree, journal, map, map_size);
+       if (valid >= sizeof (header) && valid != map_size)
+       {
+          if(trace_flag)
+             printf("\n TRACE[126.01]: %s cut back from %lu to %lu bytes", path, (unsigned long)map_size, (unsigned long)valid);
+          if (!_journal_rewrite (journal, map, valid))
+             valid = 0;
+       }
+       _file_unmap (map, map_size);
+    }
+    else
+       valid = _journal_rewrite (journal, &header, sizeof (header)) ? sizeof (header) : 0;
+    if (valid >= sizeof (header))
+       journal->file = fopen (path, "ab");
+    journal->committed = (int64_t)valid;
+    if (journal->file && mtx_init (&journal->lock, mtx_plain) != thrd_success)
+    {
+       fclose (journal->file);
+       journal->file = NULL;
+    }
+    atomic_init (&journal->stop, false);
+    // with a time bound, the flusher commits a group no later change would
+    if (journal->file && batch_usec > 0)
+    {
+       journal->flushing = thrd_create (&journal->flusher, _journal_flush, journal) == thrd_success;
+       if (!journal->flushing)
+       {
+          mtx_destroy (&journal->lock);
+          fclose (journal->file);
+          journal->file = NULL;
+       }
+    }
+    if (!journal->file)
+    {
+       free (journal->buf);
+       free (journal);
+       return false;
+    }
+    // entries are batched in buf, so stdio need not buffer them again
+    setvbuf (journal->file, NULL, _IONBF, 0);
+    tree->journal = journal;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : BST_Journal_Sync
+ Description    : Commits every change a tree has logged.
+ Pre            : tree has been created (journaled or not)
+ Post           : Return true once the changes are on disk, or false on a write
+                  error (system_status FAILURE); they are kept for the next commit
+ Remarks        :
+ Func ID        : 127
+*******************************************************************/
+bool BST_Journal_Sync (BST_TREE* tree)
+{
+    bool success;
+
+    if (!tree->journal)
+       return true;
+    mtx_lock (&tree->journal->lock);
+    success = _journal_commit (tree->journal, true);
+    mtx_unlock (&tree->journal->lock);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : BST_Journal_Compact
+ Description    : Folds a tree's journal into a snapshot.
+ Pre            : tree is journaled. snapshot_path is the BST_Save file the
+                  journal follows
+ Post           : Return true with the tree saved and the journal emptied, or false
+                  with both files as before the call
+ Remarks        : the snapshot is written first and is on disk before the journal
+                  is emptied: a crash in between replays the journal over the new
+                  snapshot, which changes nothing
+ Func ID        : 128
+*******************************************************************/
+bool BST_Journal_Compact (BST_TREE* tree, const char* snapshot_path)
+{
+    BST_JOURNAL* journal = tree->journal;
+    BST_JOURNAL_HEADER header;
+
+    if (!journal)
+       return false;
+    mtx_lock (&journal->lock);
+    if (!_journal_commit (journal, true) || !BST_Save (tree, snapshot_path, journal->record_size))
+    {
+       mtx_unlock (&journal->lock);
+       return false;
+    }
+    memset (&header, 0, sizeof (header));
+    header.magic = BST_JOURNAL_MAGIC;
+    header.version = BST_JOURNAL_VERSION;
+    header.record_size = (uint32_t)journal->record_size;
+    header.header_crc = _crc32c (0, &header, offsetof (BST_JOURNAL_HEADER, header_crc));
+    fclose (journal->file);
+    journal->file = NULL;
+    if (_journal_rewrite (journal, &header, sizeof (header)))
+    {
+       journal->committed = sizeof (header);
+       journal->file = fopen (journal->path, "ab");
+    }
+    if (!journal->file)
+    {
+       // the snapshot is safe; journal what follows in the old file
+       journal->file = fopen (journal->path, "ab");
+       if (!journal->file)
+       {
+          mtx_unlock (&journal->lock);
+          system_status = FAILURE;
+          return false;
+       }
+    }
+    setvbuf (journal->file, NULL, _IONBF, 0);
+    mtx_unlock (&journal->lock);
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : BST_Journal_Close
+ Description    : Commits and stops a tree's journal.
+ Pre            : tree has been created (journaled or not)
+ Post           : Return true, or false if the last commit failed
+ Remarks        : BST_Destroy closes it too. Waits for the flusher thread to stop
+ Func ID        : 129
+*******************************************************************/
+bool BST_Journal_Close (BST_TREE* tree)
+{
+    BST_JOURNAL* journal = tree->journal;
+    bool success;
+
+    if (!journal)
+       return true;
+    if (journal->flushing)
+    {
+       atomic_store (&journal->stop, true);
+       thrd_join (journal->flusher, NULL);
+    }
+    success = _journal_commit (journal, true);
+    if (journal->file)
+       fclose (journal->file);
+    mtx_destroy (&journal->lock);
+    free (journal->buf);
+    free (journal);
+    tree->journal = NULL;
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _journal_replay
+ Description    : Applies the entries of a mapped journal to a tree.
+ Pre            : tree is not journaled yet
+ Post           : Return length of the journal up to its first torn or damaged entry;
+                  0 if it is not a journal of this record size or on memory overflow
+ Remarks        : entries are fixed size, so the pass needs no parsing
+ Func ID        : 130
+*******************************************************************/
+size_t _journal_replay (BST_TREE* tree, BST_JOURNAL* journal, const char* map, size_t map_size)
+{
+    BST_JOURNAL_HEADER header;
+    BST_JOURNAL_ENTRY entry;
+    const char* record;
+    void* dataPtr;
+    size_t pos, entry_size = sizeof (entry) + journal->record_size;
+    int replayed = 0;
+
+    memset (&header, 0, sizeof (header));
+    if (map_size >= sizeof (header))
+       memcpy (&header, map, sizeof (header));
+    if (header.magic != BST_JOURNAL_MAGIC || header.version != BST_JOURNAL_VERSION
+        || header.record_size != journal->record_size
+        || header.header_crc != _crc32c (0, &header, offsetof (BST_JOURNAL_HEADER, header_crc)))
+    {
+        system_status = ERR_INVALID_DATA;
+        return 0;
+    }
+    for (pos = sizeof (header); pos + entry_size <= map_size; pos += entry_size)
+    {
+        memcpy (&entry, map + pos, sizeof (entry));
+        record = map + pos + sizeof (entry);
+        if (entry.crc != _crc32c (_crc32c (0, &entry.op, sizeof (entry.op)), record, journal->record_size)
+            || (entry.op != BST_JOURNAL_INSERT && entry.op != BST_JOURNAL_DELETE))
+           break;
+        // any record is a valid key
+        BST_Delete (tree, (void*)record);
+        if (entry.op == BST_JOURNAL_INSERT)
+        {
+            dataPtr = BST_Alloc_Data (tree, journal->record_size);
+            if (!dataPtr)
+               return 0;
+            memcpy (dataPtr, record, journal->record_size);
+            if (!BST_Insert (tree, dataPtr))
+            {
+                BST_Free_Data (tree, dataPtr);
+                return 0;
+            }
+        }
+        ++replayed;
+    }
+    if(trace_flag)
+       printf("\n TRACE[130.01]: replayed %d entries", replayed);
+    return pos;
+}
+
+/*******************************************************************
+ Function Name  : _journal_rewrite
+ Description    : Replaces the journal file with the given bytes.
+ Pre            : bytes starts with a journal header
+ Post           : Return true, or false with the file as it was
+ Remarks        : written and synced beside the journal, then renamed over it and
+                  the rename synced through the directory
+ Func ID        : 131
+*******************************************************************/
+bool _journal_rewrite (BST_JOURNAL* journal, const void* bytes, size_t len)
+{
+    char tmp_path[FILENAME_MAX];
+    FILE* file;
+    bool success;
+
+    if (snprintf(tmp_path, sizeof (tmp_path), "%s.tmp", journal->path) >= (int)sizeof (tmp_path))
+       return false;
+    file = fopen (tmp_path, "wb");
+    if (!file)
+       return false;
+    success = fwrite (bytes, len, 1, file) == 1 && _file_sync (file);
+    success = (fclose (file) == 0) && success;
+    if (success && rename (tmp_path, journal->path) != 0)
+       success = false;
+    if (!success)
+       remove (tmp_path);
+    else
+       success = _dir_sync (journal->path);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _journal_reserve
+ Description    : Makes room in the journal buffer for one more entry.
+ Pre            : journal is open
+ Post           : Return true, or false if a full buffer could not be committed or the
+                  journal has failed (system_status FAILURE)
+ Remarks        : called before a change, so a change that cannot be logged is not made
+ Func ID        : 132
+*******************************************************************/
+bool _journal_reserve (BST_JOURNAL* journal)
+{
+    bool success = true;
+
+    mtx_lock (&journal->lock);
+    if (journal->failed)
+    {
+       system_status = FAILURE;
+       success = false;
+    }
+    else if (journal->used + sizeof (BST_JOURNAL_ENTRY) + journal->record_size > journal->capacity)
+       success = _journal_commit (journal, true);
+    mtx_unlock (&journal->lock);
+    return success;
+}
+
+/*******************************************************************
+ Function Name  : _journal_log
+ Description    : Logs a change and commits the group if it is due.
+ Pre            : _journal_reserve succeeded for this change
+ Post           : entry buffered (and maybe committed)
+ Remarks        : a failed commit keeps the entries for the next one
+ Func ID        : 133
+*******************************************************************/
+void _journal_log (BST_JOURNAL* journal, uint32_t op, const void* dataPtr)
+{
+    BST_JOURNAL_ENTRY entry;
+
+    entry.op = op;
+    entry.crc = _crc32c (_crc32c (0, &entry.op, sizeof (entry.op)), dataPtr, journal->record_size);
+    mtx_lock (&journal->lock);
+    memcpy (journal->buf + journal->used, &entry, sizeof (entry));
+    memcpy (journal->buf + journal->used + sizeof (entry), dataPtr, journal->record_size);
+    journal->used += sizeof (entry) + journal->record_size;
+    if (journal->pending++ == 0)
+       journal->first_usec = _journal_usec ();
+    _journal_commit (journal, false);
+    mtx_unlock (&journal->lock);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : _journal_commit
+ Description    : Writes and syncs the buffered entries of a journal.
+ Pre            : journal is open; caller holds its lock, or the flusher has stopped
+ Post           : Return true if nothing is left pending, false on a write error
+                  (system_status FAILURE)
+ Remarks        : unless forced, waits until batch_ops entries are pending or the
+                  oldest is batch_usec old, so one sync covers the whole group.
+                  A failed write is cut off the file, so the entries kept for the
+                  next commit follow the last whole one; replay would stop at a torn
+                  entry and drop every commit after it. If the file cannot be cut,
+                  the journal fails and takes no more changes
+ Func ID        : 134
+*******************************************************************/
+bool _journal_commit (BST_JOURNAL* journal, bool force)
+{
+    if (journal->pending == 0)
+       return true;
+    if (!force && journal->pending < journal->batch_ops
+        && (journal->batch_usec <= 0 || _journal_usec () - journal->first_usec < journal->batch_usec))
+       return true;
+    if (journal->failed || !journal->file)
+    {
+        system_status = FAILURE;
+        return false;
+    }
+    if (fwrite (journal->buf, journal->used, 1, journal->file) != 1 || !_file_sync (journal->file))
+    {
+        clearerr (journal->file);
+        if (!_journal_cut (journal))
+           journal->failed = true;
+        if(trace_flag)
+           printf("\n TRACE[134.02]: commit failed, journal %s", journal->failed ? "failed" : "cut back");
+        system_status = FAILURE;
+        return false;
+    }
+    if(trace_flag)
+       printf("\n TRACE[134.01]: committed %d entries", journal->pending);
+    journal->committed += (int64_t)journal->used;
+    journal->used = 0;
+    journal->pending = 0;
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : _journal_cut
+ Description    : Cuts a journal file back to its committed entries.
+ Pre            : journal is open
+ Post           : Return true, or false if the file cannot be cut
+ Remarks        : the file is appended to, so the next write follows the cut
+ Func ID        : 220
+*******************************************************************/
+bool _journal_cut (BST_JOURNAL* journal)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    return (ftruncate (fileno (journal->file), (off_t)journal->committed) == 0);
+#elif defined(_WIN32)
+    return (_chsize_s (_fileno (journal->file), journal->committed) == 0);
+#else
+    (void)journal;
+    return false;
+#endif
+}
+
+/*******************************************************************
+ Function Name  : _journal_flush
+ Description    : Flusher thread of a journal with a time bound.
+ Pre            : arg is the journal; batch_usec > 0
+ Post           : Return 0 once stop is set
+ Remarks        : sleeps until the oldest pending change is batch_usec old, then
+                  commits it, so changes are not held while the tree is idle
+ Func ID        : 225
+*******************************************************************/
+int _journal_flush (void* arg)
+{
+    BST_JOURNAL* journal = (BST_JOURNAL*)arg;
+    struct timespec ts;
+    int64_t wait;
+
+    while (!atomic_load (&journal->stop))
+    {
+        mtx_lock (&journal->lock);
+        _journal_commit (journal, false);
+        wait = journal->pending ? journal->first_usec + journal->batch_usec - _journal_usec () : journal->batch_usec;
+        mtx_unlock (&journal->lock);
+        // a group still due here failed to commit: retry after a whole period
+        if (wait <= 0 || wait > BST_JOURNAL_FLUSH_USEC)
+           wait = journal->batch_usec < BST_JOURNAL_FLUSH_USEC ? journal->batch_usec : BST_JOURNAL_FLUSH_USEC;
+        ts.tv_sec = (time_t)(wait / 1000000);
+        ts.tv_nsec = (long)(wait % 1000000) * 1000;
+        thrd_sleep (&ts, NULL);
+    }
+    return 0;
+}
+
+#if defined(_WIN32) && !defined(BST_HAVE_THREADS_H)
+/*******************************************************************
+ Function Name  : _thrd_start
+ Description    : Runs a thrd_create start function on a Win32 thread.
+ Pre            : start came from thrd_create
+ Post           : start freed. Return the start function's result
+ Remarks        :
+ Func ID        : 221
+*******************************************************************/
+unsigned __stdcall _thrd_start (void* start)
+{
+    BST_THRD_START run = *(BST_THRD_START*)start;
+
+    free (start);
+    return (unsigned)run.func (run.arg);
+}
+
+/*******************************************************************
+ Function Name  : thrd_create
+ Description    : C11 thrd_create on _beginthreadex, for Windows without <threads.h>.
+ Pre            : func is a thread start function
+ Post           : Return thrd_success with *thr running func (arg), or thrd_error
+ Remarks        :
+ Func ID        : 222
+*******************************************************************/
+int thrd_create (thrd_t* thr, thrd_start_t func, void* arg)
+{
+    BST_THRD_START* start = (BST_THRD_START*) malloc (sizeof (BST_THRD_START));
+
+    if (!start)
+       return thrd_error;
+    start->func = func;
+    start->arg = arg;
+    *thr = (thrd_t) _beginthreadex (NULL, 0, _thrd_start, start, 0, NULL);
+    if (!*thr)
+    {
+       free (start);
+       return thrd_error;
+    }
+    return thrd_success;
+}
+
+/*******************************************************************
+ Function Name  : thrd_join
+ Description    : C11 thrd_join, for Windows without <threads.h>.
+ Pre            : thr came from thrd_create and is not yet joined
+ Post           : thread ended and its handle closed; *res (may be null) holds its result.
+                  Return thrd_success, or thrd_error
+ Remarks        :
+ Func ID        : 223
+*******************************************************************/
+int thrd_join (thrd_t thr, int* res)
+{
+    DWORD code;
+
+    if (WaitForSingleObject (thr, INFINITE) != WAIT_OBJECT_0 || !GetExitCodeThread (thr, &code))
+    {
+       CloseHandle (thr);
+       return thrd_error;
+    }
+    CloseHandle (thr);
+    if (res)
+       *res = (int)code;
+    return thrd_success;
+}
+#endif
+
+/*******************************************************************
+ Function Name  : _journal_usec
+ Description    : Returns the time in microseconds.
+ Pre            :
+ Post           : Return microseconds since an arbitrary origin
+ Remarks        :
+ Func ID        : 135
+*******************************************************************/
+int64_t _journal_usec (void)
+{
+    struct timespec ts;
+
+    timespec_get (&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*******************************************************************
+ Function Name  : _file_sync
+ Description    : Forces a file's written data to disk.
+ Pre            : file is open for writing
+ Post           : Return true, or false on a write error
+ Remarks        : fdatasync skips the metadata a journal append does not need
+ Func ID        : 136
+*******************************************************************/
+bool _file_sync (FILE* file)
+{
+    if (fflush (file) != 0)
+       return false;
+#if defined(__linux__)
+    return (fdatasync (fileno (file)) == 0);
+#elif defined(__unix__) || defined(__APPLE__)
+    return (fsync (fileno (file)) == 0);
+#else
+    return true;
+#endif
+}
+
+/*******************************************************************
+ Function Name  : _dir_sync
+ Description    : Forces the directory entry of a file to disk.
+ Pre            : path names a file that was just created or renamed
+ Post           : Return true, or false if its directory cannot be synced
+ Remarks        : a rename is only durable once its directory is synced; Windows
+                  has no directory sync, and NTFS journals the rename itself
+ Func ID        : 224
+*******************************************************************/
+bool _dir_sync (const char* path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    char dir[FILENAME_MAX];
+    char* slash;
+    int fd;
+    bool success;
+
+    if (snprintf(dir, sizeof (dir), "%s", path) >= (int)sizeof (dir))
+       return false;
+    slash = strrchr (dir, '/');
+    if (!slash)
+       strcpy(dir, ".");
+    else if (slash == dir)
+       dir[1] = NULL_CHAR;
+    else
+       *slash = NULL_CHAR;
+    fd = open (dir, O_RDONLY);
+    if (fd < 0)
+       return false;
+    success = (fsync (fd) == 0);
+    close (fd);
+    return success;
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+/*******************************************************************
+ Function Name  : BST_ImportCSV
+ Description    : Inserts the rows of a CSV or TSV file, one record per row.
+ Pre            : tree has been created; its records all come from BST_Alloc_Data.
+                  delim is ',' or '\t', or 0 to take '\t' if the first row holds
+                  one, else ','. parse fills a zeroed record_size record from the
+                  fields of a row and returns null, or why the row is rejected.
+                  reject (may be null) is told of each rejected row
+ Post           : Return number of rows inserted; -1 if the file cannot be opened.
+                  rejected is the number of rows rejected
+ Remarks        : the file is read in BST_IMPORT_BLOCK blocks and each row is split
+                  in place, so nothing is read a character at a time. A row whose
+                  key is already in the tree is rejected, as is a row longer than a
+                  block; a field may be wrapped in double quotes. A first row that
+                  does not parse is a header and is skipped. Import stops early only
+                  on memory overflow or a read error (system_status ERR_BST_FULL or
+                  FAILURE)
+ Func ID        : 137
+*******************************************************************/
+int BST_ImportCSV (BST_TREE* tree, const char* path, char delim, size_t record_size,
+                   const char* (*parse) (char** fields, int num_fields, void* dataPtr),
+                   void (*reject) (long line_num, const char* reason), int* rejected)
+{
+    FILE* file;
+    char *buf, *line, *eol, *row_end, *end, *field, *sep;
+    char* fields[BST_IMPORT_MAX_FIELDS];
+    const char* reason;
+    void* dataPtr;
+    size_t kept = 0, got, len;
+    long line_num = 0;
+    int imported = 0, num_fields;
+    bool eof = false, skipping = false, stop = false;
+
+    *rejected = 0;
+    file = fopen (path, "rb");
+    if (!file)
+       return -1;
+    // one spare byte ends a last row that has no newline
+    buf = (char*) malloc (BST_IMPORT_BLOCK + 1);
+    if (!buf)
+    {
+       fclose (file);
+       system_status = ERR_BST_FULL;
+       return 0;
+    }
+    while (!eof && !stop)
+    {
+        got = fread (buf + kept, 1, BST_IMPORT_BLOCK - kept, file);
+        eof = (got < BST_IMPORT_BLOCK - kept);
+        if (eof && ferror (file))
+           system_status = FAILURE;
+        end = buf + kept + got;
+        if (eof && end > buf && end[-1] != '\n')
+           *end++ = '\n';
+        for (line = buf; !stop && (eol = (char*) memchr (line, '\n', end - line)); line = eol + 1)
+        {
+            ++line_num;
+            reason = NULL;
+            if (skipping)
+            {
+                skipping = false;
+                reason = "row too long";
+            }
+            else
+            {
+                // the next row starts after eol, so a '\r' is cut at row_end
+                *eol = '\0';
+                row_end = eol;
+                if (row_end > line && row_end[-1] == '\r')
+                   *--row_end = '\0';
+                if (row_end == line)
+                   continue;
+                if (!delim)
+                   delim = memchr (line, '\t', row_end - line) ? '\t' : ',';
+                // split in place
+                for (num_fields = 0, field = line; field && num_fields < BST_IMPORT_MAX_FIELDS; ++num_fields)
+                {
+                    sep = (char*) memchr (field, delim, row_end - field);
+                    len = (sep ? sep : row_end) - field;
+                    if (sep)
+                       *sep++ = '\0';
+                    if (len > 1 && field[0] == '"' && field[len - 1] == '"')
+                    {
+                       field[len - 1] = '\0';
+                       ++field;
+                    }
+                    fields[num_fields] = field;
+                    field = sep;
+                }
+                dataPtr = BST_Alloc_Data (tree, record_size);
+                if (!dataPtr)
+                {
+                    system_status = ERR_BST_FULL;
+                    stop = true;
+                    break;
+                }
+                if (field)
+                   reason = "too many fields";
+                else
+                   reason = parse (fields, num_fields, dataPtr);
+                if (!reason && BST_Retrieve (tree, dataPtr))
+                   reason = "duplicate key";
+                if (!reason && !BST_Insert (tree, dataPtr))
+                {
+                    BST_Free_Data (tree, dataPtr);
+                    system_status = ERR_BST_FULL;
+                    stop = true;
+                    break;
+                }
+                if (!reason)
+                {
+                   ++imported;
+                   continue;
+                }
+                BST_Free_Data (tree, dataPtr);
+                // a first row that does not parse is a header
+                if (line_num == 1)
+                   continue;
+            }
+            ++*rejected;
+            if (reject)
+               reject (line_num, reason);
+        }
+        kept = end - line;
+        if (kept == BST_IMPORT_BLOCK)
+        {
+            // no newline in a whole block: drop the row up to its end
+            skipping = true;
+            kept = 0;
+        }
+        else
+            memmove (buf, line, kept);
+    }
+    free (buf);
+    fclose (file);
+    if(trace_flag)
+       printf("\n TRACE[137.01]: %s: %ld lines, %d imported, %d rejected", path, line_num, imported, *rejected);
+    return imported;
+}
+
+/*******************************************************************
+ Function Name  : main
+ Description    : Runs the student list menu. With -import file..., imports roster
+                  files into the saved list without the menu; with -batch [file],
+                  runs the commands of file (default stdin) on the saved list.
+ Pre            :
+ Post           : Return 0, or 1 if a file could not be imported or read, a batch
+                  result could not be written, or the command line is wrong
+ Remarks        : batch mode writes only command results to stdout; what the other
+                  modes print about loading and saving goes to stderr
+ Func ID        : 15
+*******************************************************************/
+int main (int argc, char* argv[])
+{
+   BST_TREE* list;
+   FILE *in = stdin, *report = stdout;
+   char option = ' ';
+   int i, status = 0;
+   long num_cmds, failed;
+   bool batch;
+#ifdef BST_BENCHMARK
+   if (benchParsers (BST_BENCHMARK) != 0 || benchReaders (BST_BENCHMARK) != 0 || benchWriters (BST_BENCHMARK) != 0
+       || benchParallel (BST_BENCHMARK) != 0 || benchTeardown (BST_BENCHMARK) != 0)
+      return 100;
+   return benchEngines (BST_BENCHMARK);
+#endif
+   batch = (argc > 1 && strcmp (argv[1], "-batch") == 0);
+   if (argc > 1 && !(batch && argc <= 3) && (argc < 3 || strcmp (argv[1], "-import") != 0))
+   {
+       printf("usage: %s [-import file... | -batch [file]]\n", argv[0]);
+       return 1;
+   }
+   if (batch)
+   {
+       report = stderr;
+       if (argc == 3 && !(in = fopen (argv[2], "rb")))
+       {
+           fprintf(stderr, "ERR: cannot read %s\n", argv[2]);
+           return 1;
+       }
+   }
+   else
+       printf("\n Begin Student List");
+   // every student comes from BST_Alloc_Data, so the list goes in one arena and is
+   // dropped at exit without a walk
+   list = BST_Create_Arena (compareStu, getStuKey, BST_MODE_AVL | BST_MODE_INLINE_KEY | BST_MODE_ORDER_STAT | BST_MODE_HASH, NULL);
+   if (!list || !BST_Add_Index (list, compareStuGpa, BST_MODE_AVL) || !BST_Add_Trie_Index (list, getStuName))
+   {
+       fprintf(report, "\n ERR: Memory Overflow in create");
+       exit(100);
+   }
+   loadStu (list, report);
+   // a batch is synced by size and age only, not after each command
+   if (!BST_Journal_Open (list, STUDENT_JOURNAL, sizeof (STUDENT),
+                          batch ? STUDENT_BATCH_JOURNAL_OPS : STUDENT_JOURNAL_BATCH_OPS, STUDENT_JOURNAL_BATCH_USEC))
+       fprintf(report, "\n ERR: %s cannot be used; changes are saved only on quit", STUDENT_JOURNAL);
+   if (batch)
+   {
+       num_cmds = batchStu (list, in, &failed);
+       if (num_cmds < 0)
+       {
+          fprintf(report, "\n ERR: could not write the batch results");
+          status = 1;
+       }
+       else
+          fprintf(report, "\n %ld commands run, %ld failed", num_cmds, failed);
+       if (in != stdin)
+          fclose (in);
+       saveStu (list, report);
+       list = BST_Destroy (list);
+       fprintf(report, "\n");
+       return status;
+   }
+   if (argc > 1)
+   {
+       for (i = 2; i < argc; ++i)
+       {
+           if (!importStu (list, argv[i]))
+              status = 1;
+       }
+       saveStu (list, report);
+       list = BST_Destroy (list);
+       printf("\n");
+       return status;
+   }
+   while ((option = getOption ()) != 'Q')
+   {
+	    switch (option)
+       {
+            case 'A':
+			    addStu (list);
+            break;
+            case 'D':
+			    deleteStu (list);
+            break;
+            case 'F':
+			   findStu (list);
+            break;
+            case 'P':
+			   printList (list);
+            break;
+            case 'R':
+			   printRange (list);
+            break;
+            case 'G':
+			   printPage (list);
+            break;
+            case 'T':
+			   printTopStu (list);
+            break;
+            case 'B':
+			   printBelowGpa (list);
+            break;
+            case 'S':
+			   printStats (list);
+            break;
+            case 'N':
+			   findStuPrefix (list);
+            break;
+            case 'E':
+			   findStuName (list);
+            break;
+            case 'U':
+    			testUtilties (list);
+            break;
+       }
+       // back at the prompt, every change made so far is on disk
+       if (!BST_Journal_Sync (list))
+          printf("\n ERR: could not write %s", STUDENT_JOURNAL);
+    }
+    saveStu (list, report);
+    list = BST_Destroy (list);
+    printf("\nEnd Student List\n");
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : getOption
+ Description    : Reads and validates processing option from keyboard.
+ Pre            :
+ Post           : valid option returned
+ Remarks        :
+ Func ID        : 16
+*******************************************************************/
+char getOption (void)
+{
+    char option[2];
+    bool error = true;
+
+    printf("\n ====== MENU ======\n");
+    printf(" A - Add Student\n");
+    printf(" D - Delete Student\n");
+    printf(" F - Find Student\n");
+    printf(" P - Print Class List\n");
+    printf(" R - Print Student Id Range\n");
+    printf(" G - Print Page of Class List\n");
+    printf(" T - Print Top Students by GPA\n");
+    printf(" B - Print Students Below GPA\n");
+    printf(" S - Show GPA Statistics\n");
+    printf(" N - Find Students by Name Prefix\n");
+    printf(" E - Find Students by Exact Name\n");
+    printf(" U - Show Utilities\n");
+    printf(" Q - Quit\n");
+    do
+    {
+        printf("\nEnter Option: ");
+        if((Get_Input_Str(option, 2)) != SUCCESS)
+		{
+			printf("\n Invalid option. Please re-enter: ");
+            error = true;
+			continue;
+		}
+        option[0] = toupper(option[0]);
+        if (option[0] == 'A' || option[0] == 'D' || option[0] == 'F' || option[0] == 'P' || option[0] == 'R' || option[0] == 'G' || option[0] == 'T' || option[0] == 'B' || option[0] == 'S' || option[0] == 'N' || option[0] == 'E' || option[0] == 'U' || option[0] == 'Q')
+          error = false;
+        else
+        {
+           printf("\n Invalid option. Please re-enter: ");
+           error = true;
+        }
+    } while (error == true);
+    return option[0];
+}
+/*******************************************************************
+ Function Name  : addStu
+ Description    : Adds a student to tree.
+ Pre            :
+ Post           : student added (abort on memory overflow)
+ Remarks        :
+ Func ID        : 17
+*******************************************************************/
+void addStu (BST_TREE* list)
+{
+    STUDENT *getPtr, *stuPtr;
+
+     stuPtr = (STUDENT*) BST_Alloc_Data (list, sizeof (STUDENT));
+     if (!stuPtr)
+     {
+         printf("\n ERR: Memory Overflow in add");
+    	 exit(101);
+     }
+     printf("Enter student id: ");
+	 if((Get_Validate_Input_Number(&(stuPtr->id), temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+     {
+		printf("\n ERR: Invalid student ID");
+		BST_Free_Data(list, stuPtr);
+		return;
+     }
+     getPtr = (STUDENT*)BST_Retrieve (list, &stuPtr->id);
+	 if(getPtr != NULL && getPtr->id == (stuPtr->id))
+	 {
+		 printf("\n ERR[17.01]: Student ID: %d already exist with name: %s, gpa: %f", getPtr->id, getPtr->name, getPtr->gpa);
+		 BST_Free_Data(list, stuPtr);
+		 return;
+	 }
+     printf("Enter student name: ");
+	 if((Get_Input_Alpha_Char_Str(stuPtr->name, STUDENT_NAME_MAX_CHARS)) != SUCCESS)
+	 {
+        BST_Free_Data(list, stuPtr);
+		return;
+	 }
+     printf("Enter student gpa: ");
+     if((Get_Validate_Input_Float(&(stuPtr->gpa),temp_str, STR_MAX_NUM_CHARS, STUDENT_MIN_GRADE, STUDENT_MAX_GRADE)) != SUCCESS)
+     {
+		printf("\n ERR: Invalid grade ID");
+		BST_Free_Data(list, stuPtr);
+		return;
+     }
+     if (!BST_Insert (list, stuPtr))
+     {
+        printf("\n ERR: Memory Overflow in add");
+        BST_Free_Data(list, stuPtr);
+     }
+}
+/*******************************************************************
+ Function Name  : deleteStu
+ Description    : Deletes a student from the tree.
+ Pre            :
+ Post           : student deleted or error message printed
+ Remarks        :
+ Func ID        : 18
+*******************************************************************/
+void deleteStu (BST_TREE* list)
+{
+   int id;
+   int* idPtr = &id;
+
+   printf("Enter student id: ");
+   if((Get_Validate_Input_Number(idPtr, temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+   {
+		printf("\n ERR: Invalid student ID");
+		return;
+   }
+   if (!BST_Delete (list, idPtr))
+      printf("\n ERROR: No Student: %d", *idPtr);
+}
+/*******************************************************************
+ Function Name  : findStuPrefix
+ Description    : Prints the students whose name starts with a prefix.
+ Pre            : list has a name index from BST_Add_Trie_Index
+ Post           : matching students printed in name order
+ Remarks        : O(len + k) on the name trie instead of a scan of the class
+ Func ID        : 89
+*******************************************************************/
+void findStuPrefix (BST_TREE* list)
+{
+    char prefix[STUDENT_NAME_MAX_CHARS];
+
+    printf("Enter name prefix: ");
+    if((Get_Input_Alpha_Char_Str(prefix, STUDENT_NAME_MAX_CHARS)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid name");
+        return;
+    }
+    printf("\nStudents named %s...:", prefix);
+    printf("\n======================");
+    if (BST_Trie_Prefix (list->trie, prefix, processStu) == 0)
+       printf("\n No Student");
+    printf("\n =====================");
+    printf("\nEnd of Student List\n");
+    return;
+}
+/*******************************************************************
+ Function Name  : findStuName
+ Description    : Prints the students with a given name.
+ Pre            : list has a name index from BST_Add_Trie_Index
+ Post           : matching students printed
+ Remarks        :
+ Func ID        : 90
+*******************************************************************/
+void findStuName (BST_TREE* list)
+{
+    char name[STUDENT_NAME_MAX_CHARS];
+
+    printf("Enter student name: ");
+    if((Get_Input_Alpha_Char_Str(name, STUDENT_NAME_MAX_CHARS)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid name");
+        return;
+    }
+    if (BST_Trie_Match (list->trie, name, processStu) == 0)
+       printf("\n ERROR: No Student named: %s", name);
+    return;
+}
+/*******************************************************************
+ Function Name  : loadStu
+ Description    : Loads the students saved by the last run into the list.
+ Pre            : list has been created and is empty
+ Post           : saved students inserted; nothing if no roster was saved.
+                  What was loaded is printed to report
+ Remarks        : the saved file is mapped and walked in id order, and each record
+                  is copied into the list, which the menu then edits. The journal
+                  replays the changes made since on top
+ Func ID        : 124
+*******************************************************************/
+void loadStu (BST_TREE* list, FILE* report)
+{
+    BST_TREE* saved;
+    BST_CURSOR* cursor;
+    STUDENT *stuPtr, *newPtr;
+    int loaded = 0;
+
+    saved = BST_Open (STUDENT_FILE, compareStu, getStuKey, true);
+    if (!saved)
+    {
+        if (system_status == ERR_INVALID_DATA)
+           fprintf(report, "\n ERR: %s is damaged; starting with an empty list", STUDENT_FILE);
+        return;
+    }
+    cursor = BST_Cursor_Create (saved);
+    for (stuPtr = cursor ? (STUDENT*)BST_Cursor_First (cursor) : NULL; stuPtr; stuPtr = (STUDENT*)BST_Cursor_Next (cursor))
+    {
+        newPtr = (STUDENT*) BST_Alloc_Data (list, sizeof (STUDENT));
+        if (!newPtr)
+           break;
+        *newPtr = *stuPtr;
+        if (!BST_Insert (list, newPtr))
+        {
+           BST_Free_Data (list, newPtr);
+           break;
+        }
+        ++loaded;
+    }
+    if (loaded < BST_Count (saved))
+       fprintf(report, "\n ERR: Memory Overflow in load");
+    BST_Cursor_Destroy (cursor);
+    BST_Destroy (saved);
+    fprintf(report, "\n %d students loaded from %s", loaded, STUDENT_FILE);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : saveStu
+ Description    : Saves the list for the next run.
+ Pre            : list has been created
+ Post           : list written to STUDENT_FILE, or an error printed to report
+ Remarks        : folds the journal into the file; the changes are already in the
+                  journal if that fails
+ Func ID        : 125
+*******************************************************************/
+void saveStu (BST_TREE* list, FILE* report)
+{
+    if (BST_Journal_Compact (list, STUDENT_FILE) || BST_Save (list, STUDENT_FILE, sizeof (STUDENT)))
+       fprintf(report, "\n %d students saved to %s", BST_Count (list), STUDENT_FILE);
+    else
+       fprintf(report, "\n ERR: could not save %s", STUDENT_FILE);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : importStu
+ Description    : Imports a CSV or TSV roster file of id,name,gpa rows.
+ Pre            : list has been created
+ Post           : Return true, or false if the file could not be read
+ Remarks        : rejected rows are listed and skipped
+ Func ID        : 138
+*******************************************************************/
+bool importStu (BST_TREE* list, const char* path)
+{
+    int imported, rejected;
+
+    imported = BST_ImportCSV (list, path, 0, sizeof (STUDENT), parseStuRow, rejectStuRow, &rejected);
+    if (imported < 0)
+    {
+        printf("\n ERR: cannot read %s", path);
+        return false;
+    }
+    printf("\n %s: %d students imported, %d rows rejected", path, imported, rejected);
+    return true;
+}
+
+/*******************************************************************
+ Function Name  : parseStuRow
+ Description    : Fills a student from the fields of an imported row.
+ Pre            : stuPtr is a zeroed student
+ Post           : Return null, or why the row is rejected
+ Remarks        : the limits are those addStu checks on keyboard input
+ Func ID        : 139
+*******************************************************************/
+const char* parseStuRow (char** fields, int num_fields, void* stuPtr)
+{
+    STUDENT* stu = (STUDENT*)stuPtr;
+    size_t len, i;
+
+    if (num_fields != 3)
+       return "expected id,name,gpa";
+    len = strlen(fields[0]);
+    if (len >= STR_MAX_NUM_CHARS || Str_to_Num_Range(&stu->id, fields[0], len, MIN_STUDENT_ID, MAX_STUDENT_ID) != SUCCESS)
+       return "invalid student id";
+    len = strlen(fields[1]);
+    if (len == 0 || len >= STUDENT_NAME_MAX_CHARS)
+       return "invalid student name";
+    for (i = 0; i < len; ++i)
+    {
+        if (!((fields[1][i] >= 'A' && fields[1][i] <= 'Z') || (fields[1][i] >= 'a' && fields[1][i] <= 'z') || fields[1][i] == ' '))
+           return "invalid student name";
+    }
+    memcpy(stu->name, fields[1], len + 1);
+    len = strlen(fields[2]);
+    if (len >= STR_MAX_NUM_CHARS || Str_to_Float_Range(&stu->gpa, fields[2], len, STUDENT_MIN_GRADE, STUDENT_MAX_GRADE) != SUCCESS)
+       return "invalid gpa";
+    return NULL;
+}
+
+/*******************************************************************
+ Function Name  : rejectStuRow
+ Description    : Reports a rejected row of an import.
+ Pre            :
+ Post           : row and reason printed
+ Remarks        :
+ Func ID        : 140
+*******************************************************************/
+void rejectStuRow (long line_num, const char* reason)
+{
+    printf("\n ERR: line %ld: %s", line_num, reason);
+    return;
+}
+
+/*******************************************************************
+ Function Name  : batchStu
+ Description    : Runs a stream of commands on the list without prompts:
+                     A id name gpa   add a student
+                     D id            delete a student
+                     F id            print a student
+                     P               print the class list
+                  one per line; blank lines and lines starting with # are skipped.
+ Pre            : list has been created; in is open for reading
+ Post           : Return number of commands run, or -1 if the results could not be
+                  written. failed is the number of commands that failed; each
+                  wrote "ERR line n: reason" in place of its result
+ Remarks        : students print as "id name gpa" lines in the menu's format. All
+                  output goes through one STUDENT_BATCH_OUT buffer written to stdout
+                  when full, and in is read through a buffer of the same size, so a
+                  command costs a line read, its tree operation and a memcpy.
+                  Memory overflow fails the command rather than ending the run
+ Func ID        : 142
+*******************************************************************/
+long batchStu (BST_TREE* list, FILE* in, long* failed)
+{
+    char line[STUDENT_BATCH_LINE];
+    const char* reason;
+    size_t len;
+    long line_num = 0, num_cmds = 0;
+    int ch;
+
+    *failed = 0;
+    batch_out = (char*) malloc (STUDENT_BATCH_OUT);
+    if (!batch_out)
+       return -1;
+    batch_out_used = 0;
+    batch_out_failed = false;
+    setvbuf (in, NULL, _IOFBF, STUDENT_BATCH_OUT);
+    while (fgets (line, sizeof (line), in))
+    {
+        ++line_num;
+        len = strlen (line);
+        reason = NULL;
+        if (len == sizeof (line) - 1 && line[len - 1] != '\n')
+        {
+            // drop the rest of an over long line
+            while ((ch = getc (in)) != EOF && ch != '\n')
+               ;
+            reason = "line too long";
+        }
+        else
+        {
+            while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+               line[--len] = NULL_CHAR;
+            len = strspn (line, " \t");
+            if (line[len] == NULL_CHAR || line[len] == '#')
+               continue;
+            reason = batchCmd (list, line + len);
+        }
+        ++num_cmds;
+        if (reason)
+        {
+            ++*failed;
+            if (batch_out_used + STUDENT_BATCH_OUT_LINE > STUDENT_BATCH_OUT)
+               batchFlush ();
+            batch_out_used += snprintf (batch_out + batch_out_used, STUDENT_BATCH_OUT_LINE, "ERR line %ld: %s\n", line_num, reason);
+        }
+    }
+    if (ferror (in))
+       fprintf(stderr, "\n ERR: read error after line %ld", line_num);
+    batchFlush ();
+    free (batch_out);
+    batch_out = NULL;
+    if(trace_flag)
+       printf("\n TRACE[142.01]: %ld lines, %ld commands, %ld failed", line_num, num_cmds, *failed);
+    return (batch_out_failed ? -1 : num_cmds);
+}
+
+/*******************************************************************
+ Function Name  : batchCmd
+ Description    : Runs one batch command.
+ Pre            : line is a command line with no leading blanks or newline
+ Post           : Return null, or why the command failed
+ Remarks        : an added student is checked as an imported row is (parseStuRow);
+                  its name is everything between the id and the gpa
+ Func ID        : 143
+*******************************************************************/
+const char* batchCmd (BST_TREE* list, char* line)
+{
+    char *fields[3], *end, *args;
+    const char* reason;
+    STUDENT* stuPtr;
+    int id;
+
+    end = line + strlen (line);
+    while (end > line && (end[-1] == ' ' || end[-1] == '\t'))
+       *--end = NULL_CHAR;
+    if (line[1] != NULL_CHAR && line[1] != ' ' && line[1] != '\t')
+       return "unknown command";
+    args = line + 1 + strspn (line + 1, " \t");
+    switch (toupper (line[0]))
+    {
+        case 'A':
+           fields[0] = args;
+           args += strcspn (args, " \t");
+           fields[2] = end;
+           while (fields[2] > args && fields[2][-1] != ' ' && fields[2][-1] != '\t')
+              --fields[2];
+           if (*args == NULL_CHAR || fields[2] == args)
+              return "expected A id name gpa";
+           *args++ = NULL_CHAR;
+           fields[1] = args + strspn (args, " \t");
+           if (fields[1] == fields[2])
+              return "expected A id name gpa";
+           for (end = fields[2]; end > fields[1] && (end[-1] == ' ' || end[-1] == '\t'); --end)
+              ;
+           *end = NULL_CHAR;
+           stuPtr = (STUDENT*) BST_Alloc_Data (list, sizeof (STUDENT));
+           if (!stuPtr)
+              return "memory overflow";
+           memset (stuPtr, 0, sizeof (STUDENT));
+           reason = parseStuRow (fields, 3, stuPtr);
+           if (!reason && BST_Retrieve (list, stuPtr))
+              reason = "student id already exists";
+           if (!reason && !BST_Insert (list, stuPtr))
+              reason = "memory overflow";
+           if (reason)
+              BST_Free_Data (list, stuPtr);
+           return reason;
+        case 'D':
+        case 'F':
+           if (Str_to_Num_Range (&id, args, end - args, MIN_STUDENT_ID, MAX_STUDENT_ID) != SUCCESS)
+              return "invalid student id";
+           if (toupper (line[0]) == 'D')
+              return (BST_Delete (list, &id) ? NULL : "no such student");
+           stuPtr = (STUDENT*) BST_Retrieve (list, &id);
+           if (!stuPtr)
+              return "no such student";
+           batchPutStu (stuPtr);
+           return NULL;
+        case 'P':
+           if (*args != NULL_CHAR)
+              return "P takes no arguments";
+           BST_Traverse (list, batchPutStu);
+           return NULL;
+    }
+    return "unknown command";
+}
+
+/*******************************************************************
+ Function Name  : batchPutStu
+ Description    : Appends one student's line to the batch output.
+ Pre            : stuPtr is a pointer to a student; batch_out is allocated
+ Post           : "id name gpa" line appended, as processStu prints it
+ Remarks        : formats by hand instead of through printf. gpa * 10 is exact in
+                  a double (a float has 24 bits, 10 has 4), so rounding it half to
+                  even gives the digit "%4.1f" prints. Ids outside 0..9999 and
+                  gpas outside [0, 1000) take snprintf
+ Func ID        : 144
+*******************************************************************/
+void batchPutStu (void* stuPtr)
+{
+    const STUDENT* stu = (const STUDENT*)stuPtr;
+    char *out, gpa_str[8];
+    double tenths;
+    long whole;
+    size_t len, pos;
+
+    if (batch_out_used + STUDENT_BATCH_OUT_LINE > STUDENT_BATCH_OUT)
+       batchFlush ();
+    out = batch_out + batch_out_used;
+    len = strlen (stu->name);
+    if (stu->id < 0 || stu->id > 9999 || !(stu->gpa >= 0.0f && stu->gpa < 1000.0f) || signbit (stu->gpa) || len > 20)
+    {
+        batch_out_used += snprintf (out, STUDENT_BATCH_OUT_LINE, "%04d %-20s %4.1f\n", stu->id, stu->name, stu->gpa);
+        return;
+    }
+    out[0] = (char)('0' + stu->id / 1000);
+    out[1] = (char)('0' + stu->id / 100 % 10);
+    out[2] = (char)('0' + stu->id / 10 % 10);
+    out[3] = (char)('0' + stu->id % 10);
+    out[4] = ' ';
+    memcpy (out + 5, stu->name, len);
+    memset (out + 5 + len, ' ', 21 - len);
+    out += 26;
+    tenths = (double)stu->gpa * 10.0;
+    whole = (long)tenths;
+    if (tenths - whole > 0.5 || (tenths - whole == 0.5 && (whole & 1)))
+       ++whole;
+    // right to left: newline, tenths, point, whole part, then pad to width 4
+    pos = sizeof (gpa_str);
+    gpa_str[--pos] = '\n';
+    gpa_str[--pos] = (char)('0' + whole % 10);
+    gpa_str[--pos] = '.';
+    whole /= 10;
+    do
+    {
+        gpa_str[--pos] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (pos > sizeof (gpa_str) - 5)
+       gpa_str[--pos] = ' ';
+    memcpy (out, gpa_str + pos, sizeof (gpa_str) - pos);
+    batch_out_used = (size_t)(out - batch_out) + sizeof (gpa_str) - pos;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : batchFlush
+ Description    : Writes the batch output buffer to stdout.
+ Pre            : batch_out is allocated
+ Post           : Return true, or false once a write has failed
+ Remarks        :
+ Func ID        : 145
+*******************************************************************/
+bool batchFlush (void)
+{
+    if (batch_out_used > 0 && fwrite (batch_out, batch_out_used, 1, stdout) != 1)
+       batch_out_failed = true;
+    batch_out_used = 0;
+    if (fflush (stdout) != 0)
+       batch_out_failed = true;
+    return !batch_out_failed;
+}
+
+/*******************************************************************
+ Function Name  : findStu
+ Description    : Finds a student and prints name and gpa.
+ Pre            : student id
+ Post           : student data printed or error message
+ Remarks        :
+ Func ID        : 19
+*******************************************************************/
+void findStu (BST_TREE* list)
+{
+    int id;
+    STUDENT* stuPtr;
+
+    printf("\n Enter student id: ");
+    if((Get_Validate_Input_Number(&id, temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+    {
+		printf("\n ERR: Invalid student ID");
+		return;
+    }
+    stuPtr = (STUDENT*)BST_Retrieve (list, &id);
+    if (stuPtr)
+    {
+        printf("\n Student id: %04d", id);
+        printf("\n Student name: %s", stuPtr->name);
+        printf("\n Student gpa: %4.1f", stuPtr->gpa);
+    }
+    else
+       printf("Student %d not in list\n", id);
+}
+/*******************************************************************
+ Function Name  : printList
+ Description    : Prints a list of students.
+ Pre            : list has been created (may be null)
+ Post           : students printed
+ Remarks        :
+ Func ID        : 20
+*******************************************************************/
+void printList (BST_TREE* list)
+{
+    printf("\nStudent List:");
+	printf("\n======================");
+    BST_Traverse (list, processStu);
+	printf("\n =====================");
+    printf("\nEnd of Student List\n");
+    return;
+}
+/*******************************************************************
+ Function Name  : printRange
+ Description    : Prints students whose ids fall in a range.
+ Pre            : list has been created (may be null)
+ Post           : students with low id <= id <= high id printed
+ Remarks        : uses a range cursor, so only the students in range are visited
+ Func ID        : 57
+*******************************************************************/
+void printRange (BST_TREE* list)
+{
+    BST_CURSOR* cursor;
+    STUDENT* stuPtr;
+    int lo_id, hi_id;
+
+    printf("Enter low student id: ");
+    if((Get_Validate_Input_Number(&lo_id, temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid student ID");
+        return;
+    }
+    printf("Enter high student id: ");
+    if((Get_Validate_Input_Number(&hi_id, temp_str, STR_MAX_NUM_CHARS, lo_id, MAX_STUDENT_ID)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid student ID");
+        return;
+    }
+    cursor = BST_Cursor_Create (list);
+    if (!cursor)
+    {
+        printf("\n ERR: Memory Overflow in range");
+        return;
+    }
+    // range end is exclusive
+    ++hi_id;
+    printf("\nStudent List [%04d - %04d]:", lo_id, hi_id - 1);
+    printf("\n======================");
+    for (stuPtr = (STUDENT*)BST_Cursor_Range (cursor, &lo_id, &hi_id); stuPtr; stuPtr = (STUDENT*)BST_Cursor_Next (cursor))
+        processStu (stuPtr);
+    printf("\n =====================");
+    printf("\nEnd of Student List\n");
+    BST_Cursor_Destroy (cursor);
+    return;
+}
+/*******************************************************************
+ Function Name  : printPage
+ Description    : Prints one page of the class list.
+ Pre            : list has been created with BST_MODE_ORDER_STAT
+ Post           : students of the requested page printed
+ Remarks        : pages hold STUDENT_PAGE_SIZE students; the page start is found by rank
+ Func ID        : 62
+*******************************************************************/
+void printPage (BST_TREE* list)
+{
+    BST_CURSOR* cursor;
+    STUDENT* stuPtr;
+    int page, num_pages, i;
+
+    num_pages = (BST_Count (list) + STUDENT_PAGE_SIZE - 1) / STUDENT_PAGE_SIZE;
+    if (num_pages == 0)
+    {
+        printf("\n Class list is empty");
+        return;
+    }
+    printf("Enter page number [1 - %d]: ", num_pages);
+    if((Get_Validate_Input_Number(&page, temp_str, STR_MAX_NUM_CHARS, 1, num_pages)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid page number");
+        return;
+    }
+    cursor = BST_Cursor_Create (list);
+    if (!cursor)
+    {
+        printf("\n ERR: Memory Overflow in page");
+        return;
+    }
+    printf("\nStudent List page %d of %d:", page, num_pages);
+    printf("\n======================");
+    stuPtr = (STUDENT*)BST_Cursor_Select (cursor, (page - 1) * STUDENT_PAGE_SIZE);
+    for (i = 0; stuPtr && i < STUDENT_PAGE_SIZE; ++i, stuPtr = (STUDENT*)BST_Cursor_Next (cursor))
+        processStu (stuPtr);
+    printf("\n =====================");
+    printf("\nEnd of page\n");
+    BST_Cursor_Destroy (cursor);
+    return;
+}
+/*******************************************************************
+ Function Name  : printTopStu
+ Description    : Prints the students with the highest gpa.
+ Pre            : list has the gpa index STUDENT_GPA_INDEX
+ Post           : up to the requested number of students printed, best gpa first
+ Remarks        : walks the gpa index back from its last key, so k students cost O(log n + k)
+ Func ID        : 68
+*******************************************************************/
+void printTopStu (BST_TREE* list)
+{
+    BST_CURSOR* cursor;
+    STUDENT* stuPtr;
+    int num_stu, i;
+
+    if (BST_Empty (list))
+    {
+        printf("\n Class list is empty");
+        return;
+    }
+    printf("Enter number of students [1 - %d]: ", BST_Count (list));
+    if((Get_Validate_Input_Number(&num_stu, temp_str, STR_MAX_NUM_CHARS, 1, BST_Count (list))) != SUCCESS)
+    {
+        printf("\n ERR: Invalid number of students");
+        return;
+    }
+    cursor = BST_Cursor_Create (BST_Get_Index (list, STUDENT_GPA_INDEX));
+    if (!cursor)
+    {
+        printf("\n ERR: Memory Overflow in top students");
+        return;
+    }
+    printf("\nTop %d Students:", num_stu);
+    printf("\n======================");
+    stuPtr = (STUDENT*)BST_Cursor_Last (cursor);
+    for (i = 0; stuPtr && i < num_stu; ++i, stuPtr = (STUDENT*)BST_Cursor_Prev (cursor))
+        processStu (stuPtr);
+    printf("\n =====================");
+    printf("\nEnd of Student List\n");
+    BST_Cursor_Destroy (cursor);
+    return;
+}
+/*******************************************************************
+ Function Name  : printBelowGpa
+ Description    : Prints the students whose gpa is below a threshold.
+ Pre            : list has the gpa index STUDENT_GPA_INDEX
+ Post           : students with gpa < threshold printed, lowest gpa first
+ Remarks        : range scan of the gpa index up to (threshold, id below MIN_STUDENT_ID)
+ Func ID        : 69
+*******************************************************************/
+void printBelowGpa (BST_TREE* list)
+{
+    BST_CURSOR* cursor;
+    STUDENT* stuPtr;
+    STUDENT hiStu;
+
+    printf("Enter gpa threshold: ");
+    if((Get_Validate_Input_Float(&hiStu.gpa, temp_str, STR_MAX_NUM_CHARS, STUDENT_MIN_GRADE, STUDENT_MAX_GRADE)) != SUCCESS)
+    {
+        printf("\n ERR: Invalid grade");
+        return;
+    }
+    // sorts before every student with this gpa, so the exclusive range end drops them
+    hiStu.id = MIN_STUDENT_ID - 1;
+    cursor = BST_Cursor_Create (BST_Get_Index (list, STUDENT_GPA_INDEX));
+    if (!cursor)
+    {
+        printf("\n ERR: Memory Overflow in gpa range");
+        return;
+    }
+    printf("\nStudents below gpa %f:", hiStu.gpa);
+    printf("\n======================");
+    for (stuPtr = (STUDENT*)BST_Cursor_Range (cursor, NULL, &hiStu); stuPtr; stuPtr = (STUDENT*)BST_Cursor_Next (cursor))
+        processStu (stuPtr);
+    printf("\n =====================");
+    printf("\nEnd of Student List\n");
+    BST_Cursor_Destroy (cursor);
+    return;
+}
+/*******************************************************************
+ Function Name  : printStats
+ Description    : Prints the class size, gpa average and range, and a gpa histogram.
+ Pre            : list has been created
+ Post           : statistics printed
+ Remarks        : one full scan, spread over every core by BST_ParallelReduce
+ Func ID        : 192
+*******************************************************************/
+void printStats (BST_TREE* list)
+{
+    STUDENT_STATS stats;
+    double width = (STUDENT_MAX_GRADE - STUDENT_MIN_GRADE) / STUDENT_STATS_BUCKETS;
+    int i;
+
+    memset (&stats, 0, sizeof (stats));
+    stats.min_gpa = STUDENT_MAX_GRADE;
+    stats.max_gpa = STUDENT_MIN_GRADE;
+    if (!BST_ParallelReduce (list, mapStuStats, combineStuStats, &stats, sizeof (stats), 0))
+    {
+        printf("\n ERR: Memory Overflow in statistics");
+        return;
+    }
+    printf("\nGpa Statistics:");
+    printf("\n===============");
+    printf("\n Students: %ld", stats.count);
+    if (stats.count > 0)
+    {
+        printf("\n Average gpa: %5.1f, lowest: %5.1f, highest: %5.1f",
+               stats.gpa_sum / stats.count, stats.min_gpa, stats.max_gpa);
+        for (i = 0; i < STUDENT_STATS_BUCKETS; ++i)
+            printf("\n %5.1f - %5.1f: %ld", STUDENT_MIN_GRADE + i * width,
+                   STUDENT_MIN_GRADE + (i + 1) * width, stats.buckets[i]);
+    }
+    printf("\n ===============\n");
+    return;
+}
+
+/*******************************************************************
+ Function Name  : mapStuStats
+ Description    : map of printStats: adds a student to the statistics.
+ Pre            : acc is pointer to a STUDENT_STATS, dataPtr to a student
+ Post           : student counted
+ Remarks        : the top gpa falls in the last bucket
+ Func ID        : 193
+*******************************************************************/
+void mapStuStats (void* acc, void* dataPtr)
+{
+    STUDENT_STATS* stats = (STUDENT_STATS*) acc;
+    STUDENT* stuPtr = (STUDENT*) dataPtr;
+    int bucket;
+
+    ++stats->count;
+    stats->gpa_sum += stuPtr->gpa;
+    stats->min_gpa = stuPtr->gpa < stats->min_gpa ? stuPtr->gpa : stats->min_gpa;
+    stats->max_gpa = stuPtr->gpa > stats->max_gpa ? stuPtr->gpa : stats->max_gpa;
+    bucket = (int)((stuPtr->gpa - STUDENT_MIN_GRADE) * STUDENT_STATS_BUCKETS / (STUDENT_MAX_GRADE - STUDENT_MIN_GRADE));
+    bucket = bucket < 0 ? 0 : (bucket >= STUDENT_STATS_BUCKETS ? STUDENT_STATS_BUCKETS - 1 : bucket);
+    ++stats->buckets[bucket];
+    return;
+}
+
+/*******************************************************************
+ Function Name  : combineStuStats
+ Description    : combine of printStats: adds the statistics of other to acc.
+ Pre            : acc and other are pointers to STUDENT_STATS
+ Post           : acc covers the students of both
+ Remarks        :
+ Func ID        : 194
+*******************************************************************/
+void combineStuStats (void* acc, void* other)
+{
+    STUDENT_STATS* stats = (STUDENT_STATS*) acc;
+    STUDENT_STATS* part = (STUDENT_STATS*) other;
+    int i;
+
+    stats->count += part->count;
+    stats->gpa_sum += part->gpa_sum;
+    stats->min_gpa = part->min_gpa < stats->min_gpa ? part->min_gpa : stats->min_gpa;
+    stats->max_gpa = part->max_gpa > stats->max_gpa ? part->max_gpa : stats->max_gpa;
+    for (i = 0; i < STUDENT_STATS_BUCKETS; ++i)
+        stats->buckets[i] += part->buckets[i];
+    return;
+}
+/*******************************************************************
+ Function Name  : testUtilties
+ Description    : tests the ADT utilities by calling
+                  each in turn and printing the results.
+ Pre            : tree has been created
+ Post           : results printed
+ Remarks        :
+ Func ID        : 21
+*******************************************************************/
+void testUtilties (BST_TREE* tree)
+{
+     printf("\n Tree contains %3d nodes: ", BST_Count(tree));
+     if (BST_Empty(tree))
+        printf("\n The tree IS empty");
+     else
+        printf("\n The tree IS NOT empty");
+     if (BST_Full(tree))
+        printf("\n The tree IS full\a");
+     else
+        printf("\n The tree IS NOT full");
+     return;
+}
+/*******************************************************************
+ Function Name  : benchEngines
+ Description    : Times the binary (AVL), B+ and dense engines and the BST_DEFINE tree
+                  Stu on n = 10^3 .. max_count random integer keys and prints one
+                  line per engine and n.
+ Pre            : built with -DBST_BENCHMARK=max_count (and -O2 -mavx2 for the SIMD search)
+ Post           : Return 0, or 100 on memory overflow
+ Remarks        : insert and lookup run in two different random orders, so lookups miss
+                  the cache as a real workload would; traverse is the in order walk.
+                  The records are bare student ids and the trees are BST_MODE_INDEX,
+                  so destroying them frees nothing. 10^8 keys need about 5 GB.
+                  The dense engine gets the domain 0 .. n-1, every key of which is used
+ Func ID        : 115
+*******************************************************************/
+int benchEngines (int max_count)
+{
+    static const uint8_t modes[] = { BST_MODE_AVL | BST_MODE_INLINE_KEY, BST_MODE_BPLUS | BST_MODE_INLINE_KEY, BST_MODE_INLINE_KEY };
+    static const char* names[] = { "AVL", "B+", "dense" };
+    BST_TREE* tree;
+    Stu_TREE* stu;
+    int *ids, *order;
+    long n;
+    int i, j, m, tmp;
+    unsigned int seed = 12345;
+    clock_t start;
+    double insert_ns, lookup_ns, traverse_ns;
+
+    printf("\n %10s %6s %12s %12s %12s", "n", "engine", "insert ns", "lookup ns", "traverse ns");
+    for (n = 1000; n <= max_count; n *= 10)
+    {
+        ids = (int*) malloc (n * sizeof (int));
+        order = (int*) malloc (n * sizeof (int));
+        if (!ids || !order)
+        {
+            printf("\n ERR: Memory Overflow in benchmark");
+            return 100;
+        }
+        for (i = 0; i < n; ++i)
+            ids[i] = order[i] = i;
+        for (i = (int)n - 1; i > 0; --i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            j = (int)(((uint64_t)seed * (uint64_t)(i + 1)) >> 32);
+            tmp = ids[i]; ids[i] = ids[j]; ids[j] = tmp;
+            seed = seed * 1103515245u + 12345u;
+            j = (int)(((uint64_t)seed * (uint64_t)(i + 1)) >> 32);
+            tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+        }
+        for (m = 0; m < 3; ++m)
+        {
+            if (m == 2)
+               tree = BST_Create_Dense (compareStu, getStuKey, modes[m] | BST_MODE_INDEX, 0, (int)n - 1, (int)n);
+            else
+               tree = BST_Create_Key (compareStu, getStuKey, modes[m] | BST_MODE_INDEX);
+            if (!tree)
+               return 100;
+            start = clock();
+            for (i = 0; i < n; ++i)
+            {
+                if (!BST_Insert (tree, &ids[i]))
+                {
+                    printf("\n ERR: Memory Overflow in benchmark");
+                    return 100;
+                }
+            }
+            insert_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+            start = clock();
+            for (i = 0; i < n; ++i)
+            {
+                if (!BST_Retrieve (tree, &order[i]))
+                   printf("\n ERR: key %d not found", order[i]);
+            }
+            lookup_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+            start = clock();
+            BST_Traverse (tree, benchVisit);
+            traverse_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+            printf("\n %10ld %6s %12.1f %12.1f %12.1f", n, names[m], insert_ns, lookup_ns, traverse_ns);
+            tree = BST_Destroy (tree);
+        }
+        // the same walk over the specialised tree: compares inline, no getKey
+        stu = Stu_Create ();
+        if (!stu)
+           return 100;
+        start = clock();
+        for (i = 0; i < n; ++i)
+        {
+            if (!Stu_Insert (stu, ids[i], &ids[i]))
+            {
+                printf("\n ERR: Memory Overflow in benchmark");
+                return 100;
+            }
+        }
+        insert_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+        start = clock();
+        for (i = 0; i < n; ++i)
+        {
+            if (!Stu_Retrieve (stu, order[i]))
+               printf("\n ERR: key %d not found", order[i]);
+        }
+        lookup_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+        start = clock();
+        Stu_Traverse (stu, benchVisit);
+        traverse_ns = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / n;
+        printf("\n %10ld %6s %12.1f %12.1f %12.1f", n, "Stu", insert_ns, lookup_ns, traverse_ns);
+        stu = Stu_Destroy (stu);
+        free (ids);
+        free (order);
+    }
+    printf("\n checksum: %ld\n", bench_sum);
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : benchVisit
+ Description    : traverse process of benchEngines: sums the ids visited.
+ Pre            : dataPtr is pointer to a student id
+ Post           : id added to bench_sum
+ Remarks        : the sum is printed so the walk cannot be optimised away
+ Func ID        : 116
+*******************************************************************/
+void benchVisit (void* dataPtr)
+{
+    bench_sum += *(int*)dataPtr;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : benchParsers
+ Description    : Times Str_to_Num_Conv against Str_to_Num_Range and strtof against
+                  Str_to_Float_Range on the same random id and gpa strings, and
+                  counts the strings on which old and new disagree.
+ Pre            : built with -DBST_BENCHMARK=count; count parses are timed per parser
+ Post           : Return 0, or 100 on memory overflow
+ Remarks        : the gpa strings carry 0 to 7 decimals, so both float fast paths and
+                  the strtof fallback are exercised; a float mismatch is any bit difference.
+ Func ID        : 141
+*******************************************************************/
+int benchParsers (int count)
+{
+    static const char* names[] = { "Str_to_Num_Conv", "Str_to_Num_Range", "strtof", "Str_to_Float_Range" };
+    char (*id_strs)[STR_MAX_NUM_CHARS];
+    char (*gpa_strs)[PARSE_MAX_CHARS];
+    size_t *id_lens, *gpa_lens;
+    int32_t id, old_id;
+    float gpa, old_gpa;
+    long mismatches;
+    int i, p, reps, rep;
+    unsigned int seed = 12345;
+    clock_t start;
+
+    id_strs = malloc (PARSE_BENCH_STRS * sizeof (*id_strs));
+    gpa_strs = malloc (PARSE_BENCH_STRS * sizeof (*gpa_strs));
+    id_lens = (size_t*) malloc (PARSE_BENCH_STRS * sizeof (size_t));
+    gpa_lens = (size_t*) malloc (PARSE_BENCH_STRS * sizeof (size_t));
+    if (!id_strs || !gpa_strs || !id_lens || !gpa_lens)
+    {
+        printf("\n ERR: Memory Overflow in benchmark");
+        return 100;
+    }
+    for (i = 0; i < PARSE_BENCH_STRS; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        id_lens[i] = (size_t) sprintf (id_strs[i], "%d", MIN_STUDENT_ID + (int)(seed >> 8) % (MAX_STUDENT_ID - MIN_STUDENT_ID + 1));
+        seed = seed * 1103515245u + 12345u;
+        gpa_lens[i] = (size_t) sprintf (gpa_strs[i], "%.*f", i % 8, STUDENT_MAX_GRADE * (double)(seed >> 8) / (double)(1u << 24));
+    }
+    reps = count / PARSE_BENCH_STRS > 0 ? count / PARSE_BENCH_STRS : 1;
+
+    printf("\n %-20s %12s %12s", "parser", "ns/parse", "mismatches");
+    for (p = 0; p < 4; ++p)
+    {
+        mismatches = 0;
+        start = clock();
+        for (rep = 0; rep < reps; ++rep)
+        {
+            for (i = 0; i < PARSE_BENCH_STRS; ++i)
+            {
+                switch (p)
+                {
+                    case 0:
+                       if (Str_to_Num_Conv (&id, id_strs[i]) == SUCCESS && id >= MIN_STUDENT_ID && id <= MAX_STUDENT_ID)
+                          bench_sum += id;
+                       break;
+                    case 1:
+                       if (Str_to_Num_Range (&id, id_strs[i], id_lens[i], MIN_STUDENT_ID, MAX_STUDENT_ID) == SUCCESS)
+                          bench_sum += id;
+                       break;
+                    case 2:
+                       gpa = strtof (gpa_strs[i], NULL);
+                       if (gpa >= STUDENT_MIN_GRADE && gpa <= STUDENT_MAX_GRADE)
+                          bench_sum += (long)gpa;
+                       break;
+                    default:
+                       if (Str_to_Float_Range (&gpa, gpa_strs[i], gpa_lens[i], STUDENT_MIN_GRADE, STUDENT_MAX_GRADE) == SUCCESS)
+                          bench_sum += (long)gpa;
+                       break;
+                }
+            }
+        }
+        if (p == 1 || p == 3)
+        {
+            for (i = 0; i < PARSE_BENCH_STRS; ++i)
+            {
+                if (p == 1)
+                   mismatches += Str_to_Num_Conv (&old_id, id_strs[i]) != SUCCESS
+                                 || Str_to_Num_Range (&id, id_strs[i], id_lens[i], MIN_STUDENT_ID, MAX_STUDENT_ID) != SUCCESS
+                                 || id != old_id;
+                else
+                {
+                    old_gpa = strtof (gpa_strs[i], NULL);
+                    mismatches += Str_to_Float_Range (&gpa, gpa_strs[i], gpa_lens[i], STUDENT_MIN_GRADE, STUDENT_MAX_GRADE) != SUCCESS
+                                  || memcmp (&gpa, &old_gpa, sizeof (float)) != 0;
+                }
+            }
+            printf("\n %-20s %12.1f %12ld", names[p],
+                   (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)reps * PARSE_BENCH_STRS), mismatches);
+        }
+        else
+            printf("\n %-20s %12.1f", names[p], (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / ((double)reps * PARSE_BENCH_STRS));
+    }
+    free (id_strs);
+    free (gpa_strs);
+    free (id_lens);
+    free (gpa_lens);
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : benchReaders
+ Description    : Times lookups of 1 to BST_BENCH_READERS reader threads on a
+                  BST_MODE_CONCURRENT tree of max_count keys while the main thread
+                  deletes and reinserts keys, and prints the lookups and changes per second.
+ Pre            : built with -DBST_BENCHMARK=max_count
+ Post           : Return 0, or 100 on memory overflow or if a thread cannot start
+ Remarks        : wall clock time, as clock() adds up the threads' cpu time. Every
+                  reader does BST_BENCH_READER_LOOKUPS lookups; a key being reinserted
+                  may be missed, so found is a little below the lookups.
+ Func ID        : 159
+*******************************************************************/
+int benchReaders (int max_count)
+{
+    BENCH_READER readers[BST_BENCH_READERS];
+    thrd_t threads[BST_BENCH_READERS];
+    BST_TREE* tree;
+    struct timespec start, stop;
+    int* ids;
+    int i, n, num_threads;
+    long changes, found;
+    double secs;
+
+    ids = (int*) malloc ((size_t)max_count * sizeof (int));
+    tree = BST_Create_Key (compareStu, getStuKey, BST_MODE_AVL | BST_MODE_INLINE_KEY | BST_MODE_INDEX | BST_MODE_CONCURRENT);
+    if (!ids || !tree)
+    {
+        printf("\n ERR: Memory Overflow in benchmark");
+        return 100;
+    }
+    for (i = 0; i < max_count; ++i)
+    {
+        ids[i] = i;
+        if (!BST_Insert (tree, &ids[i]))
+        {
+            printf("\n ERR: Memory Overflow in benchmark");
+            return 100;
+        }
+    }
+    printf("\n %8s %14s %14s %12s", "readers", "lookups/s", "changes/s", "found");
+    for (num_threads = 1; num_threads <= BST_BENCH_READERS; num_threads *= 2)
+    {
+        changes = 0;
+        found = 0;
+        atomic_store (&bench_readers_left, num_threads);
+        timespec_get (&start, TIME_UTC);
+        for (i = 0; i < num_threads; ++i)
+        {
+            readers[i].tree = tree;
+            readers[i].ids = ids;
+            readers[i].count = max_count;
+            readers[i].seed = 12345u + (unsigned int)i;
+            readers[i].found = 0;
+            if (thrd_create (&threads[i], benchReader, &readers[i]) != thrd_success)
+            {
+                printf("\n ERR: cannot start reader %d", i);
+                return 100;
+            }
+        }
+        // the writer: take a key out and put it back until the readers are done
+        for (n = 0; atomic_load (&bench_readers_left) > 0; n = (n + 1) % max_count)
+        {
+            if (!BST_Delete (tree, &ids[n]) || !BST_Insert (tree, &ids[n]))
+            {
+                printf("\n ERR: key %d lost in benchmark", n);
+                return 100;
+            }
+            changes += 2;
+        }
+        for (i = 0; i < num_threads; ++i)
+        {
+            thrd_join (threads[i], NULL);
+            found += readers[i].found;
+        }
+        timespec_get (&stop, TIME_UTC);
+        secs = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("\n %8d %14.0f %14.0f %12ld", num_threads,
+               (double)num_threads * BST_BENCH_READER_LOOKUPS / secs, (double)changes / secs, found);
+    }
+    BST_Destroy (tree);
+    free (ids);
+    printf("\n");
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : benchReader
+ Description    : reader thread of benchReaders: looks up random keys.
+ Pre            : arg is pointer to a BENCH_READER
+ Post           : found keys counted in the BENCH_READER. Return 0
+ Remarks        :
+ Func ID        : 160
+*******************************************************************/
+int benchReader (void* arg)
+{
+    BENCH_READER* reader = (BENCH_READER*) arg;
+    int i, key;
+
+    for (i = 0; i < BST_BENCH_READER_LOOKUPS; ++i)
+    {
+        reader->seed = reader->seed * 1103515245u + 12345u;
+        key = (int)(((uint64_t)reader->seed * (uint64_t)reader->count) >> 32);
+        if (BST_Retrieve (reader->tree, &reader->ids[key]))
+           ++reader->found;
+    }
+    atomic_fetch_sub (&bench_readers_left, 1);
+    return 0;
+}
+
+/*******************************************************************
+ Function Name  : benchWriters
+ Description    : Times 1 to BST_BENCH_READERS threads inserting, deleting and looking
+                  up random keys at once in a concurrent AVL tree (one writer at a time),
+                  in the lock-free engine and in BST_BENCH_SHARDS concurrent AVL shards
+                  (one writer per shard), then checks each tree is consistent.
+ Pre            : built with -DBST_BENCHMARK=max_count; keys are drawn from 0 .. 2 max_count
+ Post           : Return 0, or 100 on memory overflow, if a thread cannot start or a tree
+                  is found inconsistent
+ Remarks        : each thread does BST_BENCH_WRITER_OPS operations, a quarter inserts,
+                  a quarter deletes. The tree starts half full, loaded in random order
+                  as the lock-free engine does not rebalance. The shards are split at
+                  a sample of the loaded keys. After the run, BST_Count and the sum of
+                  the keys a traverse visits must match the successful inserts and deletes.
+ Func ID        : 180
+*******************************************************************/
+int benchWriters (int max_count)
+{
+    static const uint8_t modes[] = { BST_MODE_AVL | BST_MODE_CONCURRENT, BST_MODE_CONCURRENT, BST_MODE_AVL };
+    static const char* names[] = { "AVL", "lock-free", "sharded" };
+    BENCH_WRITER writers[BST_BENCH_READERS];
+    thrd_t threads[BST_BENCH_READERS];
+    BST_TREE* tree;
+    struct timespec start, stop;
+    int *ids, *order;
+    int sample[BST_BENCH_SHARDS * 64], splits[BST_BENCH_SHARDS - 1];
+    int i, j, m, tmp, num_threads, num_shards, num_samples, range = 2 * max_count;
+    long expected, key_sum;
+    unsigned int seed = 12345;
+    double secs;
+
+    ids = (int*) malloc ((size_t)range * sizeof (int));
+    order = (int*) malloc ((size_t)range * sizeof (int));
+    if (!ids || !order)
+    {
+        printf("\n ERR: Memory Overflow in benchmark");
+        return 100;
+    }
+    for (i = 0; i < range; ++i)
+        ids[i] = order[i] = i;
+    for (i = range - 1; i > 0; --i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        j = (int)(((uint64_t)seed * (uint64_t)(i + 1)) >> 32);
+        tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+    // the loaded keys are order[0 .. max_count), already shuffled
+    num_samples = max_count < BST_BENCH_SHARDS * 64 ? max_count : BST_BENCH_SHARDS * 64;
+    memcpy (sample, order, (size_t)num_samples * sizeof (int));
+    num_shards = BST_Shard_Splits (sample, num_samples, BST_BENCH_SHARDS, splits);
+    printf("\n %10s %8s %14s %12s", "engine", "threads", "ops/s", "count");
+    for (m = 0; m < 3; ++m)
+    {
+        for (num_threads = 1; num_threads <= BST_BENCH_READERS; num_threads *= 2)
+        {
+            if (m == 2)
+               tree = BST_Create_Sharded (compareStu, getStuKey, modes[m] | BST_MODE_INLINE_KEY | BST_MODE_INDEX, num_shards, splits);
+            else
+               tree = BST_Create_Key (compareStu, getStuKey, modes[m] | BST_MODE_INLINE_KEY | BST_MODE_INDEX);
+            if (!tree)
+               return 100;
+            for (i = 0; i < max_count; ++i)
+            {
+                if (!BST_Insert (tree, &ids[order[i]]))
+                {
+                    printf("\n ERR: Memory Overflow in benchmark");
+                    return 100;
+                }
+            }
+            expected = max_count;
+            for (key_sum = 0, i = 0; i < max_count; ++i)
+                key_sum += order[i];
+            timespec_get (&start, TIME_UTC);
+            for (i = 0; i < num_threads; ++i)
+            {
+                writers[i].tree = tree;
+                writers[i].ids = ids;
+                writers[i].count = range;
+                writers[i].seed = 777u + (unsigned int)i;
+                writers[i].changes = 0;
+                writers[i].key_sum = 0;
+                writers[i].found = 0;
+                if (thrd_create (&threads[i], benchWriter, &writers[i]) != thrd_success)
+                {
+                    printf("\n ERR: cannot start writer %d", i);
+                    return 100;
+                }
+            }
+            for (i = 0; i < num_threads; ++i)
+            {
+                thrd_join (threads[i], NULL);
+                expected += writers[i].changes;
+                key_sum += writers[i].key_sum;
+            }
+            timespec_get (&stop, TIME_UTC);
+            secs = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / 1e9;
+            printf("\n %10s %8d %14.0f %12d", names[m], num_threads,
+                   (double)num_threads * BST_BENCH_WRITER_OPS / secs, BST_Count (tree));
+            bench_sum = 0;
+            BST_Traverse (tree, benchVisit);
+            if (BST_Count (tree) != expected || bench_sum != key_sum)
+            {
+                printf("\n ERR: count %d, %ld expected; key sum %ld, %ld expected", BST_Count (tree), expected, bench_sum, key_sum);
+                return 100;
+            }
+            tree = BST_Destroy (tree);
+        }
+    }
+    free (ids);
+    free (order);
+    printf("\n");
+    return 0;
 }
+
 /*******************************************************************
- Function Name  : deleteStu
- Description    : Deletes a student from the tree.
- Pre            :
- Post           : student deleted or error message printed
+ Function Name  : benchWriter
+ Description    : writer thread of benchWriters: inserts, deletes and looks up random keys.
+ Pre            : arg is pointer to a BENCH_WRITER
+ Post           : net inserts, the net sum of their keys and the keys found are in the
+                  BENCH_WRITER. Return 0
  Remarks        :
- Func ID        : 18
+ Func ID        : 181
 *******************************************************************/
-void deleteStu (BST_TREE* list)
+int benchWriter (void* arg)
 {
-   int id;
-   int* idPtr = &id;
+    BENCH_WRITER* writer = (BENCH_WRITER*) arg;
+    int i, key;
 
-   printf("Enter student id: ");
-   if((Get_Validate_Input_Number(idPtr, temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
-   {
-		printf("\n ERR: Invalid student ID");
-		return;
-   }
-   if (!BST_Delete (list, idPtr))
-      printf("\n ERROR: No Student: %d", *idPtr);
+    for (i = 0; i < BST_BENCH_WRITER_OPS; ++i)
+    {
+        writer->seed = writer->seed * 1103515245u + 12345u;
+        key = (int)(((uint64_t)writer->seed * (uint64_t)writer->count) >> 32);
+        switch ((writer->seed >> 16) & 3)
+        {
+            case 0:
+               if (BST_Insert (writer->tree, &writer->ids[key]))
+               {
+                   ++writer->changes;
+                   writer->key_sum += key;
+               }
+               break;
+            case 1:
+               if (BST_Delete (writer->tree, &writer->ids[key]))
+               {
+                   --writer->changes;
+                   writer->key_sum -= key;
+               }
+               break;
+            default:
+               writer->found += BST_Retrieve (writer->tree, &writer->ids[key]) != NULL;
+               break;
+        }
+    }
+    return 0;
 }
+
 /*******************************************************************
- Function Name  : findStu
- Description    : Finds a student and prints name and gpa.
- Pre            : student id
- Post           : student data printed or error message
- Remarks        :
- Func ID        : 19
+ Function Name  : benchParallel
+ Description    : Times a sum over every key by BST_Traverse and by BST_ParallelReduce
+                  on 1 to BST_BENCH_READERS threads, for the AVL and B+ engines.
+ Pre            : built with -DBST_BENCHMARK=max_count
+ Post           : Return 0, or 100 on memory overflow or if a parallel sum is wrong
+ Remarks        : wall clock time; each walk is repeated so it runs long enough to time
+ Func ID        : 195
 *******************************************************************/
-void findStu (BST_TREE* list)
+int benchParallel (int max_count)
 {
-    int id;
-    STUDENT* stuPtr;
+    static const uint8_t modes[] = { BST_MODE_AVL, BST_MODE_BPLUS };
+    static const char* names[] = { "AVL", "B+" };
+    BST_TREE* tree;
+    struct timespec start, stop;
+    int* ids;
+    int i, m, rep, num_threads, reps = 1 + 10000000 / max_count;
+    long sum, expected;
+    double secs;
 
-    printf("\n Enter student id: ");
-    if((Get_Validate_Input_Number(&id, temp_str, STR_MAX_NUM_CHARS, MIN_STUDENT_ID, MAX_STUDENT_ID)) != SUCCESS)
+    ids = (int*) malloc ((size_t)max_count * sizeof (int));
+    if (!ids)
     {
-		printf("\n ERR: Invalid student ID");
-		return;
+        printf("\n ERR: Memory Overflow in benchmark");
+        return 100;
     }
-    stuPtr = (STUDENT*)BST_Retrieve (list, &id);
-    if (stuPtr)
+    for (i = 0; i < max_count; ++i)
+        ids[i] = i;
+    expected = (long)max_count * (max_count - 1) / 2;
+    printf("\n %6s %8s %14s", "engine", "threads", "keys/s");
+    for (m = 0; m < 2; ++m)
     {
-        printf("\n Student id: %04d", id);
-        printf("\n Student name: %s", stuPtr->name);
-        printf("\n Student gpa: %4.1f", stuPtr->gpa);
+        tree = BST_Create_Key (compareStu, getStuKey, modes[m] | BST_MODE_INLINE_KEY | BST_MODE_INDEX);
+        if (!tree)
+           return 100;
+        for (i = 0; i < max_count; ++i)
+        {
+            if (!BST_Insert (tree, &ids[i]))
+            {
+                printf("\n ERR: Memory Overflow in benchmark");
+                return 100;
+            }
+        }
+        timespec_get (&start, TIME_UTC);
+        for (rep = 0; rep < reps; ++rep)
+        {
+            bench_sum = 0;
+            BST_Traverse (tree, benchVisit);
+        }
+        timespec_get (&stop, TIME_UTC);
+        secs = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / 1e9;
+        printf("\n %6s %8s %14.0f", names[m], "serial", (double)reps * max_count / secs);
+        for (num_threads = 1; num_threads <= BST_BENCH_READERS; num_threads *= 2)
+        {
+            timespec_get (&start, TIME_UTC);
+            for (rep = 0; rep < reps; ++rep)
+            {
+                sum = 0;
+                if (!BST_ParallelReduce (tree, benchSumMap, benchSumCombine, &sum, sizeof (sum), num_threads))
+                {
+                    printf("\n ERR: Memory Overflow in benchmark");
+                    return 100;
+                }
+                if (sum != expected)
+                {
+                    printf("\n ERR: sum %ld, %ld expected", sum, expected);
+                    return 100;
+                }
+            }
+            timespec_get (&stop, TIME_UTC);
+            secs = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / 1e9;
+            printf("\n %6s %8d %14.0f", names[m], num_threads, (double)reps * max_count / secs);
+        }
+        tree = BST_Destroy (tree);
     }
-    else
-       printf("Student %d not in list\n", id);
+    free (ids);
+    printf("\n");
+    return 0;
 }
+
 /*******************************************************************
- Function Name  : printList
- Description    : Prints a list of students.
- Pre            : list has been created (may be null)
- Post           : students printed
+ Function Name  : benchSumMap
+ Description    : map of benchParallel: adds a student id to a sum.
+ Pre            : acc is pointer to a long, dataPtr to a student id
+ Post           : id added
  Remarks        :
- Func ID        : 20
+ Func ID        : 196
 *******************************************************************/
-void printList (BST_TREE* list)
+void benchSumMap (void* acc, void* dataPtr)
 {
-    printf("\nStudent List:");
-	printf("\n======================");
-    BST_Traverse (list, processStu);
-	printf("\n =====================");
-    printf("\nEnd of Student List\n");
+    *(long*)acc += *(int*)dataPtr;
     return;
 }
+
 /*******************************************************************
- Function Name  : testUtilties
- Description    : tests the ADT utilities by calling
-                  each in turn and printing the results.
- Pre            : tree has been created
- Post           : results printed
+ Function Name  : benchSumCombine
+ Description    : combine of benchParallel: adds one sum to another.
+ Pre            : acc and other are pointers to longs
+ Post           : other added to acc
  Remarks        :
- Func ID        : 21
+ Func ID        : 197
 *******************************************************************/
-void testUtilties (BST_TREE* tree)
+void benchSumCombine (void* acc, void* other)
 {
-     printf("\n Tree contains %3d nodes: ", BST_Count(tree));
-     if (BST_Empty(tree))
-        printf("\n The tree IS empty");
-     else
-        printf("\n The tree IS NOT empty");
-     if (BST_Full(tree))
-        printf("\n The tree IS full\a");
-     else
-        printf("\n The tree IS NOT full");
-     return;
+    *(long*)acc += *(long*)other;
+    return;
+}
+
+/*******************************************************************
+ Function Name  : benchTeardown
+ Description    : Times BST_Destroy of a tree of max_count students whose records come
+                  from malloc, from the data pool, and from an arena, and BST_Clear of
+                  the arena tree.
+ Pre            : built with -DBST_BENCHMARK=max_count
+ Post           : Return 0, or 100 on memory overflow
+ Remarks        : the students go in in random order, so a node walk misses the cache
+ Func ID        : 204
+*******************************************************************/
+int benchTeardown (int max_count)
+{
+    static const char* names[] = { "malloc", "pool", "arena", "arena clear" };
+    BST_TREE* tree;
+    STUDENT* stuPtr;
+    struct timespec start, stop;
+    int *order;
+    int i, j, m, tmp;
+    unsigned int seed = 12345;
+    double ms;
+
+    order = (int*) malloc ((size_t)max_count * sizeof (int));
+    if (!order)
+    {
+        printf("\n ERR: Memory Overflow in benchmark");
+        return 100;
+    }
+    for (i = 0; i < max_count; ++i)
+        order[i] = i;
+    for (i = max_count - 1; i > 0; --i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        j = (int)(((uint64_t)seed * (uint64_t)(i + 1)) >> 32);
+        tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+    printf("\n %12s %12s", "records", "teardown ms");
+    for (m = 0; m < 4; ++m)
+    {
+        if (m < 2)
+           tree = BST_Create_Key (compareStu, getStuKey, BST_MODE_AVL | BST_MODE_INLINE_KEY);
+        else
+           tree = BST_Create_Arena (compareStu, getStuKey, BST_MODE_AVL | BST_MODE_INLINE_KEY, NULL);
+        if (!tree)
+           return 100;
+        for (i = 0; i < max_count; ++i)
+        {
+            stuPtr = (STUDENT*)(m == 0 ? calloc (1, sizeof (STUDENT)) : BST_Alloc_Data (tree, sizeof (STUDENT)));
+            if (!stuPtr)
+            {
+                printf("\n ERR: Memory Overflow in benchmark");
+                return 100;
+            }
+            stuPtr->id = order[i];
+            if (!BST_Insert (tree, stuPtr))
+            {
+                printf("\n ERR: Memory Overflow in benchmark");
+                return 100;
+            }
+        }
+        timespec_get (&start, TIME_UTC);
+        if (m == 3)
+           BST_Clear (tree);
+        else
+           tree = BST_Destroy (tree);
+        timespec_get (&stop, TIME_UTC);
+        ms = (double)(stop.tv_sec - start.tv_sec) * 1e3 + (double)(stop.tv_nsec - start.tv_nsec) / 1e6;
+        printf("\n %12s %12.3f", names[m], ms);
+        BST_Destroy (tree);
+    }
+    free (order);
+    printf("\n");
+    return 0;
 }
 /*******************************************************************
  Function Name  : compareStu
  Description    : Compare two student id's and return low, equal, high.
  Pre            : stu1 and stu2 are valid pointers to students
  Post           : return low (-1), equal (0), or high (+1)
- Remarks        :
+ Remarks        : reads only the id, so a pointer to a bare student id is a valid key
  Func ID        : 22
 *******************************************************************/
 int compareStu (void* stu1, void* stu2)
 {
-    STUDENT s1;
-    STUDENT s2;
+    const STUDENT* s1 = (const STUDENT*)stu1;
+    const STUDENT* s2 = (const STUDENT*)stu2;
 
-    s1 = *(STUDENT*)stu1;
-    s2 = *(STUDENT*)stu2;
-    if ( s1.id < s2.id)
-       return -1;
-    if ( s1.id == s2.id)
-       return 0;
-    return +1;
+    return BST_CMP_NUM(s1->id, s2->id);
+}
+/*******************************************************************
+ Function Name  : getStuKey
+ Description    : Returns the student id used as inline tree key.
+ Pre            : stuPtr is a valid pointer to a student or to a student id
+ Post           : return student id
+ Remarks        :
+ Func ID        : 42
+*******************************************************************/
+int getStuKey (void* stuPtr)
+{
+    return ((STUDENT*)stuPtr)->id;
+}
+/*******************************************************************
+ Function Name  : compareStuGpa
+ Description    : Compare two students by gpa, then by id.
+ Pre            : stu1 and stu2 are valid pointers to students
+ Post           : return low (-1), equal (0), or high (+1)
+ Remarks        : the id tie break makes every student a distinct key of the gpa index
+ Func ID        : 70
+*******************************************************************/
+int compareStuGpa (void* stu1, void* stu2)
+{
+    const STUDENT* s1 = (const STUDENT*)stu1;
+    const STUDENT* s2 = (const STUDENT*)stu2;
+    int result = BST_CMP_NUM(s1->gpa, s2->gpa);
+
+    return (result ? result : BST_CMP_NUM(s1->id, s2->id));
+}
+/*******************************************************************
+ Function Name  : getStuName
+ Description    : Returns the student name used as string index key.
+ Pre            : stuPtr is a valid pointer to a student
+ Post           : return student name
+ Remarks        :
+ Func ID        : 91
+*******************************************************************/
+const char* getStuName (void* stuPtr)
+{
+    return ((STUDENT*)stuPtr)->name;
 }
 /*******************************************************************
  Function Name  : processStu
@@ -865,6 +9531,268 @@ uint32_t Power_Of(const uint8_t base, const uint8_t power )
     return power_val;
 }
 /*------------------------------------------------------------*
+FUNCTION NAME  : Str_to_Num_Range
+
+DESCRIPTION    : converts the num_chars of num_in_str, an optional '-' then decimal
+                 digits, and checks the result against [valid_min_value, valid_max_value]
+
+INPUT          : num_in_str need not be null terminated
+
+OUTPUT         : SUCCESS with *num_ptr set, else FAILURE with *num_ptr = 0
+
+NOTE           : replaces Str_to_Num_Conv on the input paths: no strlen, no Power_Of,
+                 eight digits per multiply (_parse_digits). Leading zeros are skipped and
+                 more than 10 significant digits is out of range, so the value is
+                 computed in 64 bits and can not overflow before the range check.
+
+Func ID        : 02.11
+
+BUGS           :
+-*------------------------------------------------------------*/
+uint16_t Str_to_Num_Range(int32_t *const num_ptr, const char *const num_in_str, const size_t num_chars, const int32_t valid_min_value, const int32_t valid_max_value)
+{
+	 uint64_t num = 0;
+	 int64_t value;
+	 size_t pos = 0, start_num_pos;
+
+	 if(num_ptr == NULL_DATA_PTR || num_in_str == NULL_DATA_PTR || valid_min_value > valid_max_value)
+	 {
+		return FAILURE;
+	 }
+	 *num_ptr = 0;
+	 if(num_chars > 0 && num_in_str[0] == '-')
+	 {
+		 pos = 1;
+	 }
+	 start_num_pos = pos;
+	 while(pos < num_chars && num_in_str[pos] == '0')
+	 {
+		 ++pos;
+	 }
+	 pos += _parse_digits(num_in_str + pos, num_chars - pos, 10, &num);
+	 if(pos == start_num_pos || pos != num_chars)
+	 {
+		 #ifdef TRACE_ERROR
+		    printf("ERR: invalid or too many digits at data[%u] \n", (unsigned int)pos);
+		 #endif
+		 return FAILURE;
+	 }
+	 value = (start_num_pos == 1) ? -(int64_t)num : (int64_t)num;
+	 if(value < valid_min_value || value > valid_max_value)
+	 {
+		 #ifdef TRACE_ERROR
+		      printf("ERR: input data - %" PRId64 ", out of range [%d,%d] \n", value, valid_min_value, valid_max_value);
+		 #endif
+		 return FAILURE;
+	 }
+	 *num_ptr = (int32_t)value;
+	 return SUCCESS;
+}
+/*------------------------------------------------------------*
+FUNCTION NAME  : Str_to_Float_Range
+
+DESCRIPTION    : converts the num_chars of float_in_str, [+-]digits[.digits][(e|E)[+-]digits],
+                 to the nearest float and checks it against [valid_min_value, valid_max_value]
+
+INPUT          : float_in_str need not be null terminated
+
+OUTPUT         : SUCCESS with *float_num_ptr set, else FAILURE with *float_num_ptr = 0
+
+NOTE           : the result is the float strtof returns, but neither locale nor errno is
+                 read. Up to 19 significant digits are gathered into a uint64_t mantissa w
+                 with exponent e. w <= 2^24 and |e| <= 10 are exact floats, so one float
+                 multiply or divide rounds once. w <= 2^53 and |e| <= 22 are exact doubles:
+                 the double result is rounded again to float, which is only wrong when it
+                 lies exactly halfway between two floats - that case, more digits, or a
+                 larger exponent go to strtof on a terminated copy.
+
+Func ID        : 02.12
+
+BUGS           : strings of PARSE_MAX_CHARS or more that reach strtof are rejected
+-*------------------------------------------------------------*/
+uint16_t Str_to_Float_Range(float *const float_num_ptr, const char *const float_in_str, const size_t num_chars, const float valid_min_value, const float valid_max_value)
+{
+	static const float float_pow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	static const double double_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	char float_str[PARSE_MAX_CHARS];
+	uint64_t mant = 0, bits;
+	size_t pos = 0, run, num_digits = 0;
+	int32_t exp10 = 0, exp_val = 0;
+	bool negative = false, exp_negative = false, any_digit = false, exact = true;
+	float temp_float;
+	double temp_double;
+
+	if(float_num_ptr == NULL_DATA_PTR || float_in_str == NULL_DATA_PTR || valid_min_value > valid_max_value)
+	{
+		return FAILURE;
+	}
+	*float_num_ptr = 0.0f;
+	if(pos < num_chars && (float_in_str[pos] == '-' || float_in_str[pos] == '+'))
+	{
+		negative = (float_in_str[pos++] == '-');
+	}
+	while(pos < num_chars && float_in_str[pos] == '0')
+	{
+		++pos;
+		any_digit = true;
+	}
+	run = _parse_digits(float_in_str + pos, num_chars - pos, PARSE_MAX_DIGITS, &mant);
+	pos += run;
+	num_digits = run;
+	for(; pos < num_chars && float_in_str[pos] >= '0' && float_in_str[pos] <= '9'; ++pos)
+	{
+		++exp10;
+		exact = false;
+	}
+	any_digit |= (num_digits > 0);
+	if(pos < num_chars && float_in_str[pos] == '.')
+	{
+		++pos;
+		if(num_digits == 0)
+		{
+			for(; pos < num_chars && float_in_str[pos] == '0'; ++pos)
+			{
+				--exp10;
+				any_digit = true;
+			}
+		}
+		run = _parse_digits(float_in_str + pos, num_chars - pos, PARSE_MAX_DIGITS - num_digits, &mant);
+		pos += run;
+		num_digits += run;
+		exp10 -= (int32_t)run;
+		any_digit |= (run > 0);
+		for(; pos < num_chars && float_in_str[pos] >= '0' && float_in_str[pos] <= '9'; ++pos)
+		{
+			exact = false;
+			any_digit = true;
+		}
+	}
+	if(!any_digit)
+	{
+		return FAILURE;
+	}
+	if(pos < num_chars && (float_in_str[pos] == 'e' || float_in_str[pos] == 'E'))
+	{
+		++pos;
+		if(pos < num_chars && (float_in_str[pos] == '-' || float_in_str[pos] == '+'))
+		{
+			exp_negative = (float_in_str[pos++] == '-');
+		}
+		if(pos == num_chars || float_in_str[pos] < '0' || float_in_str[pos] > '9')
+		{
+			return FAILURE;
+		}
+		for(; pos < num_chars && float_in_str[pos] >= '0' && float_in_str[pos] <= '9'; ++pos)
+		{
+			if(exp_val < 100000)
+				exp_val = exp_val * 10 + (float_in_str[pos] - '0');
+		}
+		exp10 += exp_negative ? -exp_val : exp_val;
+	}
+	if(pos != num_chars)
+	{
+		#ifdef TRACE_ERROR
+		   printf("ERR: invalid char at data[%u] \n", (unsigned int)pos);
+		#endif
+		return FAILURE;
+	}
+
+	if(mant == 0)
+	{
+		temp_float = 0.0f;
+	}
+	else if(exact && mant <= (UINT64_C(1) << 24) && exp10 >= -10 && exp10 <= 10)
+	{
+		temp_float = (exp10 < 0) ? (float)mant / float_pow10[-exp10] : (float)mant * float_pow10[exp10];
+	}
+	else
+	{
+		exact = exact && mant <= (UINT64_C(1) << 53) && exp10 >= -22 && exp10 <= 22 && FLT_EVAL_METHOD == 0;
+		if(exact)
+		{
+			temp_double = (exp10 < 0) ? (double)mant / double_pow10[-exp10] : (double)mant * double_pow10[exp10];
+			memcpy(&bits, &temp_double, sizeof(bits));
+			exact = ((bits & UINT64_C(0x1FFFFFFF)) != UINT64_C(0x10000000));
+		}
+		if(exact)
+		{
+			temp_float = (float)temp_double;
+		}
+		else
+		{
+			if(num_chars >= PARSE_MAX_CHARS)
+			{
+				return FAILURE;
+			}
+			memcpy(float_str, float_in_str, num_chars);
+			float_str[num_chars] = NULL_CHAR;
+			temp_float = strtof(float_str, NULL);
+			negative = false;
+		}
+	}
+	if(negative)
+	{
+		temp_float = -temp_float;
+	}
+	if(!(temp_float >= valid_min_value && temp_float <= valid_max_value))
+	{
+		#ifdef TRACE_ERROR
+		   printf("ERR: input data - %f, out of range [%f,%f] \n", temp_float, valid_min_value, valid_max_value);
+		#endif
+		return FAILURE;
+	}
+	*float_num_ptr = temp_float;
+	return SUCCESS;
+}
+/*------------------------------------------------------------*
+FUNCTION NAME  : _parse_digits
+
+DESCRIPTION    : appends the leading decimal digits of digit_str, at most max_digits
+                 of them, to *num_ptr
+
+INPUT          : *num_ptr has at most PARSE_MAX_DIGITS - max_digits digits
+
+OUTPUT         : number of digits consumed
+
+NOTE           : SWAR: eight chars are loaded as one word, checked to all be digits
+                 (high nibble 3 before and after adding 6), then paired up by
+                 multiplies: 8 x 1 digit -> 4 x 2 digits -> 1 x 8 digits. The tail,
+                 and big endian hosts, go a digit at a time.
+
+Func ID        : 02.13
+
+BUGS           :
+-*------------------------------------------------------------*/
+size_t _parse_digits(const char *const digit_str, const size_t num_chars, const size_t max_digits, uint64_t *const num_ptr)
+{
+	uint64_t num = *num_ptr, chunk;
+	size_t pos = 0;
+
+#if PARSE_SWAR
+	while(num_chars - pos >= 8 && max_digits - pos >= 8)
+	{
+		memcpy(&chunk, digit_str + pos, sizeof(chunk));
+		if((((chunk & UINT64_C(0xF0F0F0F0F0F0F0F0)) | (((chunk + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) >> 4))) != UINT64_C(0x3333333333333333))
+		{
+			break;
+		}
+		chunk -= UINT64_C(0x3030303030303030);
+		chunk = (chunk * 10) + (chunk >> 8);
+		chunk = (((chunk & UINT64_C(0x000000FF000000FF)) * (100 + (UINT64_C(1000000) << 32)))
+		         + (((chunk >> 16) & UINT64_C(0x000000FF000000FF)) * (1 + (UINT64_C(10000) << 32)))) >> 32;
+		num = num * UINT64_C(100000000) + chunk;
+		pos += 8;
+	}
+#endif
+	for(; pos < num_chars && pos < max_digits && digit_str[pos] >= '0' && digit_str[pos] <= '9'; ++pos)
+	{
+		num = num * 10 + (uint64_t)(digit_str[pos] - '0');
+	}
+	*num_ptr = num;
+	return pos;
+}
+/*------------------------------------------------------------*
 FUNCTION NAME  : Validate_Number_Input
 
 DESCRIPTION    :
@@ -883,7 +9811,7 @@ uint16_t Get_Validate_Input_Number(void *const input_num_ptr, char *const input_
 {
 	int32_t temp_int, *int32_input_num_ptr;
 
-	if(int32_input_num_ptr == NULL_DATA_PTR)
+	if(input_num_ptr == NULL_DATA_PTR)
 	{
 		return FAILURE;
 	}
@@ -895,19 +9823,12 @@ uint16_t Get_Validate_Input_Number(void *const input_num_ptr, char *const input_
 	*int32_input_num_ptr = 0;
 	if((Get_Input_Str(input_str_ptr, input_str_max_chars)) != SUCCESS)
 		return FAILURE;
-	if((Str_to_Num_Conv(&temp_int, input_str_ptr)) != SUCCESS)
+	if((Str_to_Num_Range(&temp_int, input_str_ptr, strlen(input_str_ptr), valid_min_value, valid_max_value)) != SUCCESS)
 	{
 		memset(input_str_ptr, NULL_CHAR, input_str_max_chars);
 		return FAILURE;
 	}
 	memset(input_str_ptr, NULL_CHAR, input_str_max_chars);
-	if(temp_int < valid_min_value || temp_int > valid_max_value)
-	{
-		 #ifdef TRACE_ERROR
-		      printf("ERR: input data - %d, out of range [%d,%d] \n", temp_int, valid_min_value, valid_max_value);
-		 #endif
-		 return FAILURE;
-	}
 	*int32_input_num_ptr = temp_int;
 	return SUCCESS;
 }
@@ -1042,7 +9963,6 @@ BUGS           :
 -*------------------------------------------------------------*/
 uint16_t Get_Validate_Input_Float(float *const float_input_num_ptr, char *const input_str_ptr, const unsigned int input_str_max_chars, const float valid_min_value, const float valid_max_value)
 {
-	char float_str[30], *endptr;
     float temp_float;
 
     if(float_input_num_ptr == NULL_DATA_PTR || input_str_max_chars <= 1 || valid_min_value > valid_max_value)
@@ -1052,24 +9972,13 @@ uint16_t Get_Validate_Input_Float(float *const float_input_num_ptr, char *const
 	*float_input_num_ptr = 0.0;
 	if((Get_Input_Str(input_str_ptr, input_str_max_chars)) != SUCCESS)
 		return FAILURE;
-	temp_float = strtof(input_str_ptr, &endptr);
-	memset(input_str_ptr, NULL_CHAR, input_str_max_chars);
-	if(temp_float == 0)
-	{
-		if (errno == ERANGE)
-            printf("ERR: The value provided was out of range\n");
-		return FAILURE;
-	}
-	if(strcmp(endptr , ""))
-	{
-		printf("ERR: float data has invalid char(s) \n");
-		return FAILURE;
-	}
-	if(temp_float < valid_min_value || temp_float > valid_max_value)
+	if((Str_to_Float_Range(&temp_float, input_str_ptr, strlen(input_str_ptr), valid_min_value, valid_max_value)) != SUCCESS)
 	{
-		 printf("ERR: input data - %f, out of range [%f,%f] \n", temp_float, valid_min_value, valid_max_value);
+		 printf("ERR: input data - %s, not a number in range [%f,%f] \n", input_str_ptr, valid_min_value, valid_max_value);
+		 memset(input_str_ptr, NULL_CHAR, input_str_max_chars);
 		 return FAILURE;
 	}
+	memset(input_str_ptr, NULL_CHAR, input_str_max_chars);
 	*float_input_num_ptr = temp_float;
 	return SUCCESS;
 